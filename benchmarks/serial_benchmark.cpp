@@ -0,0 +1,239 @@
+/**
+ * Measures the throughput, latency and allocations of the Serial read and write paths.
+ *
+ * Each benchmark runs over a pseudo terminal pair, the Serial object opens the slave
+ * side and the benchmark drives the master side directly, so no hardware is needed.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+#if defined(__APPLE__)
+# include <util.h>
+#else
+# include <pty.h>
+#endif
+
+#include <boost/atomic.hpp>
+#include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/thread.hpp>
+
+#include "serial/serial.h"
+
+using namespace serial;
+
+/** Allocation counting **/
+
+#if __cplusplus >= 201103L
+# define THROW_BAD_ALLOC
+# define THROW_NOTHING noexcept
+#else
+# define THROW_BAD_ALLOC throw(std::bad_alloc)
+# define THROW_NOTHING throw()
+#endif
+
+static boost::atomic<unsigned long> allocation_count(0);
+
+void* operator new(std::size_t size) THROW_BAD_ALLOC {
+    allocation_count.fetch_add(1, boost::memory_order_relaxed);
+    void *p = std::malloc(size ? size : 1);
+    if(p == NULL)
+        throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](std::size_t size) THROW_BAD_ALLOC {
+    return operator new(size);
+}
+
+void operator delete(void* p) THROW_NOTHING {
+    std::free(p);
+}
+
+void operator delete[](void* p) THROW_NOTHING {
+    std::free(p);
+}
+
+#if defined(__cpp_sized_deallocation) || __cplusplus >= 201402L
+void operator delete(void* p, std::size_t) THROW_NOTHING {
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) THROW_NOTHING {
+    std::free(p);
+}
+#endif
+
+/** Helpers **/
+
+struct PtyPair {
+    int master;
+    int slave;
+    std::string name;
+
+    PtyPair() {
+        char name_[256];
+        if(openpty(&this->master, &this->slave, name_, NULL, NULL) != 0) {
+            std::perror("openpty");
+            std::exit(1);
+        }
+        struct termios tio;
+        tcgetattr(this->master, &tio);
+        cfmakeraw(&tio);
+        tcsetattr(this->master, TCSANOW, &tio);
+        this->name = name_;
+    }
+
+    ~PtyPair() {
+        ::close(this->master);
+        ::close(this->slave);
+    }
+};
+
+static double now_seconds() {
+    using namespace boost::posix_time;
+    static const ptime epoch(boost::gregorian::date(1970, 1, 1));
+    return (microsec_clock::universal_time() - epoch).total_microseconds() / 1e6;
+}
+
+static void write_all(int fd, const char* data, std::size_t size) {
+    while(size > 0) {
+        ssize_t result = ::write(fd, data, size);
+        if(result < 0)
+            return;
+        data += result;
+        size -= result;
+    }
+}
+
+static void read_all(int fd, std::size_t size) {
+    char buffer[4096];
+    while(size > 0) {
+        ssize_t result = ::read(fd, buffer, std::min(size, sizeof(buffer)));
+        if(result <= 0)
+            return;
+        size -= result;
+    }
+}
+
+static const char* mode_name(long timeout, bool reader_thread) {
+    if(reader_thread)
+        return timeout == 0 ? "reader-thread/non-blocking" : (timeout < 0 ? "reader-thread/blocking" : "reader-thread/timeout");
+    return timeout == 0 ? "non-blocking" : (timeout < 0 ? "blocking" : "timeout");
+}
+
+/** Benchmarks **/
+
+static void benchmark_read_throughput(long timeout, bool reader_thread, std::size_t total) {
+    PtyPair pty;
+    Serial serial(pty.name, 115200, timeout);
+    if(reader_thread)
+        serial.startReaderThread();
+
+    // Send total bytes from another thread while this one reads them
+    std::vector<char> source(total, 'x');
+    double start = now_seconds();
+    boost::thread producer(boost::bind(&write_all, pty.master, &source[0], source.size()));
+
+    char buffer[4096];
+    std::size_t received = 0, calls = 0;
+    unsigned long allocations = allocation_count;
+    while(received < total) {
+        int result = serial.read(buffer, int(std::min(sizeof(buffer), total - received)));
+        received += result;
+        calls += 1;
+    }
+    allocations = allocation_count - allocations;
+    double elapsed = now_seconds() - start;
+    producer.join();
+
+    std::printf("read throughput     %-28s %8.2f MB/s %8lu calls %6.3f allocs/call\n",
+                mode_name(timeout, reader_thread), received / elapsed / 1e6,
+                (unsigned long)calls, double(allocations) / calls);
+}
+
+static void benchmark_write_throughput(std::size_t total, std::size_t chunk) {
+    PtyPair pty;
+    Serial serial(pty.name, 115200, 100);
+
+    std::vector<char> data(chunk, 'x');
+    double start = now_seconds();
+    boost::thread consumer(boost::bind(&read_all, pty.master, total));
+    unsigned long allocations = allocation_count;
+    for(std::size_t sent = 0; sent < total; sent += chunk)
+        serial.write(&data[0], int(chunk));
+    allocations = allocation_count - allocations;
+    consumer.join();
+    double elapsed = now_seconds() - start;
+
+    std::printf("write throughput    %-28lu %8.2f MB/s %8lu calls %6.3f allocs/call\n",
+                (unsigned long)chunk, total / elapsed / 1e6, (unsigned long)(total / chunk),
+                double(allocations) / (total / chunk));
+}
+
+static void benchmark_read_until_latency(long timeout, bool reader_thread, std::size_t iterations) {
+    PtyPair pty;
+    Serial serial(pty.name, 115200, timeout);
+    if(reader_thread)
+        serial.startReaderThread();
+
+    // Time from writing a line on the master side until read_until returns it
+    const std::string line("$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47\r\n");
+    std::vector<double> latencies;
+    latencies.reserve(iterations);
+    unsigned long allocations = allocation_count;
+    for(std::size_t i = 0; i < iterations; ++i) {
+        double start = now_seconds();
+        write_all(pty.master, line.data(), line.size());
+        std::string result;
+        do {
+            result += serial.read_until("\r\n");
+        } while(result.size() < line.size());
+        latencies.push_back(now_seconds() - start);
+    }
+    allocations = allocation_count - allocations;
+
+    std::sort(latencies.begin(), latencies.end());
+    std::printf("read_until latency  %-28s p50 %7.1f us p90 %7.1f us p99 %7.1f us max %7.1f us %6.3f allocs/call\n",
+                mode_name(timeout, reader_thread),
+                latencies[iterations / 2] * 1e6,
+                latencies[iterations * 9 / 10] * 1e6,
+                latencies[iterations * 99 / 100] * 1e6,
+                latencies.back() * 1e6, double(allocations) / iterations);
+}
+
+int main(int argc, char **argv) {
+    std::size_t iterations = 2000;
+    if(argc > 1)
+        iterations = std::strtoul(argv[1], NULL, 10);
+    if(iterations < 100)
+        iterations = 100;
+    std::size_t total = iterations * 4096;
+
+    const long timeouts[] = {0, 100, -1};
+    for(int reader_thread = 0; reader_thread < 2; ++reader_thread) {
+        for(std::size_t i = 0; i < sizeof(timeouts) / sizeof(timeouts[0]); ++i)
+            benchmark_read_throughput(timeouts[i], reader_thread != 0, total);
+    }
+
+    const std::size_t chunks[] = {8, 64, 4096};
+    for(std::size_t i = 0; i < sizeof(chunks) / sizeof(chunks[0]); ++i)
+        benchmark_write_throughput(std::min(total, chunks[i] * iterations * 4), chunks[i]);
+
+    for(int reader_thread = 0; reader_thread < 2; ++reader_thread) {
+        for(std::size_t i = 0; i < sizeof(timeouts) / sizeof(timeouts[0]); ++i)
+            benchmark_read_until_latency(timeouts[i], reader_thread != 0, iterations);
+    }
+
+    return 0;
+}
@@ -0,0 +1,496 @@
+/**
+ * Drives many ports at once with mixed traffic to measure how Serial scales.
+ *
+ * Each port is a pseudo terminal pair. Generator threads play the devices on the master
+ * sides: each port receives lines, read with read_until, and fixed size blocks, read with
+ * read, at a set rate, and the host answers every line with a short acknowledgement. A
+ * device which cannot hand a message to its port because the host fell behind drops it,
+ * like a UART overrun. The report gives the aggregate throughput, the CPU time used per MB
+ * received, the latency from sending a message until the host has read it, overall and
+ * for the worst ports, how evenly the ports were served and the bytes dropped or lost.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#if defined(__APPLE__)
+# include <util.h>
+#else
+# include <pty.h>
+#endif
+
+#include <boost/asio.hpp>
+#include <boost/atomic.hpp>
+#include <boost/bind.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread.hpp>
+
+#include "serial/serial.h"
+
+using namespace serial;
+
+/** Options **/
+
+enum stress_mode_t { MODE_THREAD, MODE_READER, MODE_SHARED, MODE_SHARED_READER };
+
+struct Options {
+    std::size_t ports;
+    double seconds;
+    double rate;
+    std::size_t threads;
+    stress_mode_t mode;
+
+    Options() : ports(16), seconds(5), rate(11520), threads(4), mode(MODE_THREAD) {}
+};
+
+static const char* mode_names[] = { "thread", "reader", "shared", "shared-reader" };
+
+static void usage(const char* program) {
+    std::fprintf(stderr,
+                 "usage: %s [-n ports] [-d seconds] [-r bytes/s per port] [-m mode] [-j threads]\n"
+                 "  -m thread         one thread per port doing blocking reads and writes (default)\n"
+                 "  -m reader         the same with each port's background reader thread\n"
+                 "  -m shared         asynchronous reads and writes on one io_service run by -j threads\n"
+                 "  -m shared-reader  a thread per port reading from background readers which are\n"
+                 "                    filled by one io_service run by -j threads\n",
+                 program);
+    std::exit(2);
+}
+
+static Options parse_options(int argc, char **argv) {
+    Options options;
+    int option;
+    while((option = ::getopt(argc, argv, "n:d:r:m:j:h")) != -1) {
+        switch(option) {
+            case 'n': options.ports = std::strtoul(optarg, NULL, 10); break;
+            case 'd': options.seconds = std::strtod(optarg, NULL); break;
+            case 'r': options.rate = std::strtod(optarg, NULL); break;
+            case 'j': options.threads = std::strtoul(optarg, NULL, 10); break;
+            case 'm': {
+                std::size_t i = 0;
+                while(i < sizeof(mode_names) / sizeof(mode_names[0]) && std::strcmp(optarg, mode_names[i]) != 0)
+                    ++i;
+                if(i == sizeof(mode_names) / sizeof(mode_names[0]))
+                    usage(argv[0]);
+                options.mode = stress_mode_t(i);
+                break;
+            }
+            default: usage(argv[0]);
+        }
+    }
+    if(options.ports == 0 || options.seconds <= 0 || options.rate <= 0 || options.threads == 0)
+        usage(argv[0]);
+    return options;
+}
+
+/** Helpers **/
+
+static uint64_t now_nanoseconds() {
+    struct timespec now;
+    ::clock_gettime(CLOCK_MONOTONIC, &now);
+    return uint64_t(now.tv_sec) * 1000000000u + now.tv_nsec;
+}
+
+static double thread_cpu_seconds() {
+    struct timespec now;
+    ::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static double process_cpu_seconds() {
+    struct rusage usage;
+    ::getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+           usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+// Every port needs a descriptor for its master side, its slave side while it is opened and
+// its Serial, so hundreds of ports need more than the usual soft limit
+static void raise_file_limit() {
+    struct rlimit limit;
+    if(::getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        ::setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+/** Messages **/
+
+// Every fourth message is a block, the others are lines of varying length
+static const std::size_t BLOCK_SIZE = 64;
+
+static bool is_block(uint64_t sequence) {
+    return sequence % 4 == 3;
+}
+
+// "L<sequence> <send time>" and up to 31 dots ending with a newline for a line, the same
+// header starting with 'B' and padded to BLOCK_SIZE for a block
+static std::string make_message(uint64_t sequence) {
+    char header[48];
+    int length = std::snprintf(header, sizeof(header), "%c%010llu %020llu", is_block(sequence) ? 'B' : 'L',
+                               (unsigned long long)sequence, (unsigned long long)now_nanoseconds());
+    std::string message(header, length);
+    if(is_block(sequence)) {
+        message.resize(BLOCK_SIZE, 'x');
+    } else {
+        message.append(sequence % 32, '.');
+        message += '\n';
+    }
+    return message;
+}
+
+/** Ports **/
+
+struct StressPort {
+    int master;
+    std::string name;
+    boost::scoped_ptr<Serial> serial;
+
+    // Used by the generator thread only
+    uint64_t next_sequence;
+    std::string pending;
+    std::size_t pending_size;
+    double credit;
+    uint64_t bytes_sent;
+    uint64_t bytes_dropped;
+    uint64_t bytes_acknowledged;
+
+    // Used by whichever thread reads the port
+    uint64_t expected_sequence;
+    uint64_t sequence_errors;
+    uint64_t bytes_written;
+    std::string partial;
+    char block[BLOCK_SIZE];
+    char acknowledgement[16];
+    serial::LatencyHistogram latency;
+    boost::atomic<uint64_t> bytes_received;
+    boost::atomic<bool> write_pending;
+    boost::atomic<bool> done;
+
+    StressPort() : master(-1), next_sequence(0), pending_size(0), credit(0), bytes_sent(0), bytes_dropped(0),
+                   bytes_acknowledged(0), expected_sequence(0), sequence_errors(0), bytes_written(0),
+                   bytes_received(0), write_pending(false), done(false) {}
+
+    ~StressPort() {
+        if(this->master >= 0)
+            ::close(this->master);
+    }
+
+    void open(const Options& options, boost::asio::io_service& io_service) {
+        char name_[256];
+        int slave;
+        if(openpty(&this->master, &slave, name_, NULL, NULL) != 0) {
+            std::perror("openpty");
+            std::exit(1);
+        }
+        struct termios tio;
+        tcgetattr(this->master, &tio);
+        cfmakeraw(&tio);
+        tcsetattr(this->master, TCSANOW, &tio);
+        ::fcntl(this->master, F_SETFL, ::fcntl(this->master, F_GETFL) | O_NONBLOCK);
+        this->name = name_;
+
+        bool shared = options.mode == MODE_SHARED || options.mode == MODE_SHARED_READER;
+        this->serial.reset(shared ? new Serial(io_service) : new Serial());
+        this->serial->setPort(this->name);
+        this->serial->setBaudrate(115200);
+        this->serial->setTimeoutMilliseconds(100);
+        this->serial->open();
+        if(options.mode == MODE_READER || options.mode == MODE_SHARED_READER)
+            this->serial->startReaderThread();
+        ::close(slave);
+    }
+
+    // Checks a complete message, the host acknowledges each line with "A<sequence>\n"
+    bool received(const char* data, std::size_t size) {
+        unsigned long long sequence = 0, sent = 0;
+        if(std::sscanf(data, "%*c%10llu %20llu", &sequence, &sent) != 2 ||
+           data[0] != (is_block(this->expected_sequence) ? 'B' : 'L') || sequence != this->expected_sequence) {
+            this->sequence_errors += 1;
+            this->expected_sequence = sequence;
+        }
+        this->expected_sequence += 1;
+        this->latency.record(now_nanoseconds() - sent);
+        this->bytes_received.fetch_add(size, boost::memory_order_relaxed);
+        if(is_block(sequence))
+            return false;
+        std::snprintf(this->acknowledgement, sizeof(this->acknowledgement), "A%010llu\n", sequence);
+        return true;
+    }
+};
+
+/** Devices **/
+
+static boost::atomic<bool> generating(true);
+
+// Hands out the messages due on a port, finishing a partly written one first. A message
+// only counts as sent once all of it was written.
+static void generate(StressPort& port, double rate, double elapsed) {
+    port.credit = std::min(port.credit + rate * elapsed, rate);
+    while(true) {
+        if(!port.pending.empty()) {
+            ssize_t result = ::write(port.master, port.pending.data(), port.pending.size());
+            if(result > 0)
+                port.pending.erase(0, result);
+            if(!port.pending.empty()) {
+                // The host has not taken the last message yet, so what is due now is lost
+                port.bytes_dropped += uint64_t(port.credit);
+                port.credit -= uint64_t(port.credit);
+                return;
+            }
+            port.bytes_sent += port.pending_size;
+        }
+        std::string message = make_message(port.next_sequence);
+        if(port.credit < message.size())
+            return;
+        port.credit -= message.size();
+        port.next_sequence += 1;
+        port.pending = message;
+        port.pending_size = message.size();
+    }
+}
+
+static void acknowledgements(StressPort& port) {
+    char buffer[4096];
+    ssize_t result;
+    while((result = ::read(port.master, buffer, sizeof(buffer))) > 0)
+        port.bytes_acknowledged += result;
+}
+
+static void generator_main(std::vector<StressPort*> ports, double rate, double* cpu_seconds) {
+    double cpu_start = thread_cpu_seconds();
+    uint64_t last = now_nanoseconds();
+    while(generating) {
+        uint64_t now = now_nanoseconds();
+        for(std::size_t i = 0; i < ports.size(); ++i) {
+            generate(*ports[i], rate, (now - last) / 1e9);
+            acknowledgements(*ports[i]);
+        }
+        last = now;
+        ::usleep(1000);
+    }
+    *cpu_seconds = thread_cpu_seconds() - cpu_start;
+}
+
+/** Hosts **/
+
+static boost::atomic<bool> hosting(true);
+
+// Reads with read_until and read, collecting what a timeout cut short, until the device
+// hangs up or the run is over
+static void host_main(StressPort* port) {
+    Serial& serial = *port->serial;
+    try {
+        while(hosting) {
+            std::size_t size;
+            if(is_block(port->expected_sequence)) {
+                std::size_t offset = port->partial.size();
+                port->partial.resize(BLOCK_SIZE);
+                size = offset + serial.read(&port->partial[offset], int(BLOCK_SIZE - offset));
+                port->partial.resize(size);
+                if(size < BLOCK_SIZE)
+                    continue;
+            } else {
+                port->partial += serial.read_until("\n");
+                size = port->partial.size();
+                if(size == 0 || port->partial[size - 1] != '\n')
+                    continue;
+            }
+            if(port->received(port->partial.data(), size))
+                port->bytes_written += serial.write(port->acknowledgement);
+            port->partial.clear();
+        }
+    } catch(std::exception&) {
+    }
+    port->done = true;
+}
+
+static void start_async_read(StressPort* port);
+
+static void async_write_complete(StressPort* port, const boost::system::error_code& error, std::size_t bytes) {
+    if(!error)
+        port->bytes_written += bytes;
+    port->write_pending = false;
+}
+
+static void async_read_complete(StressPort* port, const char* data, const boost::system::error_code& error,
+                                std::size_t bytes) {
+    if(error || !hosting) {
+        port->done = true;
+        return;
+    }
+    // An acknowledgement due while the last one is still being written is skipped
+    if(port->received(data, bytes) && !port->write_pending) {
+        port->write_pending = true;
+        port->serial->async_write(port->acknowledgement, std::strlen(port->acknowledgement),
+                                  boost::bind(&async_write_complete, port, _1, _2));
+    }
+    start_async_read(port);
+}
+
+static void async_read_until_complete(StressPort* port, const boost::system::error_code& error,
+                                      const std::string& line) {
+    async_read_complete(port, line.data(), error, line.size());
+}
+
+static void start_async_read(StressPort* port) {
+    if(is_block(port->expected_sequence))
+        port->serial->async_read(port->block, BLOCK_SIZE, boost::bind(&async_read_complete, port, port->block, _1, _2));
+    else
+        port->serial->async_read_until("\n", boost::bind(&async_read_until_complete, port, _1, _2));
+}
+
+/** Report **/
+
+static double percentile_microseconds(const serial::LatencyHistogram& histogram, double fraction) {
+    return histogram.percentile(fraction) / 1e3;
+}
+
+static bool port_p99_less(const StressPort* a, const StressPort* b) {
+    return a->latency.percentile(0.99) < b->latency.percentile(0.99);
+}
+
+static void report(const Options& options, std::vector<StressPort*>& ports, double elapsed, uint64_t received,
+                   double cpu_seconds) {
+    uint64_t sent = 0, dropped = 0, lost = 0, errors = 0, written = 0, acknowledged = 0;
+    double sum = 0, sum_squares = 0;
+    serial::LatencyHistogram latency;
+    for(std::size_t i = 0; i < ports.size(); ++i) {
+        StressPort& port = *ports[i];
+        uint64_t port_received = port.bytes_received;
+        sent += port.bytes_sent;
+        dropped += port.bytes_dropped;
+        lost += port.bytes_sent > port_received ? port.bytes_sent - port_received : 0;
+        errors += port.sequence_errors;
+        written += port.bytes_written;
+        acknowledged += port.bytes_acknowledged;
+        sum += double(port_received);
+        sum_squares += double(port_received) * double(port_received);
+        latency.add(port.latency);
+    }
+
+    double megabytes = received / 1e6;
+    std::printf("mode %s, %lu ports at %.0f bytes/s for %.1f s", mode_names[options.mode],
+                (unsigned long)ports.size(), options.rate, elapsed);
+    if(options.mode == MODE_SHARED || options.mode == MODE_SHARED_READER)
+        std::printf(", %lu io_service threads", (unsigned long)options.threads);
+    std::printf("\n");
+    std::printf("throughput   %8.3f MB/s received of %.3f MB/s offered, %.3f MB/s written\n",
+                megabytes / elapsed, ports.size() * options.rate / 1e6, written / elapsed / 1e6);
+    std::printf("cpu          %8.1f ms per MB received, %.1f%% of one core, devices excluded\n",
+                megabytes > 0 ? cpu_seconds * 1e3 / megabytes : 0.0, cpu_seconds / elapsed * 100);
+    std::printf("latency      p50 %8.1f us p99 %8.1f us p99.9 %8.1f us max %8.1f us\n",
+                percentile_microseconds(latency, 0.5), percentile_microseconds(latency, 0.99),
+                percentile_microseconds(latency, 0.999), latency.max() / 1e3);
+
+    // The tail of each port on its own, a single slow port is hidden in the aggregate
+    std::sort(ports.begin(), ports.end(), port_p99_less);
+    const StressPort& worst = *ports.back();
+    std::printf("port p99     median %8.1f us p90 %8.1f us worst %8.1f us (%s)\n",
+                percentile_microseconds(ports[ports.size() / 2]->latency, 0.99),
+                percentile_microseconds(ports[ports.size() * 9 / 10]->latency, 0.99),
+                percentile_microseconds(worst.latency, 0.99), worst.name.c_str());
+
+    // Jain's index, 1 when every port received the same, 1 / ports when one got everything
+    std::printf("fairness     %8.3f\n", sum_squares > 0 ? sum * sum / (ports.size() * sum_squares) : 1.0);
+    std::printf("dropped      %8llu bytes the host did not take in time, %llu sent\n",
+                (unsigned long long)dropped, (unsigned long long)sent);
+    std::printf("lost         %8llu bytes sent but not received, %llu sequence errors\n",
+                (unsigned long long)lost, (unsigned long long)errors);
+    std::printf("acknowledged %8llu of %llu bytes written\n", (unsigned long long)acknowledged,
+                (unsigned long long)written);
+}
+
+int main(int argc, char **argv) {
+    Options options = parse_options(argc, argv);
+    raise_file_limit();
+
+    boost::asio::io_service io_service;
+    std::vector<StressPort*> ports;
+    for(std::size_t i = 0; i < options.ports; ++i) {
+        ports.push_back(new StressPort());
+        ports.back()->open(options, io_service);
+    }
+
+    boost::thread_group io_threads;
+    boost::scoped_ptr<boost::asio::io_service::work> work;
+    boost::thread_group hosts;
+    if(options.mode == MODE_SHARED || options.mode == MODE_SHARED_READER) {
+        work.reset(new boost::asio::io_service::work(io_service));
+        for(std::size_t i = 0; i < options.threads; ++i)
+            io_threads.create_thread(boost::bind(&boost::asio::io_service::run, &io_service));
+    }
+    for(std::size_t i = 0; i < ports.size(); ++i) {
+        if(options.mode == MODE_SHARED)
+            start_async_read(ports[i]);
+        else
+            hosts.create_thread(boost::bind(&host_main, ports[i]));
+    }
+
+    // A generator thread for every 128 ports
+    std::size_t generators = (ports.size() + 127) / 128;
+    std::vector<double> generator_cpu(generators, 0);
+    boost::thread_group generator_threads;
+    double cpu_start = process_cpu_seconds();
+    uint64_t start = now_nanoseconds();
+    for(std::size_t g = 0; g < generators; ++g) {
+        std::vector<StressPort*> share;
+        for(std::size_t i = g; i < ports.size(); i += generators)
+            share.push_back(ports[i]);
+        generator_threads.create_thread(boost::bind(&generator_main, share, options.rate, &generator_cpu[g]));
+    }
+    ::usleep(useconds_t(options.seconds * 1e6));
+    generating = false;
+    generator_threads.join_all();
+    double elapsed = (now_nanoseconds() - start) / 1e9;
+    double cpu_seconds = process_cpu_seconds() - cpu_start;
+    for(std::size_t g = 0; g < generators; ++g)
+        cpu_seconds -= generator_cpu[g];
+    uint64_t received = 0;
+    for(std::size_t i = 0; i < ports.size(); ++i)
+        received += ports[i]->bytes_received;
+
+    // Give the hosts a second to read what is still buffered, then hang up the devices
+    uint64_t sent = 0;
+    for(std::size_t i = 0; i < ports.size(); ++i)
+        sent += ports[i]->bytes_sent;
+    for(int wait = 0; wait < 100; ++wait) {
+        uint64_t total = 0;
+        for(std::size_t i = 0; i < ports.size(); ++i)
+            total += ports[i]->bytes_received;
+        if(total >= sent)
+            break;
+        ::usleep(10000);
+    }
+    hosting = false;
+    for(std::size_t i = 0; i < ports.size(); ++i) {
+        acknowledgements(*ports[i]);
+        ::close(ports[i]->master);
+        ports[i]->master = -1;
+    }
+    hosts.join_all();
+    for(std::size_t i = 0; i < ports.size() && options.mode == MODE_SHARED; ++i) {
+        while(!ports[i]->done || ports[i]->write_pending)
+            ::usleep(1000);
+    }
+    // Background readers on the shared io_service need it running to stop
+    for(std::size_t i = 0; i < ports.size(); ++i)
+        ports[i]->serial->close();
+    work.reset();
+    io_service.stop();
+    io_threads.join_all();
+
+    report(options, ports, elapsed, received, cpu_seconds);
+    for(std::size_t i = 0; i < ports.size(); ++i)
+        delete ports[i];
+    return 0;
+}
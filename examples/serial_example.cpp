@@ -21,10 +21,10 @@ int main(int argc, char **argv)
     
     int count = 0;
     while (count >= 0) {
-        int bytes_wrote = serial.write("Testing.");
-        std::string result = serial.read(8);
+        std::string result;
+        serial.transact("Testing.", result, serial::ResponseMatch::length(8));
         if(count % 10 == 0)
-            std::cout << ">" << count << ">" << bytes_wrote << ">" << result << std::endl;
+            std::cout << ">" << count << ">" << result.size() << ">" << result << std::endl;
         
         count += 1;
     }
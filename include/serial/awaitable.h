@@ -0,0 +1,338 @@
+/**
+ * @file awaitable.h
+ * @author  William Woodall <wjwwood@gmail.com>
+ * @author  John Harrison   <ash.gti@gmail.com>
+ * @version 0.1
+ * 
+ * @section LICENSE
+ * 
+ * The MIT License
+ * 
+ * Copyright (c) 2011 William Woodall
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ * 
+ * @section DESCRIPTION
+ * 
+ * This provides awaitable reads and writes of a Serial port for C++20 coroutines.
+ */
+
+
+#ifndef SERIAL_AWAITABLE_H
+#define SERIAL_AWAITABLE_H
+
+// Only available when compiling as C++20, or later, with coroutine support
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+
+#define SERIAL_HAS_COROUTINES 1
+
+#include <atomic>
+#include <coroutine>
+#include <string>
+#include <utility>
+
+#include <boost/asio/error.hpp>
+#include <boost/system/system_error.hpp>
+
+#include "serial/serial.h"
+
+namespace serial {
+
+namespace detail {
+
+/** The part of each awaiter which hands the result of an asynchronous operation back to the
+* coroutine awaiting it.
+* 
+* The coroutine is resumed by whichever thread runs the port's io_service when the
+* operation completes. If it completes before await_suspend() returns, e.g. with data which
+* was already buffered, the coroutine carries on without being suspended.
+*/
+class SerialAwaiter {
+public:
+    bool await_ready() const noexcept {
+        return false;
+    }
+protected:
+    explicit SerialAwaiter(boost::system::error_code* ec_out) : state(STARTING), ec_out(ec_out) {}
+    
+    SerialAwaiter(const SerialAwaiter&) = delete;
+    void operator=(const SerialAwaiter&) = delete;
+    
+    /** Called by await_suspend() once the operation is started.
+    * 
+    * @return false if it has already completed, so the coroutine is not suspended.
+    */
+    bool suspend() {
+        return this->state.exchange(SUSPENDED) != DONE;
+    }
+    
+    /** Called by the completion handler, the awaiter may be gone once this returns. */
+    void complete(const boost::system::error_code& error) {
+        this->error = error;
+        if(this->state.exchange(DONE) == SUSPENDED)
+            this->handle.resume();
+    }
+    
+    /** Called by await_resume(), reports the error to ec_out or throws it. */
+    void check() const {
+        if(this->ec_out != nullptr)
+            *this->ec_out = this->error;
+        else if(this->error)
+            throw boost::system::system_error(this->error);
+    }
+    
+    std::coroutine_handle<> handle;
+    boost::system::error_code error;
+private:
+    enum state_t { STARTING, SUSPENDED, DONE };
+    
+    std::atomic<int> state;
+    boost::system::error_code* ec_out;
+};
+
+class ReadAwaiter : public SerialAwaiter {
+public:
+    ReadAwaiter(Serial& port, char* buffer, size_t size, boost::system::error_code* ec_out)
+        : SerialAwaiter(ec_out), port(port), buffer(buffer), size(size), bytes_transferred(0) {}
+    
+    bool await_suspend(std::coroutine_handle<> handle) {
+        this->handle = handle;
+        this->port.async_read(this->buffer, this->size,
+                              [this](const boost::system::error_code& error, size_t bytes_transferred) {
+                                  this->bytes_transferred = bytes_transferred;
+                                  this->complete(error);
+                              });
+        return this->suspend();
+    }
+    
+    size_t await_resume() {
+        this->check();
+        return this->bytes_transferred;
+    }
+private:
+    Serial& port;
+    char* buffer;
+    size_t size;
+    size_t bytes_transferred;
+};
+
+class ReadUntilAwaiter : public SerialAwaiter {
+public:
+    ReadUntilAwaiter(Serial& port, const std::string& delim, size_t size, boost::system::error_code* ec_out)
+        : SerialAwaiter(ec_out), port(port), delim(delim), size(size) {}
+    
+    bool await_suspend(std::coroutine_handle<> handle) {
+        this->handle = handle;
+        this->port.async_read_until(this->delim,
+                                    [this](const boost::system::error_code& error, const std::string& data) {
+                                        this->data = data;
+                                        this->complete(error);
+                                    }, this->size);
+        return this->suspend();
+    }
+    
+    std::string await_resume() {
+        this->check();
+        return std::move(this->data);
+    }
+private:
+    Serial& port;
+    std::string delim;
+    size_t size;
+    std::string data;
+};
+
+class WriteAwaiter : public SerialAwaiter {
+public:
+    WriteAwaiter(Serial& port, const char* data, size_t length, boost::system::error_code* ec_out)
+        : SerialAwaiter(ec_out), port(port), data(data), length(length), bytes_transferred(0) {}
+    
+    bool await_suspend(std::coroutine_handle<> handle) {
+        this->handle = handle;
+        this->port.async_write(this->data, this->length,
+                               [this](const boost::system::error_code& error, size_t bytes_transferred) {
+                                   this->bytes_transferred = bytes_transferred;
+                                   this->complete(error);
+                               });
+        return this->suspend();
+    }
+    
+    size_t await_resume() {
+        this->check();
+        return this->bytes_transferred;
+    }
+private:
+    Serial& port;
+    const char* data;
+    size_t length;
+    size_t bytes_transferred;
+};
+
+// Writes the request, then reads the response from the write's completion handler
+class TransactAwaiter : public SerialAwaiter {
+public:
+    TransactAwaiter(Serial& port, const std::string& request, const ResponseMatch& match,
+                    boost::system::error_code* ec_out)
+        : SerialAwaiter(ec_out), port(port), request(request), match(match) {}
+    
+    bool await_suspend(std::coroutine_handle<> handle) {
+        this->handle = handle;
+        if(this->match.kind == ResponseMatch::FRAME) {
+            this->error = boost::asio::error::operation_not_supported;
+            return false;
+        }
+        this->port.async_write(this->request.data(), this->request.size(),
+                               [this](const boost::system::error_code& error, size_t) {
+                                   if(error)
+                                       this->complete(error);
+                                   else
+                                       this->read_response();
+                               });
+        return this->suspend();
+    }
+    
+    std::string await_resume() {
+        this->check();
+        return std::move(this->response);
+    }
+private:
+    void read_response() {
+        if(this->match.kind == ResponseMatch::LENGTH) {
+            this->response.resize(this->match.size);
+            this->port.async_read(&this->response[0], this->match.size,
+                                  [this](const boost::system::error_code& error, size_t bytes_transferred) {
+                                      this->response.resize(bytes_transferred);
+                                      this->complete(error);
+                                  });
+        } else {
+            this->port.async_read_until(this->match.delim,
+                                        [this](const boost::system::error_code& error, const std::string& data) {
+                                            this->response = data;
+                                            this->complete(error);
+                                        }, this->match.size);
+        }
+    }
+    
+    Serial& port;
+    std::string request;
+    ResponseMatch match;
+    std::string response;
+};
+
+} // namespace detail
+
+/** Reads size bytes from the port in a coroutine: co_await co_read(port, buffer, size).
+* 
+* Like Serial::async_read(), which it is made with, the coroutine is resumed by a thread
+* running the port's io_service, see Serial::getIoService(). Many ports can share one
+* io_service run by a small pool of threads, each serving whichever coroutines are ready.
+* Timeouts do not apply, Serial::cancel() ends the read with operation_aborted.
+* 
+* @param buffer A char[] of length >= size, it must remain valid until the read completes.
+* 
+* @return The co_await gives the number of bytes read.
+* 
+* @throw boost::system::system_error if reading fails.
+*/
+inline detail::ReadAwaiter co_read(Serial& port, char* buffer, size_t size) {
+    return detail::ReadAwaiter(port, buffer, size, nullptr);
+}
+
+/** Reads size bytes from the port in a coroutine, setting ec instead of throwing.
+* 
+* @see co_read(Serial&, char*, size_t)
+*/
+inline detail::ReadAwaiter co_read(Serial& port, char* buffer, size_t size, boost::system::error_code& ec) {
+    return detail::ReadAwaiter(port, buffer, size, &ec);
+}
+
+/** Reads until delim or size bytes in a coroutine: co_await co_read_until(port, "\n").
+* 
+* @return The co_await gives the data read, including the delimiter.
+* 
+* @throw boost::system::system_error if reading fails.
+* 
+* @see Serial::async_read_until() and co_read(Serial&, char*, size_t)
+*/
+inline detail::ReadUntilAwaiter co_read_until(Serial& port, const std::string& delim, size_t size = -1) {
+    return detail::ReadUntilAwaiter(port, delim, size, nullptr);
+}
+
+/** Reads until delim or size bytes in a coroutine, setting ec instead of throwing.
+* 
+* @see co_read_until(Serial&, const std::string&, size_t)
+*/
+inline detail::ReadUntilAwaiter co_read_until(Serial& port, const std::string& delim, size_t size,
+                                              boost::system::error_code& ec) {
+    return detail::ReadUntilAwaiter(port, delim, size, &ec);
+}
+
+/** Writes length bytes to the port in a coroutine: co_await co_write(port, data, length).
+* 
+* @param data A char[] with the data to be written, it must remain valid until the write
+*        completes.
+* 
+* @return The co_await gives the number of bytes written.
+* 
+* @throw boost::system::system_error if writing fails.
+* 
+* @see Serial::async_write() and co_read(Serial&, char*, size_t)
+*/
+inline detail::WriteAwaiter co_write(Serial& port, const char* data, size_t length) {
+    return detail::WriteAwaiter(port, data, length, nullptr);
+}
+
+/** Writes length bytes to the port in a coroutine, setting ec instead of throwing.
+* 
+* @see co_write(Serial&, const char*, size_t)
+*/
+inline detail::WriteAwaiter co_write(Serial& port, const char* data, size_t length, boost::system::error_code& ec) {
+    return detail::WriteAwaiter(port, data, length, &ec);
+}
+
+/** Writes a request and reads its response in a coroutine:
+* co_await co_transact(port, request, ResponseMatch::delimiter("\r\n")).
+* 
+* Unlike Serial::transact() there is no timeout, and ResponseMatch::frame() is not
+* supported, it fails with operation_not_supported.
+* 
+* @return The co_await gives the response.
+* 
+* @throw boost::system::system_error if writing or reading fails.
+* 
+* @see co_read(Serial&, char*, size_t)
+*/
+inline detail::TransactAwaiter co_transact(Serial& port, const std::string& request, const ResponseMatch& match) {
+    return detail::TransactAwaiter(port, request, match, nullptr);
+}
+
+/** Writes a request and reads its response in a coroutine, setting ec instead of throwing.
+* 
+* @see co_transact(Serial&, const std::string&, const ResponseMatch&)
+*/
+inline detail::TransactAwaiter co_transact(Serial& port, const std::string& request, const ResponseMatch& match,
+                                           boost::system::error_code& ec) {
+    return detail::TransactAwaiter(port, request, match, &ec);
+}
+
+} // namespace serial
+
+#endif
+
+#endif
@@ -0,0 +1,156 @@
+/**
+ * @file buffer_pool.h
+ * @author  William Woodall <wjwwood@gmail.com>
+ * @author  John Harrison   <ash.gti@gmail.com>
+ * @version 0.1
+ * 
+ * @section LICENSE
+ * 
+ * The MIT License
+ * 
+ * Copyright (c) 2011 William Woodall
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ * 
+ * @section DESCRIPTION
+ * 
+ * This provides a fixed-size, lock-free pool of reference counted receive buffers.
+ */
+
+
+
+
+#ifndef SERIAL_BUFFER_POOL_H
+#define SERIAL_BUFFER_POOL_H
+
+#include <exception>
+#include <cstddef>
+
+namespace serial {
+
+class BufferPool;
+
+/** A reference counted handle to a buffer from a BufferPool.
+* 
+* Copies share the buffer, which goes back to its pool when the last handle to it is
+* released or destroyed. Handles may be copied, released and destroyed on any thread, e.g.
+* a frame read on one thread can be passed to another one without copying or allocating.
+* The buffer stays valid even if the pool is destroyed first.
+*/
+class PooledBuffer {
+public:
+    /** Creates an empty handle. */
+    PooledBuffer();
+    
+    PooledBuffer(const PooledBuffer& other);
+    
+    PooledBuffer& operator=(const PooledBuffer& other);
+    
+    /** Destructor, releases the buffer. */
+    ~PooledBuffer();
+    
+    /** Gets whether the handle refers to a buffer. */
+    bool isValid() const;
+    
+    /** Gets the start of the buffer, or NULL if the handle is empty. */
+    char* data() const;
+    
+    /** Gets the number of bytes of data in the buffer. */
+    size_t size() const;
+    
+    /** Sets the number of bytes of data in the buffer, at most capacity(). */
+    void resize(size_t size);
+    
+    /** Gets the size of the buffer, which is the pool's buffer size. */
+    size_t capacity() const;
+    
+    /** Drops this handle's reference, leaving it empty. */
+    void release();
+private:
+    friend class BufferPool;
+    struct Block;
+    
+    explicit PooledBuffer(Block* block);
+    
+    Block* block;
+};
+
+/** A fixed number of equally sized buffers, allocated once when the pool is created.
+* 
+* acquire() and releasing a buffer are lock-free, so ports read on several threads do not
+* contend on the allocator, and memory use stays bounded however many frames are in flight.
+* A pool can be shared by several Serial ports, see Serial::setBufferPool().
+*/
+class BufferPool {
+public:
+    /** Allocates the pool's buffers.
+    * 
+    * @param buffer_size The size of each buffer in bytes.
+    * 
+    * @param count The number of buffers.
+    * 
+    * @throw std::bad_alloc
+    */
+    BufferPool(size_t buffer_size, size_t count);
+    
+    /** Destructor, buffers which are still in use are freed once they are released. */
+    ~BufferPool();
+    
+    /** Takes a buffer out of the pool.
+    * 
+    * @return A handle to a buffer with a size of zero, which is empty if every buffer is
+    *         in use.
+    */
+    PooledBuffer acquire();
+    
+    /** Gets the size of each buffer in bytes. */
+    size_t getBufferSize() const;
+    
+    /** Gets the number of buffers in the pool. */
+    size_t getCount() const;
+    
+    /** Gets the number of buffers which are not in use. */
+    size_t available() const;
+private:
+    friend class PooledBuffer;
+    struct Storage;
+    
+    BufferPool(const BufferPool&);
+    void operator=(const BufferPool&);
+    
+    Storage* storage;
+};
+
+class BufferPoolNotSetException : public std::exception {
+public:
+    virtual const char* what() const throw() {
+        return "No buffer pool has been set on the Serial Port";
+    }
+};
+
+class BufferPoolExhaustedException : public std::exception {
+public:
+    virtual const char* what() const throw() {
+        return "Every buffer of the buffer pool is in use";
+    }
+};
+
+} // namespace serial
+
+#endif
@@ -0,0 +1,159 @@
+/**
+ * @file capture.h
+ * @author  William Woodall <wjwwood@gmail.com>
+ * @author  John Harrison   <ash.gti@gmail.com>
+ * @version 0.1
+ * 
+ * @section LICENSE
+ * 
+ * The MIT License
+ * 
+ * Copyright (c) 2011 William Woodall
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ * 
+ * @section DESCRIPTION
+ * 
+ * This provides a memory-mapped log of the bytes a Serial port sends and receives.
+ */
+
+
+#ifndef SERIAL_CAPTURE_H
+#define SERIAL_CAPTURE_H
+
+#include <exception>
+#include <string>
+#include <stdint.h>
+
+#include <boost/scoped_ptr.hpp>
+
+// The size a capture file starts with, it doubles whenever it is full
+#ifndef DEFAULT_CAPTURE_SIZE
+#define DEFAULT_CAPTURE_SIZE (1 << 20)
+#endif
+
+namespace serial {
+
+enum capture_direction_t { CAPTURE_RX = 0, CAPTURE_TX = 1 };
+
+/** One record of a capture, see CaptureReader::next(). */
+struct CaptureRecord {
+    /** When the data was received or written, in nanoseconds since the Unix epoch. */
+    uint64_t timestamp;
+    capture_direction_t direction;
+    /** The data, which points into the mapped capture file. */
+    const char* data;
+    size_t size;
+};
+
+/** Appends timestamped records of the bytes a Serial port receives and sends to a file.
+* 
+* The file is memory mapped, so a record is a copy into the mapping instead of a system
+* call, and it is grown by doubling. What has been appended reaches the file even if the
+* process crashes afterwards, close() trims it to the records written. Records may be
+* appended from several threads. Install it on a port with Serial::setCapture().
+* 
+* The file starts with a 16 byte header, the 8 bytes "SERCAP\0\0" followed by the format
+* version and the header size as 32 bit integers. Each record is a 64 bit timestamp, the
+* 32 bit data size, the 16 bit direction and 16 reserved bits, followed by the data padded
+* to a multiple of 8 bytes. Integers are in the byte order of the machine which wrote them.
+*/
+class CaptureLog {
+public:
+    /** Creates the file, replacing any existing one.
+    * 
+    * @param path The path of the capture file.
+    * 
+    * @param initial_size The size in bytes the file is mapped with at first.
+    * 
+    * @throw boost::system::system_error
+    */
+    explicit CaptureLog(const std::string& path, size_t initial_size = DEFAULT_CAPTURE_SIZE);
+    
+    /** Destructor, closes the file. */
+    ~CaptureLog();
+    
+    /** Appends a record stamped with the current time, empty ones are skipped.
+    * 
+    * @throw boost::system::system_error if the file could not be grown. The record is
+    *        dropped and so are all later ones, as if close() had been called.
+    */
+    void append(capture_direction_t direction, const char* data, size_t size);
+    
+    /** Appends a record with the given timestamp, in nanoseconds since the Unix epoch. */
+    void append(capture_direction_t direction, uint64_t timestamp, const char* data, size_t size);
+    
+    /** Unmaps the file and cuts off the unused space at its end, later records are dropped.
+    * Called by the destructor. */
+    void close();
+    
+    /** Gets the number of bytes of the file used by the header and the records. */
+    uint64_t size() const;
+    
+    /** Gets the current time in nanoseconds since the Unix epoch, as used for timestamps. */
+    static uint64_t now();
+private:
+    CaptureLog(const CaptureLog&);
+    void operator=(const CaptureLog&);
+    
+    class CaptureLogImpl;
+    boost::scoped_ptr<CaptureLogImpl> pimpl;
+};
+
+/** Reads the records of a capture file written by CaptureLog, in the order they were
+* appended. The file is memory mapped, the records point into it. */
+class CaptureReader {
+public:
+    /** Opens a capture file.
+    * 
+    * @throw boost::system::system_error
+    * @throw CaptureFormatException if the file is not a capture.
+    */
+    explicit CaptureReader(const std::string& path);
+    
+    ~CaptureReader();
+    
+    /** Reads the next record.
+    * 
+    * @param record Set to the record, its data stays valid as long as the reader.
+    * 
+    * @return false at the end of the capture.
+    */
+    bool next(CaptureRecord& record);
+    
+    /** Goes back to the first record. */
+    void rewind();
+private:
+    CaptureReader(const CaptureReader&);
+    void operator=(const CaptureReader&);
+    
+    class CaptureReaderImpl;
+    boost::scoped_ptr<CaptureReaderImpl> pimpl;
+};
+
+class CaptureFormatException : public std::exception {
+public:
+    virtual const char* what() const throw() {
+        return "The file is not a serial capture";
+    }
+};
+
+} // namespace serial
+
+#endif
@@ -0,0 +1,165 @@
+/**
+ * @file checksum.h
+ * @author  William Woodall <wjwwood@gmail.com>
+ * @author  John Harrison   <ash.gti@gmail.com>
+ * @version 0.1
+ * 
+ * @section LICENSE
+ * 
+ * The MIT License
+ * 
+ * Copyright (c) 2011 William Woodall
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ * 
+ * @section DESCRIPTION
+ * 
+ * This provides the checksums which Serial can verify on received frames and append to sent ones.
+ */
+
+
+
+
+#ifndef SERIAL_CHECKSUM_H
+#define SERIAL_CHECKSUM_H
+
+#include <cstddef>
+#include <stdint.h>
+
+namespace serial {
+
+/** A checksum which ends each frame, see Serial::setChecksum().
+* 
+* Serial verifies and removes it from each frame the Framer extracts before read_frame()
+* returns it, and appends it to the payload of write_frame() before the Framer encodes it.
+*/
+class Checksum {
+public:
+    virtual ~Checksum() {}
+    
+    /** Gets the size of the checksum in bytes. */
+    virtual size_t size() const = 0;
+    
+    /** Computes the checksum of data.
+    * 
+    * @param out Set to the size() bytes of the checksum, in the order they are sent.
+    */
+    virtual void compute(const char* data, size_t length, char* out) const = 0;
+    
+    /** Checks that the last size() bytes of a frame are the checksum of the rest.
+    * 
+    * @return false if they are not, or if the frame is shorter than size().
+    */
+    virtual bool verify(const char* frame, size_t length) const;
+};
+
+/** The XOR of all bytes, as used by NMEA 0183 and many simple protocols. */
+class XorChecksum : public Checksum {
+public:
+    /**
+    * @param init The value the XOR starts from.
+    */
+    explicit XorChecksum(uint8_t init = 0);
+    
+    virtual size_t size() const;
+    virtual void compute(const char* data, size_t length, char* out) const;
+    
+    /** Computes the XOR of data. */
+    uint8_t checksum(const char* data, size_t length) const;
+private:
+    uint8_t init;
+};
+
+/** A table driven CRC-16 with any polynomial.
+* 
+* The defaults are CRC-16/CCITT-FALSE sent most significant byte first. CRC-16/MODBUS is
+* Crc16Checksum(0x8005, 0xFFFF, true, 0, true), the XMODEM CRC is Crc16Checksum(0x1021, 0).
+*/
+class Crc16Checksum : public Checksum {
+public:
+    /**
+    * @param polynomial The generator polynomial, without its x^16 term.
+    * 
+    * @param init The initial value of the CRC.
+    * 
+    * @param reflected Whether bytes are processed least significant bit first, which also
+    *        reflects the result.
+    * 
+    * @param xor_out The value the final CRC is XORed with.
+    * 
+    * @param little_endian Whether the CRC is sent least significant byte first.
+    */
+    explicit Crc16Checksum(uint16_t polynomial = 0x1021, uint16_t init = 0xFFFF, bool reflected = false,
+                           uint16_t xor_out = 0, bool little_endian = false);
+    
+    virtual size_t size() const;
+    virtual void compute(const char* data, size_t length, char* out) const;
+    
+    /** Computes the CRC of data. */
+    uint16_t checksum(const char* data, size_t length) const;
+private:
+    uint16_t table[256];
+    uint16_t init;
+    bool reflected;
+    uint16_t xor_out;
+    bool little_endian;
+};
+
+/** The CRC-32 of Ethernet, zlib and PNG, sent least significant byte first.
+* 
+* It is computed with PCLMULQDQ on x86 processors which support it, with the CRC32
+* instructions of ARMv8 when the compiler targets them, and with tables otherwise.
+*/
+class Crc32Checksum : public Checksum {
+public:
+    virtual size_t size() const;
+    virtual void compute(const char* data, size_t length, char* out) const;
+    
+    /** Continues a CRC over more data, like zlib's crc32().
+    * 
+    * @param crc The CRC of the data before, 0 to start a new one.
+    * 
+    * @return The CRC of all data so far.
+    */
+    static uint32_t update(uint32_t crc, const char* data, size_t length);
+};
+
+/** The CRC-32C (Castagnoli) of iSCSI and SCTP, sent least significant byte first.
+* 
+* It is computed with the CRC32 instruction of SSE4.2 on x86 processors which support it,
+* with the CRC32C instructions of ARMv8 when the compiler targets them, and with tables
+* otherwise.
+*/
+class Crc32cChecksum : public Checksum {
+public:
+    virtual size_t size() const;
+    virtual void compute(const char* data, size_t length, char* out) const;
+    
+    /** Continues a CRC over more data.
+    * 
+    * @param crc The CRC of the data before, 0 to start a new one.
+    * 
+    * @return The CRC of all data so far.
+    */
+    static uint32_t update(uint32_t crc, const char* data, size_t length);
+};
+
+} // namespace serial
+
+#endif
@@ -0,0 +1,191 @@
+/**
+ * @file framer.h
+ * @author  William Woodall <wjwwood@gmail.com>
+ * @author  John Harrison   <ash.gti@gmail.com>
+ * @version 0.1
+ * 
+ * @section LICENSE
+ * 
+ * The MIT License
+ * 
+ * Copyright (c) 2011 William Woodall
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ * 
+ * @section DESCRIPTION
+ * 
+ * This provides packet framing for data sent and received over a Serial port.
+ */
+
+
+#ifndef SERIAL_FRAMER_H
+#define SERIAL_FRAMER_H
+
+#include <exception>
+#include <string>
+#include <vector>
+
+#ifndef DEFAULT_MAX_FRAME_SIZE
+#define DEFAULT_MAX_FRAME_SIZE 65536
+#endif
+
+namespace serial {
+
+/** Splits the stream of bytes received on a Serial port into frames, and encodes frames to be sent.
+* 
+* A Framer is given the bytes which have been received but not yet consumed. It may keep
+* state between calls to extract(), e.g. how far it has already searched, because the data
+* always starts at the same position in the stream until a frame has been consumed or
+* reset() is called. Frames are decoded in place, so extracting them does not copy.
+*/
+class Framer {
+public:
+    virtual ~Framer() {}
+    
+    /** Looks for a complete frame at the start of the received data.
+    * 
+    * @param data The bytes received but not yet consumed, they may be modified in place
+    *        while decoding a frame.
+    * 
+    * @param size The number of bytes in data.
+    * 
+    * @param frame Set to the start of the decoded frame within data, or NULL if the
+    *        consumed bytes did not hold a frame.
+    * 
+    * @param frame_size Set to the size of the decoded frame.
+    * 
+    * @param discarded Set to true if the consumed bytes were invalid and discarded, or
+    *        false if they held a frame or were only skipped, e.g. an idle delimiter
+    *        between frames. Only discarded data counts as a framing error.
+    * 
+    * @return The number of bytes consumed, or zero if more data is needed.
+    */
+    virtual size_t extract(char* data, size_t size, const char*& frame, size_t& frame_size,
+                           bool& discarded) = 0;
+    
+    /** Encodes a frame to be written to the serial port.
+    * 
+    * @param data The payload of the frame.
+    * 
+    * @param size The size of the payload in bytes.
+    * 
+    * @param encoded A std::vector which the encoded frame is appended to.
+    * 
+    * @throw FrameTooLargeException
+    */
+    virtual void encode(const char* data, size_t size, std::vector<char>& encoded) const = 0;
+    
+    /** Discards any state kept between calls to extract(). */
+    virtual void reset() {}
+};
+
+/** Frames which end with a delimiter, e.g. lines of text ending in "\r\n". */
+class DelimiterFramer : public Framer {
+public:
+    /**
+    * @param delimiter The std::string which ends each frame, it is not part of the frame.
+    * 
+    * @param max_frame_size Data which grows beyond this size without a delimiter is discarded.
+    */
+    explicit DelimiterFramer(const std::string& delimiter, size_t max_frame_size = DEFAULT_MAX_FRAME_SIZE);
+    
+    virtual size_t extract(char* data, size_t size, const char*& frame, size_t& frame_size,
+                           bool& discarded);
+    virtual void encode(const char* data, size_t size, std::vector<char>& encoded) const;
+    virtual void reset();
+private:
+    std::string delimiter;
+    size_t max_frame_size;
+    size_t scanned;
+};
+
+/** Frames which start with their length as an unsigned integer of 1, 2 or 4 bytes. */
+class LengthPrefixFramer : public Framer {
+public:
+    /**
+    * @param prefix_size The size of the length prefix in bytes, 1, 2 or 4.
+    * 
+    * @param big_endian Whether the length prefix is sent most significant byte first.
+    * 
+    * @param max_frame_size Frames with a larger length are treated as corrupt and all
+    *        buffered data is discarded.
+    */
+    explicit LengthPrefixFramer(size_t prefix_size = 2, bool big_endian = true,
+                                size_t max_frame_size = DEFAULT_MAX_FRAME_SIZE);
+    
+    virtual size_t extract(char* data, size_t size, const char*& frame, size_t& frame_size,
+                           bool& discarded);
+    virtual void encode(const char* data, size_t size, std::vector<char>& encoded) const;
+private:
+    size_t prefix_size;
+    bool big_endian;
+    size_t max_frame_size;
+};
+
+/** SLIP framing as described in RFC 1055. */
+class SlipFramer : public Framer {
+public:
+    /**
+    * @param max_frame_size Data which grows beyond this size without an END byte is discarded.
+    */
+    explicit SlipFramer(size_t max_frame_size = DEFAULT_MAX_FRAME_SIZE);
+    
+    virtual size_t extract(char* data, size_t size, const char*& frame, size_t& frame_size,
+                           bool& discarded);
+    virtual void encode(const char* data, size_t size, std::vector<char>& encoded) const;
+    virtual void reset();
+private:
+    size_t max_frame_size;
+    size_t scanned;
+};
+
+/** Consistent Overhead Byte Stuffing, with each frame followed by a zero byte. */
+class CobsFramer : public Framer {
+public:
+    /**
+    * @param max_frame_size Data which grows beyond this size without a zero byte is discarded.
+    */
+    explicit CobsFramer(size_t max_frame_size = DEFAULT_MAX_FRAME_SIZE);
+    
+    virtual size_t extract(char* data, size_t size, const char*& frame, size_t& frame_size,
+                           bool& discarded);
+    virtual void encode(const char* data, size_t size, std::vector<char>& encoded) const;
+    virtual void reset();
+private:
+    size_t max_frame_size;
+    size_t scanned;
+};
+
+class FramerNotSetException : public std::exception {
+public:
+    virtual const char* what() const throw() {
+        return "No framer has been set on the Serial Port";
+    }
+};
+
+class FrameTooLargeException : public std::exception {
+public:
+    virtual const char* what() const throw() {
+        return "Frame is too large to be encoded by the framer";
+    }
+};
+
+} // namespace serial
+
+#endif
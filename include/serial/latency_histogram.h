@@ -0,0 +1,135 @@
+/**
+ * @file latency_histogram.h
+ * @author  William Woodall <wjwwood@gmail.com>
+ * @author  John Harrison   <ash.gti@gmail.com>
+ * @version 0.1
+ * 
+ * @section LICENSE
+ * 
+ * The MIT License
+ * 
+ * Copyright (c) 2011 William Woodall
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ * 
+ * @section DESCRIPTION
+ * 
+ * This provides a fixed bucket histogram of operation latencies.
+ */
+
+
+#ifndef SERIAL_LATENCY_HISTOGRAM_H
+#define SERIAL_LATENCY_HISTOGRAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace serial {
+
+/** A histogram of latencies in nanoseconds with logarithmic, fixed size buckets.
+* 
+* Like an HDR histogram every power of two is split into eight linear sub-buckets, so any
+* recorded value is known to within 12.5% while the whole histogram is a fixed array of
+* counters and recording a value is a few instructions with no allocation.
+*/
+class LatencyHistogram {
+public:
+    /** The number of sub-buckets each power of two is split into. */
+    static const size_t SUB_BUCKETS = 8;
+    
+    /** The number of buckets, enough for latencies of up to 2^40 ns (about 18 minutes). */
+    static const size_t BUCKETS = 39 * SUB_BUCKETS;
+    
+    /** Constructor, creates an empty histogram. */
+    LatencyHistogram();
+    
+    /** Adds a latency to the histogram.
+    * 
+    * @param nanoseconds The latency to be recorded, larger values go in the last bucket.
+    */
+    void record(uint64_t nanoseconds);
+    
+    /** Adds all of the values recorded in another histogram to this one.
+    * 
+    * @param other The LatencyHistogram to be added.
+    */
+    void add(const LatencyHistogram& other);
+    
+    /** Adds counts kept outside of a LatencyHistogram, e.g. in counters updated without a lock.
+    * 
+    * @param buckets BUCKETS counts, one for each bucket.
+    * 
+    * @param max The largest value counted in them.
+    */
+    void add(const uint64_t* buckets, uint64_t max);
+    
+    /** Removes all recorded values. */
+    void reset();
+    
+    /** Gets the number of values recorded.
+    * 
+    * @return The total count of all buckets.
+    */
+    uint64_t count() const;
+    
+    /** Gets the largest value recorded, exactly, not rounded to a bucket.
+    * 
+    * @return The maximum latency in nanoseconds, or zero if nothing was recorded.
+    */
+    uint64_t max() const;
+    
+    /** Gets the latency below which a given fraction of the recorded values fall.
+    * 
+    * @param fraction The fraction, between 0 and 1, e.g. 0.99 for the 99th percentile.
+    * 
+    * @return The upper bound of the bucket holding the percentile, in nanoseconds.
+    */
+    uint64_t percentile(double fraction) const;
+    
+    /** Gets the number of values recorded in a bucket.
+    * 
+    * @param bucket The index of the bucket, less than BUCKETS.
+    * 
+    * @return The count of the bucket.
+    */
+    uint64_t bucketCount(size_t bucket) const;
+    
+    /** Gets the smallest value which falls in a bucket.
+    * 
+    * @param bucket The index of the bucket, less than BUCKETS.
+    * 
+    * @return The lower bound of the bucket in nanoseconds.
+    */
+    static uint64_t bucketLowerBound(size_t bucket);
+    
+    /** Gets the index of the bucket a value falls in.
+    * 
+    * @param nanoseconds A latency.
+    * 
+    * @return The index of the bucket.
+    */
+    static size_t bucketIndex(uint64_t nanoseconds);
+private:
+    uint64_t buckets[BUCKETS];
+    uint64_t max_;
+};
+
+} // namespace serial
+
+#endif
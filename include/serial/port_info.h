@@ -0,0 +1,95 @@
+/**
+ * @file port_info.h
+ * @author  William Woodall <wjwwood@gmail.com>
+ * @author  John Harrison   <ash.gti@gmail.com>
+ * @version 0.1
+ * 
+ * @section LICENSE
+ * 
+ * The MIT License
+ * 
+ * Copyright (c) 2011 William Woodall
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ * 
+ * @section DESCRIPTION
+ * 
+ * This provides a list of the serial ports present on the system.
+ */
+
+
+#ifndef SERIAL_PORT_INFO_H
+#define SERIAL_PORT_INFO_H
+
+#include <string>
+#include <stdint.h>
+#include <vector>
+
+namespace serial {
+
+/** A serial port found by list_ports(). */
+struct PortInfo {
+    PortInfo() : vid(0), pid(0) {}
+    
+    /** The device to open, e.g. /dev/ttyUSB0 or COM3. */
+    std::string port;
+    /** A name which stays the same when the device is plugged in again, e.g.
+    * /dev/serial/by-id/usb-FTDI_FT232R_USB_UART_A900ABCD-if00-port0, or empty if there is
+    * none. Open it instead of port with Serial::setAutoReconnect(), since port can change
+    * when the device comes back. Windows keeps the COM name of a USB device, so the
+    * field is empty there. */
+    std::string by_id;
+    /** A human readable name, the USB product string where there is one. */
+    std::string description;
+    /** e.g. "USB VID:PID=0403:6001 SNR=A900ABCD", or empty if unknown. */
+    std::string hardware_id;
+    /** The USB vendor and product ids, 0 for other ports. */
+    uint16_t vid;
+    uint16_t pid;
+    /** The USB serial number and manufacturer strings, empty if there are none. */
+    std::string serial_number;
+    std::string manufacturer;
+};
+
+/** Lists the serial ports present on the system, sorted by port.
+* 
+* On Linux the ports are found in sysfs, leaving out the unused placeholders of the 8250
+* driver, and matched with their /dev/serial/by-id links. On Windows they are found with
+* SetupAPI. Elsewhere the callout devices in /dev are listed, with only port and
+* description filled in.
+* 
+* @return A std::vector of PortInfo, empty if there are no ports.
+*/
+std::vector<PortInfo> list_ports();
+
+/** Lists the USB serial ports of a particular device.
+* 
+* @param vid The USB vendor id.
+* 
+* @param pid The USB product id, 0 for any product of the vendor.
+* 
+* @param serial_number The USB serial number, empty for any.
+* 
+* @return The matching ports from list_ports().
+*/
+std::vector<PortInfo> find_ports(uint16_t vid, uint16_t pid = 0, const std::string& serial_number = "");
+
+} // namespace serial
+
+#endif
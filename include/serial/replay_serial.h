@@ -0,0 +1,165 @@
+/**
+ * @file replay_serial.h
+ * @author  William Woodall <wjwwood@gmail.com>
+ * @author  John Harrison   <ash.gti@gmail.com>
+ * @version 0.1
+ * 
+ * @section LICENSE
+ * 
+ * The MIT License
+ * 
+ * Copyright (c) 2011 William Woodall
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ * 
+ * @section DESCRIPTION
+ * 
+ * This provides a Serial look-alike which replays the data recorded by a CaptureLog.
+ */
+
+
+
+
+#ifndef SERIAL_REPLAY_SERIAL_H
+#define SERIAL_REPLAY_SERIAL_H
+
+#include <string>
+#include <vector>
+
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "serial/serial.h"
+
+namespace serial {
+
+/** Replays the data received in a capture file through the SerialStream interface of Serial.
+* 
+* Code written against a SerialStream& can be given a ReplaySerial instead of a Serial, to
+* test parsers with recorded traffic. The received data is delivered in the chunks it was
+* captured in and reads never wait, so replay runs as fast as the data can be consumed and
+* always gives the same results. When the capture is used up reads return
+* short, the way a Serial port with a timeout does when nothing arrives.
+* 
+* Written data is discarded. With follow_writes the data received after a write in the
+* capture is held back until at least as many bytes have been written to the ReplaySerial,
+* so a request/response parser only sees a response once it has sent its request.
+*/
+class ReplaySerial : public SerialStream {
+public:
+    /** Opens a capture file for replay.
+    * 
+    * @param path The path of a file written by CaptureLog.
+    * 
+    * @param follow_writes Whether received data waits for the writes before it.
+    * 
+    * @throw boost::system::system_error
+    * @throw CaptureFormatException
+    */
+    explicit ReplaySerial(const std::string& path, bool follow_writes = false);
+    
+    /** Destructor */
+    ~ReplaySerial();
+    
+    /** Gets whether the capture is open, which it always is. */
+    bool isOpen();
+    
+    /** Return the number of characters which can be read before more are replayed. */
+    size_t available();
+    
+    /** Gets whether all received data in the capture has been read. With follow_writes
+    * this is false while data is held back waiting for writes. */
+    bool atEnd();
+    
+    /** Starts the replay over from the beginning of the capture. */
+    void rewind();
+    
+    /** Gets the timestamp of the most recently replayed chunk of received data, in
+    * nanoseconds since the Unix epoch, or 0 if none has been replayed yet. */
+    uint64_t getTimestamp() const;
+    
+    // The overloads which only convert their arguments, and transact(), come from SerialStream
+    using SerialStream::read;
+    using SerialStream::read_until;
+    using SerialStream::read_frame;
+    using SerialStream::write;
+    
+    /** Read size bytes, see Serial::read(char*, int). */
+    int read(char* buffer, int size = 1);
+    
+    /** Read into a sequence of buffers, see Serial::read(const std::vector<boost::asio::mutable_buffer>&). */
+    size_t read(const std::vector<boost::asio::mutable_buffer>& buffers);
+    
+    /** Read until a delimiter is found or size bytes have been read, see Serial::read_until(std::string, size_t). */
+    std::string read_until(std::string delim, size_t size = -1);
+    
+    /** Read until any of several single byte delimiters is found, see Serial::read_until_any(). */
+    std::string read_until_any(const std::string& delims, size_t size = -1);
+    
+    /** Sets the BufferPool used by the PooledBuffer reads, see Serial::setBufferPool(). */
+    void setBufferPool(boost::shared_ptr<BufferPool> pool);
+    
+    /** Gets the BufferPool set with setBufferPool(). */
+    boost::shared_ptr<BufferPool> getBufferPool() const;
+    
+    /** Read until a delimiter into a pooled buffer, see Serial::read_until(PooledBuffer&, const std::string&, size_t). */
+    size_t read_until(PooledBuffer& buffer, const std::string& delim, size_t size = -1);
+    
+    /** Sets the Framer used by read_frame() and write_frame(), see Serial::setFramer(). */
+    void setFramer(boost::shared_ptr<Framer> framer);
+    
+    /** Gets the Framer set with setFramer(). */
+    boost::shared_ptr<Framer> getFramer() const;
+    
+    /** Sets the Checksum which ends each frame, see Serial::setChecksum(). */
+    void setChecksum(boost::shared_ptr<Checksum> checksum);
+    
+    /** Gets the Checksum set with setChecksum(). */
+    boost::shared_ptr<Checksum> getChecksum() const;
+    
+    /** Reads the next frame, see Serial::read_frame(const char*&, size_t&).
+    * 
+    * @throw FramerNotSetException
+    */
+    bool read_frame(const char*& frame, size_t& size);
+    
+    /** Reads the next frame into a pooled buffer, see Serial::read_frame(PooledBuffer&). */
+    bool read_frame(PooledBuffer& frame);
+    
+    /** Encodes a frame and writes it, see Serial::write_frame().
+    * 
+    * @throw FramerNotSetException
+    */
+    size_t write_frame(const char* data, size_t length);
+    
+    /** Discards data, counting it for follow_writes. */
+    int write(const char* data, int length);
+    
+    /** Discards data, counting it for follow_writes. */
+    size_t write(const std::vector<boost::asio::const_buffer>& buffers);
+private:
+    DISALLOW_COPY_AND_ASSIGN(ReplaySerial);
+    
+    class ReplaySerialImpl;
+    boost::scoped_ptr<ReplaySerialImpl> pimpl;
+};
+
+} // namespace serial
+
+#endif
@@ -3,23 +3,23 @@
  * @author  William Woodall <wjwwood@gmail.com>
  * @author  John Harrison   <ash.gti@gmail.com>
  * @version 0.1
- *
+ * 
  * @section LICENSE
- *
+ * 
  * The MIT License
- *
+ * 
  * Copyright (c) 2011 William Woodall
- *
+ * 
  * Permission is hereby granted, free of charge, to any person obtaining a copy
  * of this software and associated documentation files (the "Software"), to deal
  * in the Software without restriction, including without limitation the rights
  * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
  * copies of the Software, and to permit persons to whom the Software is
  * furnished to do so, subject to the following conditions:
- *
+ * 
  * The above copyright notice and this permission notice shall be included in
  * all copies or substantial portions of the Software.
- *
+ * 
  * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
  * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
  * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
@@ -27,9 +27,9 @@
  * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
  * THE SOFTWARE.
- *
+ * 
  * @section DESCRIPTION
- *
+ * 
  * This provides a cross platform interface for interacting with Serial Ports.
  */
 
@@ -37,15 +37,37 @@
 #ifndef SERIAL_H
 #define SERIAL_H
 
-#include <iostream>
-#include <sstream>
+#include <exception>
 #include <string>
+#include <stdint.h>
+#include <vector>
 
-#include <boost/asio.hpp>
-#include <boost/asio/serial_port.hpp>
-#include <boost/bind.hpp>
-#include <boost/thread.hpp>
+#include <boost/function.hpp>
 #include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/system/error_code.hpp>
+#include <boost/version.hpp>
+
+#include "serial/buffer_pool.h"
+#include "serial/capture.h"
+#include "serial/checksum.h"
+#include "serial/framer.h"
+#include "serial/latency_histogram.h"
+#include "serial/port_info.h"
+
+// Only references to these are used here, so the rest of boost::asio is left to serial.cpp
+namespace boost {
+namespace asio {
+#if BOOST_VERSION >= 106600
+class io_context;
+typedef io_context io_service;
+#else
+class io_service;
+#endif
+class mutable_buffer;
+class const_buffer;
+} // namespace asio
+} // namespace boost
 
 // A macro to disallow the copy constructor and operator= functions
 // This should be used in the private: declarations for a class
@@ -79,6 +101,15 @@
 #ifndef DEFAULT_FLOWCONTROL
 #define DEFAULT_FLOWCONTROL FLOWCONTROL_NONE
 #endif
+#ifndef DEFAULT_READ_BUFFER_SIZE
+#define DEFAULT_READ_BUFFER_SIZE 4096
+#endif
+#ifndef DEFAULT_RING_BUFFER_SIZE
+#define DEFAULT_RING_BUFFER_SIZE 65536
+#endif
+#ifndef DEFAULT_PIPELINE_DEPTH
+#define DEFAULT_PIPELINE_DEPTH 8
+#endif
 
 namespace serial {
 
@@ -88,8 +119,350 @@ enum parity_t { PARITY_NONE, PARITY_ODD, PARITY_EVEN };
 enum stopbits_t { STOPBITS_ONE, STOPBITS_ONE_POINT_FIVE, STOPBITS_TWO };
 enum flowcontrol_t { FLOWCONTROL_NONE, FLOWCONTROL_SOFTWARE, FLOWCONTROL_HARDWARE };
 
-class Serial {
+// Tracing CONSTANTS, see Serial::setTraceCallback()
+enum latency_t { LATENCY_READ, LATENCY_WRITE, LATENCY_READ_UNTIL };
+enum tracepoint_t { TRACE_READ_BEGIN, TRACE_READ_DATA, TRACE_READ_END,
+                    TRACE_READ_UNTIL_BEGIN, TRACE_READ_UNTIL_END,
+                    TRACE_WRITE_BEGIN, TRACE_WRITE_END };
+
+// Modem line CONSTANTS, see Serial::getModemLines()
+enum modemline_t { MODEM_CTS = 0x01, MODEM_DSR = 0x02, MODEM_RI = 0x04, MODEM_CD = 0x08,
+                   MODEM_ALL = 0x0F };
+
+/** The line settings of a port, applied together with Serial::setSettings(). */
+struct PortSettings {
+    explicit PortSettings(int baudrate = DEFAULT_BAUDRATE, bytesize_t bytesize = DEFAULT_BYTESIZE,
+                          parity_t parity = DEFAULT_PARITY, stopbits_t stopbits = DEFAULT_STOPBITS,
+                          flowcontrol_t flowcontrol = DEFAULT_FLOWCONTROL)
+        : baudrate(baudrate), bytesize(bytesize), parity(parity), stopbits(stopbits),
+          flowcontrol(flowcontrol) {}
+    
+    int baudrate;
+    bytesize_t bytesize;
+    parity_t parity;
+    stopbits_t stopbits;
+    flowcontrol_t flowcontrol;
+};
+
+/** A snapshot of the counters kept by a Serial object, see Serial::getStats(). */
+struct SerialStats {
+    /** Bytes received from the port, including those still buffered. */
+    uint64_t bytes_read;
+    /** Bytes written to the port, not counting those still in the write queue. */
+    uint64_t bytes_written;
+    /** Calls to read, read_until, read_frame and async_read(_until). */
+    uint64_t read_calls;
+    /** Calls to write and async_write, including queued writes. */
+    uint64_t write_calls;
+    /** Reads which stopped waiting for data because their timeout expired. */
+    uint64_t timeouts;
+    /** Reads which returned fewer bytes than were requested. */
+    uint64_t partial_reads;
+    /** System calls and reactor operations made to read or write data, approximate
+    * where the work is done by boost::asio. */
+    uint64_t syscalls;
+    /** The most bytes ever held in the background reader's ring buffer. */
+    uint64_t ring_high_water;
+    /** Times the background reader stopped reading because the ring buffer was full. */
+    uint64_t ring_overruns;
+    /** Frames discarded by the Framer as invalid or too large. */
+    uint64_t framing_errors;
+    /** Frames discarded because their Checksum did not match. */
+    uint64_t checksum_errors;
+    /** Times the port was opened again after its device went away, see
+    * Serial::setAutoReconnect(). */
+    uint64_t reconnects;
+    /** Records the CaptureLog could not take because its file could not be grown, after
+    * which it stops capturing, see Serial::setCapture(). */
+    uint64_t capture_errors;
+};
+
+/** How Serial::transact() finds the end of a response, made with one of the static members. */
+struct ResponseMatch {
+    enum kind_t { LENGTH, DELIMITER, FRAME };
+    
+    /** A response of exactly size bytes. */
+    static ResponseMatch length(size_t size);
+    
+    /** A response which ends with delim, like with read_until() at most size bytes are read. */
+    static ResponseMatch delimiter(const std::string& delim, size_t size = -1);
+    
+    /** A response which is one frame of the port's Framer, the requests are encoded with it
+    * as by write_frame(). */
+    static ResponseMatch frame();
+    
+    kind_t kind;
+    size_t size;
+    std::string delim;
+};
+
+/** The reading and writing interface of a serial stream, implemented by Serial and by
+* ReplaySerial. Code which parses a protocol can take a SerialStream& and be run against
+* a port or against recorded traffic. The overloads which only convert their arguments, and
+* transact(), are implemented once here on top of the virtual functions.
+* 
+* Serial documents how each function behaves on a port, ReplaySerial how it differs.
+*/
+class SerialStream {
 public:
+    virtual ~SerialStream() {}
+    
+    /** Gets whether the stream can be read and written. */
+    virtual bool isOpen() = 0;
+    
+    /** Gets the number of bytes which can be read without waiting. */
+    virtual size_t available() = 0;
+    
+    /** Read size bytes, see Serial::read(char*, int). */
+    virtual int read(char* buffer, int size = 1) = 0;
+    
+    /** Read size bytes into a std::string.
+    * 
+    * @param size An integer defining how many bytes to be read.
+    * 
+    * @return A std::string containing the data read.
+    * 
+    * @see read(char*, int)
+    */
+    std::string read(int size = 1);
+    
+    /** Read size bytes into a caller owned buffer.
+    * 
+    * @param buffer A uint8_t[] of length >= the size parameter to hold incoming data.
+    * 
+    * @param size The number of bytes to be read.
+    * 
+    * @return The number of bytes read.
+    * 
+    * @see read(char*, int)
+    */
+    size_t read(uint8_t* buffer, size_t size);
+    
+    /** Read size bytes into a reusable std::vector.
+    * The vector is resized in place to hold the data read, so once its capacity is
+    * large enough no allocations are made.
+    * 
+    * @param buffer A std::vector<uint8_t> which is replaced with the data read.
+    * 
+    * @param size The number of bytes to be read.
+    * 
+    * @return The number of bytes read.
+    */
+    size_t read(std::vector<uint8_t>& buffer, size_t size = 1);
+    
+    /** Read size bytes into a reusable std::string.
+    * The string is resized in place to hold the data read, so once its capacity is
+    * large enough no allocations are made.
+    * 
+    * @param buffer A std::string which is replaced with the data read.
+    * 
+    * @param size The number of bytes to be read.
+    * 
+    * @return The number of bytes read.
+    */
+    size_t read(std::string& buffer, size_t size = 1);
+    
+    /** Read into a sequence of buffers, see Serial::read(const std::vector<boost::asio::mutable_buffer>&). */
+    virtual size_t read(const std::vector<boost::asio::mutable_buffer>& buffers) = 0;
+    
+    /** Read until a single byte delimiter is found or size bytes have been read.
+    * 
+    * @param delim A char which marks the end of the data to be returned.
+    * 
+    * @param size The maximum number of bytes to be returned, defaults to no limit.
+    * 
+    * @return A std::string containing the data read, including the delimiter if found.
+    * 
+    * @see read_until(std::string, size_t)
+    */
+    std::string read_until(char delim, size_t size = -1);
+    
+    /** Read until a delimiter is found or size bytes have been read, see Serial::read_until(std::string, size_t). */
+    virtual std::string read_until(std::string delim, size_t size = -1) = 0;
+    
+    /** Read until any of several single byte delimiters is found, see Serial::read_until_any(). */
+    virtual std::string read_until_any(const std::string& delims, size_t size = -1) = 0;
+    
+    /** Sets the BufferPool used by the PooledBuffer reads, see Serial::setBufferPool(). */
+    virtual void setBufferPool(boost::shared_ptr<BufferPool> pool) = 0;
+    
+    /** Gets the BufferPool set with setBufferPool(). */
+    virtual boost::shared_ptr<BufferPool> getBufferPool() const = 0;
+    
+    /** Read up to size bytes into a buffer from the BufferPool.
+    * At most the pool's buffer size is read, otherwise this behaves like read(char*, int).
+    * 
+    * @param buffer A PooledBuffer which is replaced with the data read.
+    * 
+    * @param size The number of bytes to be read.
+    * 
+    * @return The number of bytes read.
+    * 
+    * @throw BufferPoolNotSetException
+    * @throw BufferPoolExhaustedException if no buffer is available, nothing is read.
+    */
+    size_t read(PooledBuffer& buffer, size_t size);
+    
+    /** Read until a delimiter into a pooled buffer, see Serial::read_until(PooledBuffer&, const std::string&, size_t). */
+    virtual size_t read_until(PooledBuffer& buffer, const std::string& delim, size_t size = -1) = 0;
+    
+    /** Sets the Framer used by read_frame() and write_frame(), see Serial::setFramer(). */
+    virtual void setFramer(boost::shared_ptr<Framer> framer) = 0;
+    
+    /** Gets the Framer set with setFramer(). */
+    virtual boost::shared_ptr<Framer> getFramer() const = 0;
+    
+    /** Sets the Checksum which ends each frame, see Serial::setChecksum(). */
+    virtual void setChecksum(boost::shared_ptr<Checksum> checksum) = 0;
+    
+    /** Gets the Checksum set with setChecksum(). */
+    virtual boost::shared_ptr<Checksum> getChecksum() const = 0;
+    
+    /** Reads the next frame, see Serial::read_frame(const char*&, size_t&).
+    * 
+    * @throw FramerNotSetException
+    */
+    virtual bool read_frame(const char*& frame, size_t& size) = 0;
+    
+    /** Reads one complete frame using the current Framer into a reusable std::string.
+    * 
+    * @param frame A std::string which is replaced with the frame.
+    * 
+    * @return A boolean which is false if no complete frame was received before the timeout.
+    * 
+    * @throw FramerNotSetException
+    */
+    bool read_frame(std::string& frame);
+    
+    /** Reads the next frame into a pooled buffer, see Serial::read_frame(PooledBuffer&). */
+    virtual bool read_frame(PooledBuffer& frame) = 0;
+    
+    /** Encodes a frame and writes it, see Serial::write_frame().
+    * 
+    * @throw FramerNotSetException
+    */
+    virtual size_t write_frame(const char* data, size_t length) = 0;
+    
+    /** Write length bytes, see Serial::write(const char*, int). */
+    virtual int write(const char* data, int length) = 0;
+    
+    /** Write a string.
+    * 
+    * @param data A std::string to be written, it may contain embedded null characters.
+    * 
+    * @return An integer representing the number of bytes written.
+    */
+    int write(const std::string& data);
+    
+    /** Write length bytes from buffer.
+    * 
+    * @param data A uint8_t[] with data to be written.
+    * 
+    * @param length The number of bytes to be written.
+    * 
+    * @return The number of bytes written.
+    */
+    size_t write(const uint8_t* data, size_t length);
+    
+    /** Write the contents of a std::vector.
+    * 
+    * @param data A std::vector<uint8_t> with data to be written.
+    * 
+    * @return The number of bytes written.
+    */
+    size_t write(const std::vector<uint8_t>& data);
+    
+    /** Write a sequence of buffers, see Serial::write(const std::vector<boost::asio::const_buffer>&). */
+    virtual size_t write(const std::vector<boost::asio::const_buffer>& buffers) = 0;
+    
+    /** Writes a request and reads its response.
+    * 
+    * The response must arrive within the timeout, see Serial::setTimeoutMilliseconds(). This
+    * is both a read and a write, so no other thread may read or write at the same time.
+    * 
+    * @param request The request, written as is or encoded by the Framer if match is a
+    *        ResponseMatch::frame().
+    * 
+    * @param response A std::string which is replaced with the response, or with what was
+    *        received of it before the timeout.
+    * 
+    * @param match How the end of the response is found.
+    * 
+    * @return true if a complete response was received.
+    * 
+    * @throw FramerNotSetException
+    */
+    bool transact(const std::string& request, std::string& response, const ResponseMatch& match);
+    
+    /** Writes a series of requests with up to depth of them waiting for their response.
+    * 
+    * Instead of idling for a round trip after each request, the first depth requests are
+    * sent in one write and every response received makes way for the next request, so the
+    * link stays busy. Responses must come back in the order of the requests. The device
+    * has to be able to buffer depth requests.
+    * 
+    * @param requests The requests, in the order they are sent.
+    * 
+    * @param responses A std::vector which is replaced with the responses, responses[i]
+    *        belongs to requests[i]. Its storage is reused between calls.
+    * 
+    * @param match How the end of each response is found.
+    * 
+    * @param depth The most requests waiting for a response at any time.
+    * 
+    * @return The number of responses received. Fewer than requests if a response did not
+    *         arrive within the timeout, those still due may arrive later and are then
+    *         left for the following reads.
+    * 
+    * @throw FramerNotSetException
+    */
+    size_t transact(const std::vector<std::string>& requests, std::vector<std::string>& responses,
+                    const ResponseMatch& match, size_t depth = DEFAULT_PIPELINE_DEPTH);
+protected:
+    /** Writes requests[begin] to requests[end - 1] for transact(), as a single gather write
+    * or, for a ResponseMatch::frame(), with one write_frame() each. Serial encodes the
+    * frames into one write instead.
+    */
+    virtual void write_requests(const std::vector<std::string>& requests, size_t begin, size_t end,
+                                const ResponseMatch& match);
+private:
+    bool read_response(std::string& response, const ResponseMatch& match);
+};
+
+/** A serial port, read and written synchronously or asynchronously.
+* 
+* Concurrency: one thread may read from a Serial while another writes to it. Reads are
+* read, read_until, read_frame, available, waitReadable and async_read(_until),
+* writes are write, write_frame, flush, waitWritable and async_write. The two sides keep
+* separate state and take no lock the other side holds, except that a read flushes the
+* write queue (see setWriteQueue) if it has data in it. getStats may be called from any
+* thread, and a trace callback is called on whichever thread reads or writes.
+* 
+* Everything else, opening, closing, changing settings or the framer and starting or
+* stopping the reader thread, must not run while a read or write is in progress. Two
+* threads must not both read, or both write, at the same time. On Windows this needs the
+* native backend (SERIAL_NATIVE_BACKEND), the boost::asio one cancels a read which times out
+* by canceling all I/O on the port, which would abort a write in progress.
+*/
+class Serial : public SerialStream {
+public:
+    /** Completion handler for async_read and async_write, called with the error (if any)
+    * and the number of bytes transferred. */
+    typedef boost::function<void (const boost::system::error_code&, size_t)> ReadHandler;
+    typedef boost::function<void (const boost::system::error_code&, size_t)> WriteHandler;
+    
+    /** Completion handler for async_read_until, called with the error (if any) and the
+    * data read, including the delimiter if found. */
+    typedef boost::function<void (const boost::system::error_code&, const std::string&)> ReadUntilHandler;
+    
+    /** Trace callback, called with the trace point, a monotonic timestamp in nanoseconds
+    * and the number of bytes transferred (zero at the *_BEGIN points). */
+    typedef boost::function<void (tracepoint_t, uint64_t, size_t)> TraceCallback;
+    
+    /** Modem line callback, called with the error (if any) and the state of the modem
+    * lines as a mask of modemline_t. */
+    typedef boost::function<void (const boost::system::error_code&, unsigned int)> ModemLinesCallback;
+    
     /** Constructor, Creates a Serial object but doesn't open the serial port. */
     Serial();
     
@@ -133,11 +506,47 @@ public:
            stopbits_t stopbits = DEFAULT_STOPBITS,
            flowcontrol_t flowcontrol = DEFAULT_FLOWCONTROL);
     
+    /** Constructor, creates a Serial object using a shared io_service but doesn't open the port.
+    * 
+    * Many Serial objects can share one io_service which is run by a small pool of threads
+    * owned by the caller, instead of each port having a reactor of its own. The io_service
+    * must outlive the Serial object. It must be running for asynchronous operations to
+    * complete, and for the reader thread (see startReaderThread) and the max_latency timer
+    * of the write queue (see setWriteQueue). Synchronous reads and writes do not need it on
+    * POSIX, where they read and write the port directly. Nor do they with the native
+    * Windows backend, but with boost::asio on Windows a synchronous read waits for its
+    * handler to be run by the io_service.
+    * 
+    * @param io_service A boost::asio::io_service which is run by the caller.
+    */
+    explicit Serial(boost::asio::io_service& io_service);
+    
+    /** Constructor, creates a Serial object using a shared io_service and opens the port.
+    * 
+    * @param io_service A boost::asio::io_service which is run by the caller.
+    * 
+    * @see Serial(boost::asio::io_service&) and Serial(std::string, int, long, bytesize_t,
+    *      parity_t, stopbits_t, flowcontrol_t) for the remaining parameters.
+    * 
+    * @throw SerialPortAlreadyOpenException
+    * @throw SerialPortFailedToOpenException
+    */
+    Serial(boost::asio::io_service& io_service,
+           std::string port,
+           int baudrate = DEFAULT_BAUDRATE,
+           long timeout = DEFAULT_TIMEOUT,
+           bytesize_t bytesize = DEFAULT_BYTESIZE,
+           parity_t parity = DEFAULT_PARITY,
+           stopbits_t stopbits = DEFAULT_STOPBITS,
+           flowcontrol_t flowcontrol = DEFAULT_FLOWCONTROL);
+    
     /** Destructor */
     ~Serial();
     
     /** 
     * Opens the serial port as long as the portname is set and the port isn't alreay open.
+    * Opening the port again without changing its name or settings puts back the driver
+    * configuration saved by the last open with one call, instead of applying each setting.
     * 
     * @throw SerialPortAlreadyOpenException
     * @throw SerialPortFailedToOpenException
@@ -153,6 +562,71 @@ public:
     /** Closes the serial port and terminates threads. */
     void close();
     
+    /** Starts a background thread which continuously reads from the serial port.
+    * The received data is stored in a lock-free ring buffer which read(), read_until()
+    * and available() are then served from, so no system calls are made by the reading
+    * thread while data is available. Only one thread may read from the Serial object
+    * while the reader thread is running. If the ring buffer is full the reader thread
+    * stops reading until there is room, leaving data in the OS buffer. When a shared io_service is used no thread is started, the
+    * ring buffer is filled by the threads running the io_service instead.
+    * 
+    * @param buffer_size The capacity of the ring buffer in bytes.
+    * 
+    * @throw SerialPortNotOpenException
+    */
+    void startReaderThread(size_t buffer_size = DEFAULT_RING_BUFFER_SIZE);
+    
+    /** Stops the background reader thread, if it is running.
+    * Data still held in the ring buffer remains available to subsequent reads.
+    */
+    void stopReaderThread();
+    
+    /** Gets the status of the background reader thread.
+    * 
+    * @return A boolean value that represents whether or not the reader thread is running.
+    */
+    bool isReaderThreadRunning() const;
+    
+    /** Gets the number of bytes which have been received but not yet read.
+    * Includes the bytes waiting in the driver's input queue (FIONREAD, or ClearCommError
+    * on Windows) as well as those already buffered by this object, no data is consumed.
+    * 
+    * @return The number of bytes that can be read without waiting.
+    */
+    size_t available();
+    
+    /** Waits until data can be read without blocking, without reading it.
+    * On Windows the native backend waits for EV_RXCHAR with WaitCommEvent, which ends a
+    * waitForModemChange running at the same time. With boost::asio on Windows the driver's
+    * input queue is polled every millisecond instead.
+    * 
+    * @param timeout The time to wait in milliseconds, zero only checks and a number less
+    *        than zero waits forever.
+    * 
+    * @return A boolean which is false if no data arrived before the timeout.
+    * 
+    * @throw SerialPortNotOpenException
+    */
+    bool waitReadable(long timeout);
+    
+    /** Waits until the port will accept more data without blocking.
+    * On Windows writes are buffered by the driver and this always returns true.
+    * 
+    * @param timeout The time to wait in milliseconds, zero only checks and a number less
+    *        than zero waits forever.
+    * 
+    * @return A boolean which is false if the port was still not writable at the timeout.
+    * 
+    * @throw SerialPortNotOpenException
+    */
+    bool waitWritable(long timeout);
+    
+    // The overloads which only convert their arguments, and transact(), come from SerialStream
+    using SerialStream::read;
+    using SerialStream::read_until;
+    using SerialStream::read_frame;
+    using SerialStream::write;
+    
     /** Read size bytes from the serial port.
     * If a timeout is set it may return less characters than requested. With no timeout
     * it will block until the requested number of bytes have been read.
@@ -165,61 +639,407 @@ public:
     */
     int read(char* buffer, int size = 1);
     
-    /** Read size bytes from the serial port.
-    * If a timeout is set it may return less characters than requested. With no timeout
-    * it will block until the requested number of bytes have been read.
+    /** Read from the serial port into a sequence of buffers, filling each one in turn.
+    * This allows e.g. the header and payload of a frame to be read directly into the
+    * fields of a message struct. The timeout applies to the whole call.
     * 
-    * @param size An integer defining how many bytes to be read.
+    * @param buffers A std::vector of boost::asio::mutable_buffer to hold incoming data.
     * 
-    * @return A std::string containing the data read.
+    * @return The number of bytes read, if less than the total size of the buffers a
+    *         timeout occured.
     */
-    std::string read(int size = 1);
+    size_t read(const std::vector<boost::asio::mutable_buffer>& buffers);
     
-    std::string read_until(char delim, size_t size = -1);
+    /** Read from the serial port until a delimiter is found or size bytes have been read.
+    * Data is pulled from the port in large chunks into an internal buffer, any bytes
+    * received after the delimiter are kept and returned by subsequent reads. If a timeout
+    * is set and it expires before the delimiter is found, the data received so far is
+    * returned. Without a timeout, including the non-blocking default of zero, it blocks
+    * until the delimiter is found or size bytes have been read.
+    * 
+    * @param delim A std::string which marks the end of the data to be returned.
+    * 
+    * @param size The maximum number of bytes to be returned, defaults to no limit.
+    * 
+    * @return A std::string containing the data read, including the delimiter if found.
+    */
     std::string read_until(std::string delim, size_t size = -1);
     
+    /** Read from the serial port until any one of several single byte delimiters is found,
+    * e.g. "\r\n" for a protocol whose lines may end in either, or size bytes have been read.
+    * Otherwise this behaves like read_until(std::string, size_t). Use std::string(1, '\0') or a
+    * length when a NUL byte is one of the delimiters.
+    * 
+    * @param delims A std::string in which each byte is a delimiter.
+    * 
+    * @param size The maximum number of bytes to be returned, defaults to no limit.
+    * 
+    * @return A std::string containing the data read, including the delimiter if found.
+    */
+    std::string read_until_any(const std::string& delims, size_t size = -1);
+    
+    /** Sets the BufferPool which the PooledBuffer overloads of read(), read_until() and
+    * read_frame() take their buffers from. Received data is copied once from the internal
+    * receive buffer into a pooled buffer, which can then be handed to another thread
+    * without allocating. A pool may be shared by several ports.
+    * 
+    * @param pool A boost::shared_ptr to a BufferPool, or an empty pointer to remove it.
+    */
+    void setBufferPool(boost::shared_ptr<BufferPool> pool);
+    
+    /** Gets the BufferPool set with setBufferPool(). */
+    boost::shared_ptr<BufferPool> getBufferPool() const;
+    
+    /** Read until a delimiter is found or size bytes have been read into a buffer from the
+    * BufferPool. The size is limited to the pool's buffer size, otherwise this behaves
+    * like read_until(std::string, size_t).
+    * 
+    * @param buffer A PooledBuffer which is replaced with the data read.
+    * 
+    * @param delim A std::string which marks the end of the data to be returned.
+    * 
+    * @param size The maximum number of bytes to be returned, defaults to no limit.
+    * 
+    * @return The number of bytes read, including the delimiter if found.
+    * 
+    * @throw BufferPoolNotSetException
+    * @throw BufferPoolExhaustedException if no buffer is available, nothing is read.
+    */
+    size_t read_until(PooledBuffer& buffer, const std::string& delim, size_t size = -1);
+    
+    /** Sets the Framer used by read_frame() and write_frame().
+    * 
+    * @param framer A boost::shared_ptr to a Framer, e.g. a CobsFramer, or an empty
+    *        pointer to remove the current one.
+    */
+    void setFramer(boost::shared_ptr<Framer> framer);
+    
+    /** Gets the Framer used by read_frame() and write_frame().
+    * 
+    * @return A boost::shared_ptr to the current Framer, which is empty if none is set.
+    */
+    boost::shared_ptr<Framer> getFramer() const;
+    
+    /** Sets the Checksum which ends each frame of read_frame() and write_frame().
+    * Received frames whose checksum does not match are skipped and counted as checksum
+    * errors, the checksum is removed from those returned. write_frame() and transact()
+    * append it to the payload before the Framer encodes it.
+    * 
+    * @param checksum A boost::shared_ptr to a Checksum, e.g. a Crc16Checksum, or an
+    *        empty pointer to send and receive frames without one.
+    */
+    void setChecksum(boost::shared_ptr<Checksum> checksum);
+    
+    /** Gets the Checksum used by read_frame() and write_frame().
+    * 
+    * @return A boost::shared_ptr to the current Checksum, which is empty if none is set.
+    */
+    boost::shared_ptr<Checksum> getChecksum() const;
+    
+    /** Reads one complete frame using the current Framer.
+    * The frame is decoded in place in the internal receive buffer and is not copied, it
+    * remains valid until the next read from this Serial object. Bytes which the Framer
+    * rejects and frames whose Checksum does not match are skipped. The timeout applies to
+    * the whole call.
+    * 
+    * @param frame Set to the start of the frame.
+    * 
+    * @param size Set to the size of the frame in bytes.
+    * 
+    * @return A boolean which is false if no complete frame was received before the timeout.
+    * 
+    * @throw FramerNotSetException
+    */
+    bool read_frame(const char*& frame, size_t& size);
+    
+    /** Reads one complete frame using the current Framer into a buffer from the BufferPool.
+    * Frames larger than the pool's buffer size are skipped and counted as framing errors.
+    * 
+    * @param frame A PooledBuffer which is replaced with the frame.
+    * 
+    * @return A boolean which is false if no complete frame was received before the timeout.
+    * 
+    * @throw FramerNotSetException
+    * @throw BufferPoolNotSetException
+    * @throw BufferPoolExhaustedException if no buffer is available, nothing is read.
+    */
+    bool read_frame(PooledBuffer& frame);
+    
+    /** Encodes data as a frame using the current Framer and writes it to the serial port.
+    * The Checksum, if one is set, is appended to the payload first.
+    * 
+    * @param data A char[] with the payload of the frame.
+    * 
+    * @param length The size of the payload in bytes.
+    * 
+    * @return The number of bytes written, including the framing overhead.
+    * 
+    * @throw FramerNotSetException
+    * @throw FrameTooLargeException
+    */
+    size_t write_frame(const char* data, size_t length);
+    
+    /** Starts an asynchronous read of size bytes from the serial port.
+    * The handler is called from the io_service (see getIoService()) once size bytes have
+    * been read, an error occurs or the read is canceled. Timeouts do not apply to
+    * asynchronous operations, use cancel() instead. Asynchronous reads are not supported
+    * while the background reader thread is running.
+    * 
+    * @param buffer A char[] of length >= the size parameter, it must remain valid until
+    *        the handler is called.
+    * 
+    * @param size The number of bytes to be read.
+    * 
+    * @param handler A ReadHandler to be called when the read completes.
+    */
+    void async_read(char* buffer, size_t size, ReadHandler handler);
+    
+    /** Starts an asynchronous read until a delimiter is found or size bytes have been read.
+    * Uses the same internal buffer as read_until, so leftover bytes are kept for the next read.
+    * 
+    * @param delim A std::string which marks the end of the data to be returned.
+    * 
+    * @param handler A ReadUntilHandler to be called when the read completes.
+    * 
+    * @param size The maximum number of bytes to be returned, defaults to no limit.
+    * 
+    * @see async_read(char*, size_t, ReadHandler)
+    */
+    void async_read_until(const std::string& delim, ReadUntilHandler handler, size_t size = -1);
+    
+    /** Starts an asynchronous write of length bytes to the serial port.
+    * 
+    * @param data A char[] with data to be written to the serial port, it must remain valid
+    *        until the handler is called.
+    * 
+    * @param length The number of bytes to be written.
+    * 
+    * @param handler A WriteHandler to be called when the write completes.
+    */
+    void async_write(const char* data, size_t length, WriteHandler handler);
+    
+    /** Cancels all outstanding asynchronous operations, their handlers are called with
+    * boost::asio::error::operation_aborted. A waitForChange() in progress returns false. */
+    void cancel();
+    
+    /** Gets the io_service which asynchronous operations are completed on.
+    * Handlers are only called while the io_service is being run, e.g. by calling
+    * run_one() or poll() on it. This is the shared io_service if one was given to
+    * the constructor, otherwise the port's own io_service which is created when the
+    * port is first opened or this is first called.
+    * 
+    * @return A reference to the boost::asio::io_service used by this serial port.
+    */
+    boost::asio::io_service& getIoService();
+    
     /** Write length bytes from buffer to the serial port.
     * 
     * @param data A char[] with data to be written to the serial port.
     * 
     * @param length An integer representing the number of bytes to be written.
     * 
-    * @return An integer representing the number of bytes written.
+    * @return An integer representing the number of bytes written, or queued if
+    *         queued writes are enabled.
+    * 
+    * @see setWriteQueue(size_t, long)
+    */
+    int write(const char* data, int length);
+    
+    /** Write a sequence of buffers to the serial port as a single gather write.
+    * This lets e.g. a header, payload and CRC be sent without first copying them
+    * into one contiguous buffer.
+    * 
+    * @param buffers A std::vector of boost::asio::const_buffer to be written.
+    * 
+    * @return The number of bytes written, or queued if queued writes are enabled.
+    */
+    size_t write(const std::vector<boost::asio::const_buffer>& buffers);
+    
+    /** Enables queued writes, which coalesce many small writes into fewer system calls.
+    * While enabled write() copies the data into a queue and returns immediately, the queue
+    * is written to the port in one call once it holds flush_threshold bytes, max_latency
+    * milliseconds after the oldest queued byte was written, before any read from the port
+    * or when flush() is called. The max_latency timer runs on the io_service, so without
+    * a background reader or a shared io_service it is only checked on the next write.
+    * 
+    * @param flush_threshold The number of queued bytes which causes the queue to be written,
+    *        zero disables queued writes and writes anything still queued.
+    * 
+    * @param max_latency The longest time (in milliseconds) data may stay queued, zero for
+    *        no limit.
+    */
+    void setWriteQueue(size_t flush_threshold, long max_latency = 0);
+    
+    /** Writes any data held in the write queue to the serial port.
+    * 
+    * @return The number of bytes written.
     */
-    int write(char data[], int length);
+    size_t flush();
     
-    /** Write a string to the serial port.
+    /** Gets the statistics counters of this serial port.
+    * The counters are relaxed atomics, so they are cheap enough to always be kept and can
+    * be read from any thread while the port is in use.
     * 
-    * @param data A std::string to be written to the serial port. (must be null terminated)
+    * @return A SerialStats holding the current value of every counter.
+    */
+    SerialStats getStats() const;
+    
+    /** Sets all of the statistics counters back to zero. */
+    void resetStats();
+    
+    /** Gets whether the library was built with SERIAL_ENABLE_TRACING.
+    * Without it latency histograms are never recorded and trace callbacks are never
+    * called, the tracing code is compiled out of the read and write paths entirely.
     * 
-    * @return An integer representing the number of bytes written to the serial port.
+    * @return A boolean value that represents whether or not tracing is available.
     */
-    int write(std::string data);
+    static bool isTracingEnabled();
+    
+    /** Sets a callback which is called at each trace point of the read and write paths.
+    * TRACE_READ_BEGIN and TRACE_READ_END bracket read(), TRACE_READ_UNTIL_BEGIN and
+    * TRACE_READ_UNTIL_END bracket read_until() and TRACE_WRITE_BEGIN and TRACE_WRITE_END
+    * bracket write(). TRACE_READ_DATA is called every time data is received from the port,
+    * including by the background reader thread and asynchronous reads, so the callback must
+    * be thread safe if either is used. The callback should be set before the port is in use,
+    * and it should not block since it runs on the read and write paths.
+    * 
+    * @param callback A TraceCallback, or an empty one to stop tracing.
+    */
+    void setTraceCallback(TraceCallback callback);
+    
+    /** Gets a copy of the latency histogram of an operation.
+    * The latency is measured from entering to returning from read(), write() or
+    * read_until(), in nanoseconds. The histogram is empty if isTracingEnabled() is false.
+    * Latencies are recorded without a lock, so a copy taken while the port is in use may
+    * miss those still being recorded.
+    * 
+    * @param operation The operation, one of LATENCY_READ, LATENCY_WRITE or LATENCY_READ_UNTIL.
+    * 
+    * @return A LatencyHistogram of the latencies recorded since the last reset.
+    */
+    LatencyHistogram getLatencyHistogram(latency_t operation) const;
+    
+    /** Removes all recorded values from the latency histograms. */
+    void resetLatencyHistograms();
+    
+    /** Sets a CaptureLog which receives a timestamped copy of all data read from and written
+    * to the port. Data is recorded as it is received from or written to the port, including
+    * by the background reader thread and asynchronous operations, and queued writes when
+    * they are flushed. The capture can be read back with CaptureReader or replayed with
+    * ReplaySerial. It should be set before the port is in use.
+    * 
+    * Capturing never fails a read or write. If the capture file cannot be grown, the record
+    * is dropped and counted in SerialStats::capture_errors, and the CaptureLog stops.
+    * 
+    * @param capture A CaptureLog, or an empty pointer to stop capturing.
+    */
+    void setCapture(boost::shared_ptr<CaptureLog> capture);
+    
+    /** Gets the CaptureLog set with setCapture(). */
+    boost::shared_ptr<CaptureLog> getCapture() const;
     
     /** Sets the logic level of the RTS line.
     * 
     * @param level The logic level to set the RTS to. Defaults to true.
+    * 
+    * @throw SerialPortNotOpenException
+    * @throw boost::system::system_error
     */
     void setRTS(bool level = true);
     
     /** Sets the logic level of the DTR line.
     * 
     * @param level The logic level to set the DTR to. Defaults to true.
+    * 
+    * @throw SerialPortNotOpenException
+    * @throw boost::system::system_error
     */
     void setDTR(bool level = true);
     
     /** Gets the status of the CTS line.
     * 
     * @return A boolean value that represents the current logic level of the CTS line.
+    * 
+    * @throw SerialPortNotOpenException
+    * @throw boost::system::system_error
     */
     bool getCTS() const;
     
     /** Gets the status of the DSR line.
     * 
     * @return A boolean value that represents the current logic level of the DSR line.
+    * 
+    * @throw SerialPortNotOpenException
+    * @throw boost::system::system_error
     */
     bool getDSR() const;
     
+    /** Gets the status of the RI (ring indicator) line.
+    * 
+    * @return A boolean value that represents the current logic level of the RI line.
+    * 
+    * @throw SerialPortNotOpenException
+    * @throw boost::system::system_error
+    */
+    bool getRI() const;
+    
+    /** Gets the status of the CD (carrier detect) line.
+    * 
+    * @return A boolean value that represents the current logic level of the CD line.
+    * 
+    * @throw SerialPortNotOpenException
+    * @throw boost::system::system_error
+    */
+    bool getCD() const;
+    
+    /** Gets the status of all modem lines with a single call.
+    * 
+    * @return A mask of MODEM_CTS, MODEM_DSR, MODEM_RI and MODEM_CD for the lines which are set.
+    * 
+    * @throw SerialPortNotOpenException
+    * @throw boost::system::system_error
+    */
+    unsigned int getModemLines() const;
+    
+    /** Blocks until one of the given modem lines changes.
+    * The wait is done by the driver (TIOCMIWAIT on Linux, WaitCommEvent on Windows) and uses
+    * no CPU, where the driver cannot wait the lines are polled. Timeouts do not apply, the
+    * wait ends when cancel() or close() is called. Only one thread can wait at a time, and
+    * not while the modem monitor is running.
+    * 
+    * On POSIX systems a TIOCMIWAIT wait is canceled by sending SIGURG to the waiting thread,
+    * so the first wait installs a handler for it if the signal has the default disposition.
+    * If the application ignores, blocks or handles SIGURG itself the lines are polled every
+    * 10 milliseconds instead, as they are when the library is built with
+    * SERIAL_MODEM_WAKEUP_SIGNAL defined as 0. SERIAL_MODEM_WAKEUP_SIGNAL also selects
+    * another signal.
+    * 
+    * @param lines A mask of modemline_t, defaults to all of them.
+    * 
+    * @return A boolean which is false if the wait was canceled.
+    * 
+    * @throw SerialPortNotOpenException
+    * @throw boost::system::system_error
+    */
+    bool waitForChange(unsigned int lines = MODEM_ALL);
+    
+    /** Starts a thread which calls the callback with the new state of the modem lines each
+    * time one of the given lines changes.
+    * If waiting fails the callback is called once with the error and the monitor stops.
+    * Does nothing if the monitor is already running.
+    * 
+    * @param callback A ModemLinesCallback, called from the monitor thread.
+    * 
+    * @param lines A mask of modemline_t, defaults to all of them.
+    * 
+    * @throw SerialPortNotOpenException
+    */
+    void startModemMonitor(ModemLinesCallback callback, unsigned int lines = MODEM_ALL);
+    
+    /** Stops the modem monitor thread, if it is running. It must not be called from the
+    * callback. */
+    void stopModemMonitor();
+    
     /** Sets the serial port identifier.
     * 
     * @param port A std::string containing the address of the serial port,
@@ -238,6 +1058,10 @@ public:
     
     /** Sets the timeout for reads in seconds.
     * 
+    * On POSIX systems synchronous reads are done directly on the port's descriptor, only
+    * calling poll() with the remaining timeout when no data is available, so non-blocking
+    * reads are a single system call and no timers are used.
+    * 
     * @param timeout A long that represents the time (in milliseconds) until a 
     *        timeout on reads occur.  Setting this to zero (0) will cause reading
     *        to be non-blocking, i.e. the available data will be returned immediately,
@@ -258,8 +1082,30 @@ public:
     */
     long getTimeoutMilliseconds() const;
     
+    /** Sets the baud rate, byte size, parity, stop bits and flow control together.
+    * 
+    * If the port is open they are applied at once, without reopening it, with a single
+    * ioctl(TCSETS2) on Linux, tcsetattr() elsewhere on POSIX (followed by IOSSIOSPEED for a
+    * custom rate on macOS) and SetCommState() on Windows. Otherwise they are applied when
+    * it is opened. Either all of the settings change or none of them do.
+    * 
+    * @throw InvalidBytesizeException, InvalidParityException, InvalidStopbitsException,
+    *        InvalidFlowcontrolException
+    * @throw boost::system::system_error if the open port rejects the settings, e.g.
+    *        STOPBITS_ONE_POINT_FIVE on POSIX.
+    */
+    void setSettings(const PortSettings& settings);
+    
+    /** Gets the baud rate, byte size, parity, stop bits and flow control. */
+    PortSettings getSettings() const;
+    
     /** Sets the baudrate for the serial port.
     * 
+    * Rates other than the standard ones, e.g. 250000 for DMX, are set with termios2 on
+    * Linux and IOSSIOSPEED on macOS, if the driver supports them. Like the other settings
+    * the rate is applied at once if the port is open, see setSettings(), and otherwise
+    * when it is opened.
+    * 
     * @param baudrate An integer that sets the baud rate for the serial port.
     */
     void setBaudrate(int baudrate);
@@ -343,103 +1189,173 @@ public:
     * @throw InvalidFlowcontrolException
     */
     flowcontrol_t getFlowcontrol() const;
-private:
-    DISALLOW_COPY_AND_ASSIGN(Serial);
-    void init();
-    void read_complete(const boost::system::error_code& error, std::size_t bytes_transferred);
-    void timeout_callback(const boost::system::error_code& error);
     
-    boost::asio::io_service io_service;
+    /** Enables or disables the low latency profile of the port's driver.
+    * On Linux this sets ASYNC_LOW_LATENCY and, where the driver exposes them in sysfs, lowers
+    * the latency timer of FTDI adapters to 1 ms and the receive FIFO trigger of 16550 class
+    * UARTs to one byte, which usually needs write access to sysfs. Each step is best effort.
+    * The setting is applied again whenever the port is opened, and the previous driver
+    * settings are restored when it is disabled or the port is closed. Other systems ignore it.
+    * 
+    * @param enable Whether to use the low latency profile. Defaults to true.
+    * 
+    * @return A boolean which is true if any of the driver's settings were changed.
+    */
+    bool setLowLatency(bool enable = true);
     
-    boost::asio::io_service::work work;
+    /** Gets whether the low latency profile is enabled.
+    * 
+    * @see Serial::setLowLatency
+    */
+    bool getLowLatency() const;
     
-    boost::scoped_ptr<boost::asio::serial_port> serial_port;
+    /** Sets how long a blocking read keeps checking the port before it goes to sleep.
+    * Spinning avoids the wakeup latency of the reactor at the cost of a busy CPU, which can
+    * bring round trips below a millisecond. It applies to read(), read_until() and read_frame()
+    * while the background reader thread is not running, and not to the boost::asio backend
+    * on Windows.
+    * 
+    * @param microseconds The time to spin in each read, zero (the default) never spins.
+    */
+    void setBusyPoll(long microseconds);
     
-    boost::asio::deadline_timer timeout_timer;
+    /** Gets the time a blocking read spins before it goes to sleep, in microseconds.
+    * 
+    * @see Serial::setBusyPoll
+    */
+    long getBusyPoll() const;
+    
+    /** Sets whether the port is opened again when its device goes away, e.g. when a USB
+    * adapter is unplugged and plugged back in.
+    * 
+    * A read or write which finds the device gone waits for it to come back, for as long as
+    * its timeout allows: forever if reads block, not at all if they do not. The wait is
+    * woken by inotify on Linux and kqueue on macOS and the BSDs instead of polling. The
+    * device is opened on the port's existing descriptor and given the settings saved when
+    * the port was opened with a single call, so the read or write carries on where it was,
+    * as does a second thread using the port and a SerialSelector. A write is sent again in
+    * full, since what reached the old device is lost. Open a name which survives replugging,
+    * such as PortInfo::by_id, since the device name itself can change.
+    * 
+    * Only synchronous reads and writes reconnect, not the background reader thread or
+    * asynchronous operations. This needs the native backend on a POSIX system, because
+    * boost::asio::serial_port can not take over a new descriptor while another thread may
+    * be using its old one.
+    * 
+    * @param enable Whether to reconnect.
+    * 
+    * @return false if this build does not support it, the setting is then left off.
+    */
+    bool setAutoReconnect(bool enable);
+    
+    /** Gets whether the port reconnects when its device goes away.
+    * 
+    * @see Serial::setAutoReconnect
+    */
+    bool getAutoReconnect() const;
+private:
+    DISALLOW_COPY_AND_ASSIGN(Serial);
+    
+    // Encodes all of the frames into one buffer, so they go out in a single write
+    void write_requests(const std::vector<std::string>& requests, size_t begin, size_t end,
+                        const ResponseMatch& match);
     
-    std::string port;
-    boost::asio::serial_port_base::baud_rate baudrate;
-    boost::posix_time::time_duration timeout;
-    boost::asio::serial_port_base::character_size bytesize;
-    boost::asio::serial_port_base::parity parity;
-    boost::asio::serial_port_base::stop_bits stopbits;
-    boost::asio::serial_port_base::flow_control flowcontrol;
+    // SerialSelector waits on the port's native handle, which it tells apart from a reused
+    // one by the number of times the port has been opened, and checks for buffered data
+    friend class SerialSelector;
+    bool getSelectHandle(intptr_t& handle, unsigned long& generation) const;
+    size_t getBufferedSize() const;
     
-    int bytes_read;
-    int bytes_to_read;
-    bool reading;
-    bool nonblocking;
+    // Told about the native handle just before the port closes or replaces it, while it
+    // still refers to the old device. Listeners are held weakly and may go away first.
+    class HandleListener {
+    public:
+        virtual ~HandleListener() {}
+        virtual void closing(intptr_t handle) = 0;
+    };
+    void addHandleListener(const boost::shared_ptr<HandleListener>& listener);
+    void removeHandleListener(const HandleListener* listener);
+    
+    // All of the state is kept in the SerialImpl, which is defined in serial.cpp so that
+    // including this header does not pull in boost::asio, boost::thread or boost::lockfree
+    class SerialImpl;
+    boost::scoped_ptr<SerialImpl> pimpl;
 };
 
 class SerialPortAlreadyOpenException : public std::exception {
-    const char * port;
+    std::string e_what_;
+public:
+    SerialPortAlreadyOpenException(const char * port);
+    virtual ~SerialPortAlreadyOpenException() throw() {}
+    
+    virtual const char* what() const throw() {
+        return this->e_what_.c_str();
+    }
+};
+
+class SerialPortNotOpenException : public std::exception {
+    std::string e_what_;
 public:
-    SerialPortAlreadyOpenException(const char * port) {this->port = port;}
+    SerialPortNotOpenException(const char * port);
+    virtual ~SerialPortNotOpenException() throw() {}
     
     virtual const char* what() const throw() {
-        std::stringstream ss;
-        ss << "Serial Port already open: " << this->port;
-        return ss.str().c_str();
+        return this->e_what_.c_str();
     }
 };
 
 class SerialPortFailedToOpenException : public std::exception {
-    const char * e_what;
+    std::string e_what_;
 public:
-    SerialPortFailedToOpenException(const char * e_what) {this->e_what = e_what;}
+    SerialPortFailedToOpenException(const char * e_what);
+    virtual ~SerialPortFailedToOpenException() throw() {}
     
     virtual const char* what() const throw() {
-        std::stringstream ss;
-        ss << "Serial Port failed to open: " << this->e_what;
-        return ss.str().c_str();
+        return this->e_what_.c_str();
     }
 };
 
 class InvalidBytesizeException : public std::exception {
-    int bytesize;
+    std::string e_what_;
 public:
-    InvalidBytesizeException(int bytesize) {this->bytesize = bytesize;}
+    InvalidBytesizeException(int bytesize);
+    virtual ~InvalidBytesizeException() throw() {}
     
     virtual const char* what() const throw() {
-        std::stringstream ss;
-        ss << "Invalid bytesize provided: " << this->bytesize;
-        return ss.str().c_str();
+        return this->e_what_.c_str();
     }
 };
 
 class InvalidParityException : public std::exception {
-    int parity;
+    std::string e_what_;
 public:
-    InvalidParityException(int parity) {this->parity = parity;}
+    InvalidParityException(int parity);
+    virtual ~InvalidParityException() throw() {}
     
     virtual const char* what() const throw() {
-        std::stringstream ss;
-        ss << "Invalid parity provided: " << this->parity;
-        return ss.str().c_str();
+        return this->e_what_.c_str();
     }
 };
 
 class InvalidStopbitsException : public std::exception {
-    int stopbits;
+    std::string e_what_;
 public:
-    InvalidStopbitsException(int stopbits) {this->stopbits = stopbits;}
+    InvalidStopbitsException(int stopbits);
+    virtual ~InvalidStopbitsException() throw() {}
     
     virtual const char* what() const throw() {
-        std::stringstream ss;
-        ss << "Invalid stopbits provided: " << this->stopbits;
-        return ss.str().c_str();
+        return this->e_what_.c_str();
     }
 };
 
 class InvalidFlowcontrolException : public std::exception {
-    int flowcontrol;
+    std::string e_what_;
 public:
-    InvalidFlowcontrolException(int flowcontrol) {this->flowcontrol = flowcontrol;}
+    InvalidFlowcontrolException(int flowcontrol);
+    virtual ~InvalidFlowcontrolException() throw() {}
     
     virtual const char* what() const throw() {
-        std::stringstream ss;
-        ss << "Invalid flowcontrol provided: " << this->flowcontrol;
-        return ss.str().c_str();
+        return this->e_what_.c_str();
     }
 };
 
@@ -0,0 +1,101 @@
+/**
+ * @file serial_selector.h
+ * @author  William Woodall <wjwwood@gmail.com>
+ * @author  John Harrison   <ash.gti@gmail.com>
+ * @version 0.1
+ * 
+ * @section LICENSE
+ * 
+ * The MIT License
+ * 
+ * Copyright (c) 2011 William Woodall
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ * 
+ * @section DESCRIPTION
+ * 
+ * This provides a way to wait for any of several Serial ports to become readable.
+ */
+
+
+#ifndef SERIAL_SERIAL_SELECTOR_H
+#define SERIAL_SERIAL_SELECTOR_H
+
+#include <vector>
+
+#include <boost/scoped_ptr.hpp>
+
+#include "serial/serial.h"
+
+namespace serial {
+
+/** Waits for any of a set of Serial ports to have data to read.
+* 
+* One call blocks on all of the ports, with epoll on Linux, poll on other POSIX systems and
+* WaitForMultipleObjects on Windows, so a thread can serve many ports without cycling
+* through reads with short timeouts. Data which a Serial has already buffered, e.g. left
+* over from a read_until, makes its port ready straight away. Ports may be closed and
+* reopened while registered, closed ports are never ready.
+* 
+* The background reader thread must not be running on a registered port. On Windows at
+* most 63 ports can be registered, and the ports must not be used with waitForChange or the
+* modem monitor, which share the port's event mask.
+*/
+class SerialSelector {
+public:
+    SerialSelector();
+    ~SerialSelector();
+    
+    /** Adds a port to the set. It must not be destroyed before it is removed, unless the
+    * selector is destroyed first. Adding a port twice has no effect. */
+    void add(Serial& serial);
+    
+    /** Removes a port from the set, if it is in it. */
+    void remove(Serial& serial);
+    
+    /** Gets the number of ports in the set. */
+    size_t size() const;
+    
+    /** Waits until at least one of the ports has data to read.
+    * 
+    * @param ready A std::vector which is replaced with the ports which are ready, in no
+    *        particular order. Its storage is reused between calls.
+    * 
+    * @param timeout The time to wait in milliseconds, zero only checks and a number less
+    *        than zero waits forever.
+    * 
+    * @return The number of ports which are ready, zero on a timeout or after interrupt().
+    * 
+    * @throw boost::system::system_error
+    */
+    size_t select(std::vector<Serial*>& ready, long timeout);
+    
+    /** Makes a select() which is blocked in another thread return, or the next one if
+    * none is. This is the only member which may be called from another thread. */
+    void interrupt();
+private:
+    DISALLOW_COPY_AND_ASSIGN(SerialSelector);
+    
+    class SelectorImpl;
+    boost::scoped_ptr<SelectorImpl> pimpl;
+};
+
+} // namespace serial
+
+#endif
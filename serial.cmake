@@ -12,6 +12,9 @@ project(Serial)
 
 option(SERIAL_BUILD_TESTS "Build all of the Serial tests." OFF)
 option(SERIAL_BUILD_EXAMPLES "Build all of the Serial examples." OFF)
+option(SERIAL_BUILD_BENCHMARKS "Build the Serial benchmarks." OFF)
+option(SERIAL_ENABLE_TRACING "Record latency histograms and call trace callbacks." OFF)
+option(SERIAL_NATIVE_BACKEND "Use the port's file descriptor or handle directly instead of boost::asio::serial_port." OFF)
 
 # Allow for building shared libs override
 IF(NOT BUILD_SHARED_LIBS)
@@ -33,9 +36,35 @@ ENDIF(NOT DEFINED(LIBRARY_OUTPUT_PATH))
 include_directories(${PROJECT_SOURCE_DIR}/include)
 
 # Add default source files
-set(SERIAL_SRCS src/serial.cpp)
+set(SERIAL_SRCS src/serial.cpp src/framer.cpp src/latency_histogram.cpp src/custom_baudrate.cpp src/delimiter_scan.cpp
+                src/low_latency.cpp src/modem_lines.cpp src/serial_selector.cpp src/capture.cpp src/replay_serial.cpp
+                src/buffer_pool.cpp src/checksum.cpp src/port_info.cpp src/saved_settings.cpp
+                src/device_watcher.cpp src/read_buffer.cpp src/serial_stream.cpp)
 # Add default header files
-set(SERIAL_HEADERS include/serial/serial.h)
+set(SERIAL_HEADERS include/serial/serial.h include/serial/framer.h include/serial/latency_histogram.h
+                   include/serial/serial_selector.h include/serial/capture.h include/serial/replay_serial.h
+                   include/serial/buffer_pool.h include/serial/checksum.h include/serial/port_info.h
+                   include/serial/awaitable.h)
+
+# The native backend replaces boost::asio::serial_port with direct termios and ioctl calls,
+# or with overlapped Win32 comm calls on Windows
+IF(SERIAL_NATIVE_BACKEND AND (CYGWIN OR NOT (UNIX OR WIN32)))
+    message(WARNING "The native serial backend is not available on this platform, using boost::asio")
+    set(SERIAL_NATIVE_BACKEND OFF)
+ENDIF(SERIAL_NATIVE_BACKEND AND (CYGWIN OR NOT (UNIX OR WIN32)))
+IF(SERIAL_NATIVE_BACKEND)
+    add_definitions(-DSERIAL_NATIVE_BACKEND)
+    IF(WIN32)
+        set(SERIAL_SRCS ${SERIAL_SRCS} src/win_serial_port.cpp)
+    ELSE(WIN32)
+        set(SERIAL_SRCS ${SERIAL_SRCS} src/posix_serial_port.cpp)
+    ENDIF(WIN32)
+ENDIF(SERIAL_NATIVE_BACKEND)
+
+# Compile in the tracing hooks if asked to
+IF(SERIAL_ENABLE_TRACING)
+    add_definitions(-DSERIAL_ENABLE_TRACING)
+ENDIF(SERIAL_ENABLE_TRACING)
 
 # Find Boost, if it hasn't already been found
 IF(NOT Boost_FOUND OR NOT Boost_SYSTEM_FOUND OR NOT Boost_FILESYSTEM_FOUND OR NOT Boost_THREAD_FOUND)
@@ -45,9 +74,14 @@ ENDIF(NOT Boost_FOUND OR NOT Boost_SYSTEM_FOUND OR NOT Boost_FILESYSTEM_FOUND OR
 link_directories(${Boost_LIBRARY_DIRS})
 include_directories(${Boost_INCLUDE_DIRS})
 
-set(SERIAL_LINK_LIBS ${Boost_SYSTEM_LIBRARY}
-                     ${Boost_FILESYSTEM_LIBRARY}
-                     ${Boost_THREAD_LIBRARY})
+# The native backend only needs Boost.Thread at runtime, the rest of Boost is header only
+IF(SERIAL_NATIVE_BACKEND)
+    set(SERIAL_LINK_LIBS ${Boost_THREAD_LIBRARY})
+ELSE(SERIAL_NATIVE_BACKEND)
+    set(SERIAL_LINK_LIBS ${Boost_SYSTEM_LIBRARY}
+                         ${Boost_FILESYSTEM_LIBRARY}
+                         ${Boost_THREAD_LIBRARY})
+ENDIF(SERIAL_NATIVE_BACKEND)
 
 ## Build the Serial Library
 
@@ -55,7 +89,7 @@ set(SERIAL_LINK_LIBS ${Boost_SYSTEM_LIBRARY}
 add_library(serial ${SERIAL_SRCS} ${SERIAL_HEADERS})
 target_link_libraries(serial ${SERIAL_LINK_LIBS})
 IF( WIN32 )
-	target_link_libraries(serial wsock32)
+	target_link_libraries(serial wsock32 setupapi)
 ENDIF( )
 
 # Check for OS X and if so disable kqueue support in asio
@@ -73,11 +107,54 @@ IF(SERIAL_BUILD_EXAMPLES)
     target_link_libraries(serial_example serial)
 ENDIF(SERIAL_BUILD_EXAMPLES)
 
+## Build benchmarks
+
+# If asked to, they use pseudo terminals so are only available on UNIX
+IF(SERIAL_BUILD_BENCHMARKS AND UNIX)
+    add_executable(serial_benchmark benchmarks/serial_benchmark.cpp)
+    target_link_libraries(serial_benchmark serial)
+    add_executable(serial_stress benchmarks/serial_stress.cpp)
+    target_link_libraries(serial_stress serial)
+    IF(NOT CMAKE_SYSTEM_NAME MATCHES Darwin)
+        target_link_libraries(serial_benchmark util)
+        target_link_libraries(serial_stress util)
+    ENDIF(NOT CMAKE_SYSTEM_NAME MATCHES Darwin)
+ENDIF(SERIAL_BUILD_BENCHMARKS AND UNIX)
+
 ## Build tests
 
 # If asked to
 IF(SERIAL_BUILD_TESTS)
-    # none yet...
+    enable_testing()
+    # The tests also cover the private headers in src
+    include_directories(${PROJECT_SOURCE_DIR}/src)
+    add_executable(serial_tests tests/serial_tests.cpp tests/framer_tests.cpp tests/buffer_pool_tests.cpp
+                                tests/delimiter_scan_tests.cpp tests/checksum_tests.cpp
+                                tests/capture_tests.cpp)
+    target_link_libraries(serial_tests serial)
+    add_test(serial_tests ${EXECUTABLE_OUTPUT_PATH}/serial_tests)
+    
+    # The awaitable interface is tested over a pseudo terminal, built as C++20 if the
+    # compiler supports coroutines
+    IF(UNIX)
+        include(CheckCXXSourceCompiles)
+        set(CMAKE_REQUIRED_FLAGS -std=c++20)
+        check_cxx_source_compiles("#include <coroutine>
+#if !defined(__cpp_impl_coroutine) || __cpp_impl_coroutine < 201902L
+#error No coroutines
+#endif
+int main() { return 0; }" SERIAL_COMPILER_HAS_COROUTINES)
+        unset(CMAKE_REQUIRED_FLAGS)
+        IF(SERIAL_COMPILER_HAS_COROUTINES)
+            add_executable(serial_awaitable_tests tests/awaitable_tests.cpp)
+            set_target_properties(serial_awaitable_tests PROPERTIES COMPILE_FLAGS -std=c++20)
+            target_link_libraries(serial_awaitable_tests serial)
+            IF(NOT CMAKE_SYSTEM_NAME MATCHES Darwin)
+                target_link_libraries(serial_awaitable_tests util)
+            ENDIF(NOT CMAKE_SYSTEM_NAME MATCHES Darwin)
+            add_test(serial_awaitable_tests ${EXECUTABLE_OUTPUT_PATH}/serial_awaitable_tests)
+        ENDIF(SERIAL_COMPILER_HAS_COROUTINES)
+    ENDIF(UNIX)
 ENDIF(SERIAL_BUILD_TESTS)
 
 ## Setup install and uninstall
@@ -95,7 +172,7 @@ IF(NOT SERIAL_DONT_CONFIGURE_INSTALL)
       ARCHIVE DESTINATION lib
     )
     
-    INSTALL(FILES include/serial/serial.h DESTINATION include/serial)
+    INSTALL(FILES ${SERIAL_HEADERS} DESTINATION include/serial)
     
     IF(NOT CMAKE_FIND_INSTALL_PATH)
         set(CMAKE_FIND_INSTALL_PATH ${CMAKE_ROOT})
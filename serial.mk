@@ -30,4 +30,4 @@ ifneq ($(MAKE),)
 else
 	cd build && make
 endif
-    # cd bin && ./serial_tests
\ No newline at end of file
+	cd bin && ./serial_tests
\ No newline at end of file
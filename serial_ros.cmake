@@ -23,7 +23,16 @@ IF(CMAKE_SYSTEM_NAME MATCHES Darwin)
 ENDIF(CMAKE_SYSTEM_NAME MATCHES Darwin)
 
 # Build the serial library
-rosbuild_add_library(${PROJECT_NAME} src/serial.cpp include/serial/serial.h)
+rosbuild_add_library(${PROJECT_NAME} src/serial.cpp src/framer.cpp src/latency_histogram.cpp
+                                     src/custom_baudrate.cpp src/delimiter_scan.cpp src/low_latency.cpp src/modem_lines.cpp
+                                     src/serial_selector.cpp src/capture.cpp src/replay_serial.cpp src/buffer_pool.cpp
+                                     src/checksum.cpp src/port_info.cpp src/saved_settings.cpp src/device_watcher.cpp
+                                     src/read_buffer.cpp src/serial_stream.cpp
+                                     include/serial/serial.h include/serial/framer.h
+                                     include/serial/latency_histogram.h include/serial/serial_selector.h
+                                     include/serial/capture.h include/serial/replay_serial.h
+                                     include/serial/buffer_pool.h include/serial/checksum.h
+                                     include/serial/port_info.h include/serial/awaitable.h)
 
 # Add boost dependencies
 rosbuild_add_boost_directories()
@@ -0,0 +1,140 @@
+#include "serial/buffer_pool.h"
+
+#include <cassert>
+
+#include <boost/atomic.hpp>
+#include <boost/lockfree/stack.hpp>
+#include <boost/scoped_array.hpp>
+
+using namespace serial;
+
+struct PooledBuffer::Block {
+    BufferPool::Storage* storage;
+    boost::atomic<long> refs;
+    size_t size;
+    char* data;
+};
+
+// Outlives the BufferPool while any of its buffers are in use, it holds a reference for
+// the pool and one for each buffer which has been acquired
+struct BufferPool::Storage {
+    Storage(size_t buffer_size, size_t count)
+        : refs(1), buffer_size(buffer_size), count(count), free_count(count),
+          blocks(new PooledBuffer::Block[count]), memory(new char[buffer_size * count]),
+          free_blocks(count) {}
+    
+    void release() {
+        if(this->refs.fetch_sub(1, boost::memory_order_acq_rel) == 1)
+            delete this;
+    }
+    
+    boost::atomic<size_t> refs;
+    size_t buffer_size;
+    size_t count;
+    boost::atomic<size_t> free_count;
+    boost::scoped_array<PooledBuffer::Block> blocks;
+    boost::scoped_array<char> memory;
+    
+    // Its nodes are allocated up front, so bounded_push never allocates either
+    boost::lockfree::stack<PooledBuffer::Block*> free_blocks;
+};
+
+/** PooledBuffer **/
+
+PooledBuffer::PooledBuffer() : block(NULL) {}
+
+PooledBuffer::PooledBuffer(Block* block) : block(block) {}
+
+PooledBuffer::PooledBuffer(const PooledBuffer& other) : block(other.block) {
+    if(this->block != NULL)
+        this->block->refs.fetch_add(1, boost::memory_order_relaxed);
+}
+
+PooledBuffer& PooledBuffer::operator=(const PooledBuffer& other) {
+    // Take the reference before releasing ours, other may be this handle
+    Block* block = other.block;
+    if(block != NULL)
+        block->refs.fetch_add(1, boost::memory_order_relaxed);
+    this->release();
+    this->block = block;
+    return *this;
+}
+
+PooledBuffer::~PooledBuffer() {
+    this->release();
+}
+
+bool PooledBuffer::isValid() const {
+    return this->block != NULL;
+}
+
+char* PooledBuffer::data() const {
+    return this->block != NULL ? this->block->data : NULL;
+}
+
+size_t PooledBuffer::size() const {
+    return this->block != NULL ? this->block->size : 0;
+}
+
+void PooledBuffer::resize(size_t size) {
+    assert(this->block != NULL && size <= this->block->storage->buffer_size);
+    this->block->size = size;
+}
+
+size_t PooledBuffer::capacity() const {
+    return this->block != NULL ? this->block->storage->buffer_size : 0;
+}
+
+void PooledBuffer::release() {
+    Block* block = this->block;
+    this->block = NULL;
+    if(block == NULL || block->refs.fetch_sub(1, boost::memory_order_acq_rel) != 1)
+        return;
+    
+    BufferPool::Storage* storage = block->storage;
+    bool pushed = storage->free_blocks.bounded_push(block);
+    assert(pushed);
+    (void)pushed;
+    storage->free_count.fetch_add(1, boost::memory_order_relaxed);
+    storage->release();
+}
+
+/** BufferPool **/
+
+BufferPool::BufferPool(size_t buffer_size, size_t count) : storage(new Storage(buffer_size, count)) {
+    for(size_t i = 0; i < count; ++i) {
+        PooledBuffer::Block& block = this->storage->blocks[i];
+        block.storage = this->storage;
+        block.refs.store(0, boost::memory_order_relaxed);
+        block.size = 0;
+        block.data = &this->storage->memory[0] + i * buffer_size;
+        this->storage->free_blocks.bounded_push(&block);
+    }
+}
+
+BufferPool::~BufferPool() {
+    this->storage->release();
+}
+
+PooledBuffer BufferPool::acquire() {
+    PooledBuffer::Block* block = NULL;
+    if(!this->storage->free_blocks.pop(block))
+        return PooledBuffer();
+    this->storage->free_count.fetch_sub(1, boost::memory_order_relaxed);
+    this->storage->refs.fetch_add(1, boost::memory_order_relaxed);
+    block->refs.store(1, boost::memory_order_relaxed);
+    block->size = 0;
+    return PooledBuffer(block);
+}
+
+size_t BufferPool::getBufferSize() const {
+    return this->storage->buffer_size;
+}
+
+size_t BufferPool::getCount() const {
+    return this->storage->count;
+}
+
+size_t BufferPool::available() const {
+    return this->storage->free_count.load(boost::memory_order_relaxed);
+}
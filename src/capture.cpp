@@ -0,0 +1,377 @@
+#include "serial/capture.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <boost/asio.hpp>
+#include <boost/thread/mutex.hpp>
+
+#if !(defined(BOOST_WINDOWS) || defined(__CYGWIN__))
+# include <errno.h>
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <time.h>
+# include <unistd.h>
+#endif
+
+using namespace serial;
+
+namespace {
+
+const uint32_t capture_version = 1;
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+};
+
+struct RecordHeader {
+    uint64_t timestamp;
+    uint32_t size;
+    uint16_t direction;
+    uint16_t reserved;
+};
+
+const char capture_magic[8] = { 'S', 'E', 'R', 'C', 'A', 'P', '\0', '\0' };
+
+inline uint64_t padded(uint64_t size) {
+    return (size + 7) & ~uint64_t(7);
+}
+
+#if defined(BOOST_WINDOWS) || defined(__CYGWIN__)
+boost::system::error_code last_error() {
+    return boost::system::error_code(::GetLastError(), boost::system::system_category());
+}
+#else
+boost::system::error_code last_error() {
+    return boost::system::error_code(errno, boost::system::system_category());
+}
+#endif
+
+} // namespace
+
+/** Capture Log **/
+
+class CaptureLog::CaptureLogImpl {
+public:
+    CaptureLogImpl(const std::string& path, uint64_t initial_size);
+    ~CaptureLogImpl();
+
+    void append(capture_direction_t direction, uint64_t timestamp, const char* data, size_t size);
+    void close();
+
+    // Replaces the mapping with one of at least the given size, must be called with mutex held
+    void grow(uint64_t needed);
+    void map(uint64_t size);
+    void unmap();
+
+#if defined(BOOST_WINDOWS) || defined(__CYGWIN__)
+    HANDLE file;
+    HANDLE mapping;
+#else
+    int fd;
+#endif
+    char* data;
+    uint64_t mapped;
+    uint64_t used;
+    mutable boost::mutex mutex;
+};
+
+CaptureLog::CaptureLogImpl::CaptureLogImpl(const std::string& path, uint64_t initial_size)
+    : data(NULL), mapped(0), used(0) {
+#if defined(BOOST_WINDOWS) || defined(__CYGWIN__)
+    this->mapping = NULL;
+    this->file = ::CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL,
+                               CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(this->file == INVALID_HANDLE_VALUE)
+        boost::asio::detail::throw_error(last_error(), "CreateFile");
+#else
+    this->fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(this->fd < 0)
+        boost::asio::detail::throw_error(last_error(), "open");
+#endif
+    try {
+        this->map(std::max(initial_size, uint64_t(sizeof(FileHeader))));
+    } catch(...) {
+        this->close();
+        throw;
+    }
+
+    FileHeader header;
+    std::memcpy(header.magic, capture_magic, sizeof(header.magic));
+    header.version = capture_version;
+    header.header_size = sizeof(FileHeader);
+    std::memcpy(this->data, &header, sizeof(header));
+    this->used = sizeof(header);
+}
+
+CaptureLog::CaptureLogImpl::~CaptureLogImpl() {
+    this->close();
+}
+
+#if defined(BOOST_WINDOWS) || defined(__CYGWIN__)
+
+void CaptureLog::CaptureLogImpl::map(uint64_t size) {
+    // Creating a mapping larger than the file extends it
+    this->mapping = ::CreateFileMapping(this->file, NULL, PAGE_READWRITE, DWORD(size >> 32), DWORD(size), NULL);
+    if(this->mapping == NULL)
+        boost::asio::detail::throw_error(last_error(), "CreateFileMapping");
+    this->data = static_cast<char*>(::MapViewOfFile(this->mapping, FILE_MAP_WRITE, 0, 0, SIZE_T(size)));
+    if(this->data == NULL) {
+        boost::system::error_code ec = last_error();
+        ::CloseHandle(this->mapping);
+        this->mapping = NULL;
+        boost::asio::detail::throw_error(ec, "MapViewOfFile");
+    }
+    this->mapped = size;
+}
+
+void CaptureLog::CaptureLogImpl::unmap() {
+    if(this->data != NULL)
+        ::UnmapViewOfFile(this->data);
+    if(this->mapping != NULL)
+        ::CloseHandle(this->mapping);
+    this->data = NULL;
+    this->mapping = NULL;
+    this->mapped = 0;
+}
+
+void CaptureLog::CaptureLogImpl::close() {
+    boost::mutex::scoped_lock lock(this->mutex);
+    if(this->file == INVALID_HANDLE_VALUE)
+        return;
+    this->unmap();
+    LARGE_INTEGER end;
+    end.QuadPart = LONGLONG(this->used);
+    if(::SetFilePointerEx(this->file, end, NULL, FILE_BEGIN))
+        ::SetEndOfFile(this->file);
+    ::CloseHandle(this->file);
+    this->file = INVALID_HANDLE_VALUE;
+}
+
+#else
+
+void CaptureLog::CaptureLogImpl::map(uint64_t size) {
+    if(::ftruncate(this->fd, off_t(size)) < 0)
+        boost::asio::detail::throw_error(last_error(), "ftruncate");
+    void* address = ::mmap(NULL, size_t(size), PROT_READ | PROT_WRITE, MAP_SHARED, this->fd, 0);
+    if(address == MAP_FAILED)
+        boost::asio::detail::throw_error(last_error(), "mmap");
+    this->data = static_cast<char*>(address);
+    this->mapped = size;
+}
+
+void CaptureLog::CaptureLogImpl::unmap() {
+    if(this->data != NULL)
+        ::munmap(this->data, size_t(this->mapped));
+    this->data = NULL;
+    this->mapped = 0;
+}
+
+void CaptureLog::CaptureLogImpl::close() {
+    boost::mutex::scoped_lock lock(this->mutex);
+    if(this->fd < 0)
+        return;
+    this->unmap();
+    if(this->used > 0)
+        ::ftruncate(this->fd, off_t(this->used));
+    ::close(this->fd);
+    this->fd = -1;
+}
+
+#endif
+
+void CaptureLog::CaptureLogImpl::grow(uint64_t needed) {
+    uint64_t size = this->mapped;
+    while(size < needed)
+        size *= 2;
+    this->unmap();
+    this->map(size);
+}
+
+void CaptureLog::CaptureLogImpl::append(capture_direction_t direction, uint64_t timestamp,
+                                        const char* data, size_t size) {
+    if(size == 0)
+        return;
+    uint64_t record_size = sizeof(RecordHeader) + padded(size);
+
+    boost::mutex::scoped_lock lock(this->mutex);
+    // Closed
+    if(this->data == NULL)
+        return;
+    if(this->used + record_size > this->mapped)
+        this->grow(this->used + record_size);
+
+    RecordHeader header;
+    header.timestamp = timestamp;
+    header.size = uint32_t(size);
+    header.direction = uint16_t(direction);
+    header.reserved = 0;
+    char* record = this->data + this->used;
+    std::memcpy(record, &header, sizeof(header));
+    std::memcpy(record + sizeof(header), data, size);
+    this->used += record_size;
+}
+
+CaptureLog::CaptureLog(const std::string& path, size_t initial_size)
+    : pimpl(new CaptureLogImpl(path, initial_size)) {}
+
+CaptureLog::~CaptureLog() {}
+
+void CaptureLog::append(capture_direction_t direction, const char* data, size_t size) {
+    if(size > 0)
+        this->pimpl->append(direction, CaptureLog::now(), data, size);
+}
+
+void CaptureLog::append(capture_direction_t direction, uint64_t timestamp, const char* data, size_t size) {
+    this->pimpl->append(direction, timestamp, data, size);
+}
+
+void CaptureLog::close() {
+    this->pimpl->close();
+}
+
+uint64_t CaptureLog::size() const {
+    boost::mutex::scoped_lock lock(this->pimpl->mutex);
+    return this->pimpl->used;
+}
+
+uint64_t CaptureLog::now() {
+#if defined(BOOST_WINDOWS) || defined(__CYGWIN__)
+    // FILETIME counts 100 ns intervals since 1601
+    FILETIME time;
+    ::GetSystemTimeAsFileTime(&time);
+    uint64_t intervals = (uint64_t(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+    return (intervals - 116444736000000000ULL) * 100;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return uint64_t(now.tv_sec) * 1000000000ULL + uint64_t(now.tv_nsec);
+#endif
+}
+
+/** Capture Reader **/
+
+class CaptureReader::CaptureReaderImpl {
+public:
+    explicit CaptureReaderImpl(const std::string& path);
+    ~CaptureReaderImpl();
+
+#if defined(BOOST_WINDOWS) || defined(__CYGWIN__)
+    HANDLE file;
+    HANDLE mapping;
+#else
+    int fd;
+#endif
+    const char* data;
+    uint64_t size;
+    uint64_t offset;
+    uint64_t first;
+};
+
+#if defined(BOOST_WINDOWS) || defined(__CYGWIN__)
+
+CaptureReader::CaptureReaderImpl::CaptureReaderImpl(const std::string& path)
+    : mapping(NULL), data(NULL), size(0), offset(0), first(0) {
+    this->file = ::CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                               OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(this->file == INVALID_HANDLE_VALUE)
+        boost::asio::detail::throw_error(last_error(), "CreateFile");
+    LARGE_INTEGER file_size;
+    if(!::GetFileSizeEx(this->file, &file_size)) {
+        boost::system::error_code ec = last_error();
+        ::CloseHandle(this->file);
+        boost::asio::detail::throw_error(ec, "GetFileSizeEx");
+    }
+    this->size = uint64_t(file_size.QuadPart);
+    if(this->size < sizeof(FileHeader)) {
+        ::CloseHandle(this->file);
+        throw(CaptureFormatException());
+    }
+    this->mapping = ::CreateFileMapping(this->file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if(this->mapping != NULL)
+        this->data = static_cast<const char*>(::MapViewOfFile(this->mapping, FILE_MAP_READ, 0, 0, 0));
+    if(this->data == NULL) {
+        boost::system::error_code ec = last_error();
+        if(this->mapping != NULL)
+            ::CloseHandle(this->mapping);
+        ::CloseHandle(this->file);
+        boost::asio::detail::throw_error(ec, "MapViewOfFile");
+    }
+}
+
+CaptureReader::CaptureReaderImpl::~CaptureReaderImpl() {
+    ::UnmapViewOfFile(this->data);
+    ::CloseHandle(this->mapping);
+    ::CloseHandle(this->file);
+}
+
+#else
+
+CaptureReader::CaptureReaderImpl::CaptureReaderImpl(const std::string& path)
+    : data(NULL), size(0), offset(0), first(0) {
+    this->fd = ::open(path.c_str(), O_RDONLY);
+    if(this->fd < 0)
+        boost::asio::detail::throw_error(last_error(), "open");
+    struct stat status;
+    if(::fstat(this->fd, &status) < 0) {
+        boost::system::error_code ec = last_error();
+        ::close(this->fd);
+        boost::asio::detail::throw_error(ec, "fstat");
+    }
+    this->size = uint64_t(status.st_size);
+    if(this->size < sizeof(FileHeader)) {
+        ::close(this->fd);
+        throw(CaptureFormatException());
+    }
+    void* address = ::mmap(NULL, size_t(this->size), PROT_READ, MAP_SHARED, this->fd, 0);
+    if(address == MAP_FAILED) {
+        boost::system::error_code ec = last_error();
+        ::close(this->fd);
+        boost::asio::detail::throw_error(ec, "mmap");
+    }
+    this->data = static_cast<const char*>(address);
+}
+
+CaptureReader::CaptureReaderImpl::~CaptureReaderImpl() {
+    ::munmap(const_cast<char*>(this->data), size_t(this->size));
+    ::close(this->fd);
+}
+
+#endif
+
+CaptureReader::CaptureReader(const std::string& path) : pimpl(new CaptureReaderImpl(path)) {
+    FileHeader header;
+    std::memcpy(&header, this->pimpl->data, sizeof(header));
+    if(std::memcmp(header.magic, capture_magic, sizeof(header.magic)) != 0 ||
+       header.version != capture_version || header.header_size < sizeof(header) ||
+       header.header_size > this->pimpl->size)
+        throw(CaptureFormatException());
+    this->pimpl->first = header.header_size;
+    this->pimpl->offset = header.header_size;
+}
+
+CaptureReader::~CaptureReader() {}
+
+bool CaptureReader::next(CaptureRecord& record) {
+    CaptureReaderImpl& impl = *this->pimpl;
+    if(impl.offset + sizeof(RecordHeader) > impl.size)
+        return false;
+    RecordHeader header;
+    std::memcpy(&header, impl.data + impl.offset, sizeof(header));
+    // A file which was not closed ends in zeros, and may end in the middle of a record
+    if(header.size == 0 || impl.offset + sizeof(RecordHeader) + header.size > impl.size)
+        return false;
+    record.timestamp = header.timestamp;
+    record.direction = capture_direction_t(header.direction);
+    record.data = impl.data + impl.offset + sizeof(RecordHeader);
+    record.size = header.size;
+    impl.offset += sizeof(RecordHeader) + padded(header.size);
+    return true;
+}
+
+void CaptureReader::rewind() {
+    this->pimpl->offset = this->pimpl->first;
+}
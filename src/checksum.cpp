@@ -0,0 +1,351 @@
+#include "serial/checksum.h"
+
+#include <cstring>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+# define SERIAL_CRC_X86
+# if defined(_MSC_VER)
+#  include <intrin.h>
+#  define SERIAL_TARGET(features)
+# else
+#  include <cpuid.h>
+#  define SERIAL_TARGET(features) __attribute__((target(features)))
+# endif
+# include <nmmintrin.h>
+# include <smmintrin.h>
+# include <wmmintrin.h>
+#elif defined(__ARM_FEATURE_CRC32)
+# include <arm_acle.h>
+# define SERIAL_CRC_ARM
+#endif
+
+using namespace serial;
+
+namespace {
+
+// Slicing by 8 tables of a reflected CRC-32, the first one is the usual bytewise table
+struct Crc32Tables {
+    explicit Crc32Tables(uint32_t polynomial) {
+        for(uint32_t n = 0; n < 256; ++n) {
+            uint32_t crc = n;
+            for(int bit = 0; bit < 8; ++bit)
+                crc = (crc & 1) ? (crc >> 1) ^ polynomial : crc >> 1;
+            this->table[0][n] = crc;
+        }
+        for(uint32_t n = 0; n < 256; ++n) {
+            for(int k = 1; k < 8; ++k)
+                this->table[k][n] = (this->table[k - 1][n] >> 8) ^ this->table[0][this->table[k - 1][n] & 0xff];
+        }
+    }
+    
+    uint32_t table[8][256];
+};
+
+const Crc32Tables crc32_tables(0xEDB88320);
+const Crc32Tables crc32c_tables(0x82F63B78);
+
+inline uint32_t load_le32(const unsigned char* p) {
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+// Takes and returns the CRC register, which is the inverse of the CRC
+uint32_t crc32_tables_update(const Crc32Tables& tables, uint32_t crc, const unsigned char* p, size_t length) {
+    const uint32_t (*t)[256] = tables.table;
+    for(; length >= 8; length -= 8, p += 8) {
+        uint32_t one = load_le32(p) ^ crc;
+        uint32_t two = load_le32(p + 4);
+        crc = t[7][one & 0xff] ^ t[6][(one >> 8) & 0xff] ^ t[5][(one >> 16) & 0xff] ^ t[4][one >> 24] ^
+              t[3][two & 0xff] ^ t[2][(two >> 8) & 0xff] ^ t[1][(two >> 16) & 0xff] ^ t[0][two >> 24];
+    }
+    for(; length > 0; --length, ++p)
+        crc = t[0][(crc ^ *p) & 0xff] ^ (crc >> 8);
+    return crc;
+}
+
+#if defined(SERIAL_CRC_X86)
+
+struct CpuFeatures {
+    CpuFeatures() {
+        unsigned int ecx = 0;
+#if defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 1);
+        ecx = unsigned(info[2]);
+#else
+        unsigned int eax, ebx, edx;
+        if(!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+            ecx = 0;
+#endif
+        this->sse42 = (ecx & (1u << 20)) != 0;
+        this->pclmul = (ecx & (1u << 1)) != 0 && (ecx & (1u << 19)) != 0; // Also needs SSE4.1
+    }
+    
+    bool sse42;
+    bool pclmul;
+};
+
+const CpuFeatures cpu;
+
+SERIAL_TARGET("sse4.2")
+uint32_t crc32c_sse42(uint32_t crc, const unsigned char* p, size_t length) {
+#if defined(__x86_64__) || defined(_M_X64)
+    uint64_t crc64 = crc;
+    for(; length >= 8; length -= 8, p += 8) {
+        uint64_t value;
+        std::memcpy(&value, p, sizeof(value));
+        crc64 = _mm_crc32_u64(crc64, value);
+    }
+    crc = uint32_t(crc64);
+#endif
+    for(; length >= 4; length -= 4, p += 4) {
+        uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+        crc = _mm_crc32_u32(crc, value);
+    }
+    for(; length > 0; --length, ++p)
+        crc = _mm_crc32_u8(crc, *p);
+    return crc;
+}
+
+// Folds 64 bytes at a time with carry-less multiplication and reduces the result with
+// Barrett reduction, see Intel's "Fast CRC Computation for Generic Polynomials Using
+// PCLMULQDQ Instruction". The constants are those of the bit reflected CRC-32 polynomial.
+// Needs at least 64 bytes and a multiple of 16.
+SERIAL_TARGET("pclmul,sse4.1")
+uint32_t crc32_pclmul(uint32_t crc, const unsigned char* p, size_t length) {
+    const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596LL, 0x0154442bd4LL);
+    const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009eLL, 0x01751997d0LL);
+    const __m128i k5k0 = _mm_set_epi64x(0, 0x0163cd6124LL);
+    const __m128i poly = _mm_set_epi64x(0x01f7011641LL, 0x01db710641LL);
+    const __m128i low_mask = _mm_setr_epi32(~0, 0, ~0, 0);
+    
+    __m128i x1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i x2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16));
+    __m128i x3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 32));
+    __m128i x4 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 48));
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(int(crc)));
+    p += 64;
+    length -= 64;
+    
+    // Fold four blocks in parallel
+    for(; length >= 64; length -= 64, p += 64) {
+        __m128i x5 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+        __m128i x6 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+        __m128i x7 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+        __m128i x8 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, k1k2, 0x11);
+        x2 = _mm_clmulepi64_si128(x2, k1k2, 0x11);
+        x3 = _mm_clmulepi64_si128(x3, k1k2, 0x11);
+        x4 = _mm_clmulepi64_si128(x4, k1k2, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+        x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16)));
+        x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 32)));
+        x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 48)));
+    }
+    
+    // Fold the four blocks into one, then any remaining blocks of 16 bytes into it
+    __m128i x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), x2), x5);
+    x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), x3), x5);
+    x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), x4), x5);
+    for(; length >= 16; length -= 16, p += 16) {
+        x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, _mm_loadu_si128(reinterpret_cast<const __m128i*>(p))), x5);
+    }
+    
+    // Fold 128 bits to 64, then reduce to 32
+    x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_and_si128(x1, low_mask);
+    x1 = _mm_xor_si128(_mm_clmulepi64_si128(x1, k5k0, 0x00), x2);
+    
+    x2 = _mm_and_si128(x1, low_mask);
+    x2 = _mm_clmulepi64_si128(x2, poly, 0x10);
+    x2 = _mm_and_si128(x2, low_mask);
+    x2 = _mm_clmulepi64_si128(x2, poly, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+    return uint32_t(_mm_extract_epi32(x1, 1));
+}
+
+#elif defined(SERIAL_CRC_ARM)
+
+uint32_t crc32_arm(uint32_t crc, const unsigned char* p, size_t length) {
+    for(; length >= 8; length -= 8, p += 8) {
+        uint64_t value;
+        std::memcpy(&value, p, sizeof(value));
+        crc = __crc32d(crc, value);
+    }
+    for(; length > 0; --length, ++p)
+        crc = __crc32b(crc, *p);
+    return crc;
+}
+
+uint32_t crc32c_arm(uint32_t crc, const unsigned char* p, size_t length) {
+    for(; length >= 8; length -= 8, p += 8) {
+        uint64_t value;
+        std::memcpy(&value, p, sizeof(value));
+        crc = __crc32cd(crc, value);
+    }
+    for(; length > 0; --length, ++p)
+        crc = __crc32cb(crc, *p);
+    return crc;
+}
+
+#endif
+
+inline void store_le32(uint32_t value, char* out) {
+    out[0] = char(value);
+    out[1] = char(value >> 8);
+    out[2] = char(value >> 16);
+    out[3] = char(value >> 24);
+}
+
+uint16_t reflect16(uint16_t value) {
+    uint16_t reflected = 0;
+    for(int bit = 0; bit < 16; ++bit) {
+        if(value & (1 << bit))
+            reflected |= uint16_t(1 << (15 - bit));
+    }
+    return reflected;
+}
+
+} // namespace
+
+/** Checksum **/
+
+bool Checksum::verify(const char* frame, size_t length) const {
+    std::size_t size = this->size();
+    if(length < size)
+        return false;
+
+    // Checksums are short, only unusually long ones need the heap
+    char stack_buffer[16];
+    std::vector<char> heap_buffer;
+    char *expected = stack_buffer;
+    if(size > sizeof(stack_buffer)) {
+        heap_buffer.resize(size);
+        expected = &heap_buffer[0];
+    }
+    this->compute(frame, length - size, expected);
+    return std::memcmp(expected, frame + length - size, size) == 0;
+}
+
+/** XOR Checksum **/
+
+XorChecksum::XorChecksum(uint8_t init) : init(init) {}
+
+size_t XorChecksum::size() const {
+    return 1;
+}
+
+void XorChecksum::compute(const char* data, size_t length, char* out) const {
+    out[0] = char(this->checksum(data, length));
+}
+
+uint8_t XorChecksum::checksum(const char* data, size_t length) const {
+    uint8_t sum = this->init;
+    for(std::size_t i = 0; i < length; ++i)
+        sum ^= uint8_t(data[i]);
+    return sum;
+}
+
+/** CRC-16 Checksum **/
+
+Crc16Checksum::Crc16Checksum(uint16_t polynomial, uint16_t init, bool reflected, uint16_t xor_out,
+                             bool little_endian)
+    : init(reflected ? reflect16(init) : init), reflected(reflected), xor_out(xor_out),
+      little_endian(little_endian) {
+    uint16_t reflected_polynomial = reflect16(polynomial);
+    for(uint16_t n = 0; n < 256; ++n) {
+        uint16_t crc;
+        if(reflected) {
+            crc = n;
+            for(int bit = 0; bit < 8; ++bit)
+                crc = (crc & 1) ? uint16_t((crc >> 1) ^ reflected_polynomial) : uint16_t(crc >> 1);
+        } else {
+            crc = uint16_t(n << 8);
+            for(int bit = 0; bit < 8; ++bit)
+                crc = (crc & 0x8000) ? uint16_t((crc << 1) ^ polynomial) : uint16_t(crc << 1);
+        }
+        this->table[n] = crc;
+    }
+}
+
+size_t Crc16Checksum::size() const {
+    return 2;
+}
+
+void Crc16Checksum::compute(const char* data, size_t length, char* out) const {
+    uint16_t crc = this->checksum(data, length);
+    out[this->little_endian ? 0 : 1] = char(crc);
+    out[this->little_endian ? 1 : 0] = char(crc >> 8);
+}
+
+uint16_t Crc16Checksum::checksum(const char* data, size_t length) const {
+    const unsigned char *p = reinterpret_cast<const unsigned char*>(data);
+    uint16_t crc = this->init;
+    if(this->reflected) {
+        for(std::size_t i = 0; i < length; ++i)
+            crc = uint16_t((crc >> 8) ^ this->table[(crc ^ p[i]) & 0xff]);
+    } else {
+        for(std::size_t i = 0; i < length; ++i)
+            crc = uint16_t((crc << 8) ^ this->table[((crc >> 8) ^ p[i]) & 0xff]);
+    }
+    return uint16_t(crc ^ this->xor_out);
+}
+
+/** CRC-32 Checksum **/
+
+size_t Crc32Checksum::size() const {
+    return 4;
+}
+
+void Crc32Checksum::compute(const char* data, size_t length, char* out) const {
+    store_le32(Crc32Checksum::update(0, data, length), out);
+}
+
+uint32_t Crc32Checksum::update(uint32_t crc, const char* data, size_t length) {
+    const unsigned char *p = reinterpret_cast<const unsigned char*>(data);
+#if defined(SERIAL_CRC_ARM)
+    return ~crc32_arm(~crc, p, length);
+#else
+    crc = ~crc;
+# if defined(SERIAL_CRC_X86)
+    if(length >= 64 && cpu.pclmul) {
+        std::size_t folded = length & ~std::size_t(15);
+        crc = crc32_pclmul(crc, p, folded);
+        p += folded;
+        length -= folded;
+    }
+# endif
+    return ~crc32_tables_update(crc32_tables, crc, p, length);
+#endif
+}
+
+/** CRC-32C Checksum **/
+
+size_t Crc32cChecksum::size() const {
+    return 4;
+}
+
+void Crc32cChecksum::compute(const char* data, size_t length, char* out) const {
+    store_le32(Crc32cChecksum::update(0, data, length), out);
+}
+
+uint32_t Crc32cChecksum::update(uint32_t crc, const char* data, size_t length) {
+    const unsigned char *p = reinterpret_cast<const unsigned char*>(data);
+#if defined(SERIAL_CRC_ARM)
+    return ~crc32c_arm(~crc, p, length);
+#else
+# if defined(SERIAL_CRC_X86)
+    if(cpu.sse42)
+        return ~crc32c_sse42(~crc, p, length);
+# endif
+    return ~crc32_tables_update(crc32c_tables, ~crc, p, length);
+#endif
+}
@@ -0,0 +1,52 @@
+#include "custom_baudrate.h"
+
+#include <errno.h>
+
+#if defined(__linux__)
+# include <asm/termbits.h>
+# include <sys/ioctl.h>
+#elif defined(__APPLE__)
+# include <sys/ioctl.h>
+# include <termios.h>
+# include <IOKit/serial/ioss.h>
+#endif
+
+#include <boost/asio/error.hpp>
+
+using namespace serial;
+
+#if defined(__linux__) && defined(BOTHER)
+
+void CustomBaudrate::set(int fd, unsigned int rate, boost::system::error_code& ec) {
+    struct termios2 storage;
+    if(::ioctl(fd, TCGETS2, &storage) < 0) {
+        ec = boost::system::error_code(errno, boost::system::system_category());
+        return;
+    }
+    storage.c_cflag &= ~(CBAUD | (CBAUD << IBSHIFT));
+    storage.c_cflag |= BOTHER | (BOTHER << IBSHIFT);
+    storage.c_ispeed = rate;
+    storage.c_ospeed = rate;
+    if(::ioctl(fd, TCSETS2, &storage) < 0)
+        ec = boost::system::error_code(errno, boost::system::system_category());
+    else
+        ec = boost::system::error_code();
+}
+
+#elif defined(__APPLE__) && defined(IOSSIOSPEED)
+
+void CustomBaudrate::set(int fd, unsigned int rate, boost::system::error_code& ec) {
+    speed_t speed = rate;
+    if(::ioctl(fd, IOSSIOSPEED, &speed) < 0)
+        ec = boost::system::error_code(errno, boost::system::system_category());
+    else
+        ec = boost::system::error_code();
+}
+
+#else
+
+void CustomBaudrate::set(int, unsigned int, boost::system::error_code& ec) {
+    ec = boost::asio::error::operation_not_supported;
+}
+
+#endif
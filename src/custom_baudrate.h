@@ -0,0 +1,33 @@
+#ifndef SERIAL_CUSTOM_BAUDRATE_H
+#define SERIAL_CUSTOM_BAUDRATE_H
+
+#include <boost/system/error_code.hpp>
+
+namespace serial {
+
+/** Sets baud rates which termios has no Bxxx constant for, e.g. 250000 for DMX.
+* 
+* On Linux the rate is set with TCSETS2 and BOTHER, on macOS with IOSSIOSPEED. Windows
+* has no need for this, since its DCB takes the rate as a number. This header is kept free
+* of termios.h, because the Linux implementation needs the kernel's termbits.h instead.
+*/
+class CustomBaudrate {
+public:
+    /** Sets the input and output speed of a port to any rate the driver accepts.
+    * 
+    * A later tcsetattr() puts the speed back on macOS, so this has to come after the other
+    * termios settings.
+    * 
+    * @param fd The port's file descriptor.
+    * 
+    * @param rate The baud rate.
+    * 
+    * @param ec Set to the error, operation_not_supported if the system has no way to
+    *        set such a rate.
+    */
+    static void set(int fd, unsigned int rate, boost::system::error_code& ec);
+};
+
+} // namespace serial
+
+#endif
@@ -0,0 +1,181 @@
+#include "delimiter_scan.h"
+
+#include <cstring>
+#include <stdint.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# include <emmintrin.h>
+# define SERIAL_SCAN_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+# include <arm_neon.h>
+# define SERIAL_SCAN_NEON
+#endif
+
+#if (defined(SERIAL_SCAN_SSE2) || defined(SERIAL_SCAN_NEON)) && defined(_MSC_VER)
+# include <intrin.h>
+#endif
+
+using namespace serial;
+
+// The most delimiters find_any compares each block against, more are matched bytewise
+static const std::size_t max_vector_delims = 8;
+
+#if defined(SERIAL_SCAN_SSE2) || defined(SERIAL_SCAN_NEON)
+
+#if defined(SERIAL_SCAN_SSE2)
+typedef __m128i block_type;
+
+// movemask gives one bit per byte
+static const unsigned int mask_bits_per_byte = 1;
+
+static inline block_type load_block(const char* data) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+}
+
+static inline block_type splat(char c) {
+    return _mm_set1_epi8(c);
+}
+
+static inline block_type match(block_type block, block_type needle) {
+    return _mm_cmpeq_epi8(block, needle);
+}
+
+static inline block_type match_both(block_type a, block_type b) {
+    return _mm_and_si128(a, b);
+}
+
+static inline block_type match_either(block_type a, block_type b) {
+    return _mm_or_si128(a, b);
+}
+
+static inline uint64_t match_mask(block_type matches) {
+    return uint64_t(unsigned(_mm_movemask_epi8(matches)));
+}
+#else
+typedef uint8x16_t block_type;
+
+// NEON has no movemask, narrowing the comparison to 64 bits leaves a nibble per byte of
+// which only one bit is kept
+static const unsigned int mask_bits_per_byte = 4;
+
+static inline block_type load_block(const char* data) {
+    return vld1q_u8(reinterpret_cast<const uint8_t*>(data));
+}
+
+static inline block_type splat(char c) {
+    return vdupq_n_u8(uint8_t(c));
+}
+
+static inline block_type match(block_type block, block_type needle) {
+    return vceqq_u8(block, needle);
+}
+
+static inline block_type match_both(block_type a, block_type b) {
+    return vandq_u8(a, b);
+}
+
+static inline block_type match_either(block_type a, block_type b) {
+    return vorrq_u8(a, b);
+}
+
+static inline uint64_t match_mask(block_type matches) {
+    uint8x8_t narrowed = vshrn_n_u16(vreinterpretq_u16_u8(matches), 4);
+    return vget_lane_u64(vreinterpret_u64_u8(narrowed), 0) & 0x8888888888888888ULL;
+}
+#endif
+
+// The offset of the first matching byte in a non-zero mask
+static inline std::size_t first_match(uint64_t mask) {
+#if defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return index / mask_bits_per_byte;
+#elif defined(_MSC_VER)
+    unsigned long index;
+    if(_BitScanForward(&index, static_cast<unsigned long>(mask)))
+        return index / mask_bits_per_byte;
+    _BitScanForward(&index, static_cast<unsigned long>(mask >> 32));
+    return (index + 32) / mask_bits_per_byte;
+#else
+    return std::size_t(__builtin_ctzll(mask)) / mask_bits_per_byte;
+#endif
+}
+
+
+#endif
+
+std::size_t DelimiterScanner::find(const char* data, std::size_t size, const char* delim, std::size_t length) {
+    if(length == 0)
+        return 0;
+    if(size < length)
+        return size;
+    if(length == 1) {
+        // memchr is vectorized by the C library already
+        const void *found = std::memchr(data, delim[0], size);
+        return found != NULL ? std::size_t(static_cast<const char*>(found) - data) : size;
+    }
+    
+    std::size_t last = size - length; // The last offset at which the delimiter fits
+    std::size_t i = 0;
+#if defined(SERIAL_SCAN_SSE2) || defined(SERIAL_SCAN_NEON)
+    // Compare 16 candidate offsets at once on both the first and the last byte of the
+    // delimiter, so only offsets matching both are compared in full
+    block_type first_byte = splat(delim[0]);
+    block_type last_byte = splat(delim[length - 1]);
+    for(; i + 16 <= last + 1; i += 16) {
+        uint64_t mask = match_mask(match_both(match(load_block(data + i), first_byte),
+                                              match(load_block(data + i + length - 1), last_byte)));
+        while(mask != 0) {
+            std::size_t offset = first_match(mask);
+            if(std::memcmp(data + i + offset + 1, delim + 1, length - 2) == 0)
+                return i + offset;
+            mask &= mask - 1;
+        }
+    }
+#endif
+    // Elsewhere, and for the last offsets, memchr finds the candidates
+    for(; i <= last; ++i) {
+        const void *found = std::memchr(data + i, delim[0], last + 1 - i);
+        if(found == NULL)
+            break;
+        i = std::size_t(static_cast<const char*>(found) - data);
+        if(std::memcmp(data + i + 1, delim + 1, length - 1) == 0)
+            return i;
+    }
+    return size;
+}
+
+std::size_t DelimiterScanner::find_any(const char* data, std::size_t size, const char* delims, std::size_t count) {
+    if(count == 0)
+        return size;
+    if(count == 1)
+        return find(data, size, delims, 1);
+    
+    std::size_t i = 0;
+#if defined(SERIAL_SCAN_SSE2) || defined(SERIAL_SCAN_NEON)
+    if(count <= max_vector_delims) {
+        block_type needles[max_vector_delims];
+        for(std::size_t d = 0; d < count; ++d)
+            needles[d] = splat(delims[d]);
+        for(; i + 16 <= size; i += 16) {
+            block_type block = load_block(data + i);
+            block_type matches = match(block, needles[0]);
+            for(std::size_t d = 1; d < count; ++d)
+                matches = match_either(matches, match(block, needles[d]));
+            uint64_t mask = match_mask(matches);
+            if(mask != 0)
+                return i + first_match(mask);
+        }
+    }
+#endif
+    if(i == size)
+        return size;
+    bool is_delim[256] = { false };
+    for(std::size_t d = 0; d < count; ++d)
+        is_delim[static_cast<unsigned char>(delims[d])] = true;
+    for(; i < size; ++i) {
+        if(is_delim[static_cast<unsigned char>(data[i])])
+            return i;
+    }
+    return size;
+}
@@ -0,0 +1,29 @@
+#ifndef SERIAL_DELIMITER_SCAN_H
+#define SERIAL_DELIMITER_SCAN_H
+
+#include <cstddef>
+
+namespace serial {
+
+/** Searches received data for delimiters, 16 bytes at a time with SSE2 or NEON where the
+* compiler targets either of them, and one byte at a time elsewhere.
+*/
+class DelimiterScanner {
+public:
+    /** Finds the first occurrence of a delimiter.
+    * 
+    * @return The offset of the delimiter, or size if it was not found. An empty
+    *         delimiter is found at offset 0.
+    */
+    static std::size_t find(const char* data, std::size_t size, const char* delim, std::size_t length);
+    
+    /** Finds the first byte which is any of count single byte delimiters.
+    * 
+    * @return The offset of the byte, or size if none was found.
+    */
+    static std::size_t find_any(const char* data, std::size_t size, const char* delims, std::size_t count);
+};
+
+} // namespace serial
+
+#endif
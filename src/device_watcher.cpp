@@ -0,0 +1,199 @@
+#include "device_watcher.h"
+
+#if !defined(BOOST_WINDOWS) && !defined(__CYGWIN__) && !defined(_WIN32)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+# include <sys/eventfd.h>
+# include <sys/inotify.h>
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__NetBSD__) || defined(__OpenBSD__)
+# include <sys/event.h>
+# define SERIAL_DEVICE_WATCHER_KQUEUE
+#endif
+
+using namespace serial;
+
+static std::string dir_name(const std::string& path) {
+    std::string::size_type slash = path.rfind('/');
+    if(slash == std::string::npos)
+        return ".";
+    return slash == 0 ? std::string("/") : path.substr(0, slash);
+}
+
+static long long monotonic_milliseconds() {
+    struct timespec now;
+    ::clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+// The milliseconds left until deadline, -1 for none
+static int remaining(long long deadline) {
+    if(deadline < 0)
+        return -1;
+    long long left = deadline - monotonic_milliseconds();
+    return left > 0 ? int(left) : 0;
+}
+
+#if defined(__linux__)
+
+// Returns an inotify descriptor watching the closest existing parent of path, -1 on failure
+static int watch_parent(const std::string& path) {
+    int fd = ::inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+    if(fd < 0)
+        return -1;
+    std::string dir = dir_name(path);
+    while(::inotify_add_watch(fd, dir.c_str(), IN_CREATE | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF) < 0) {
+        if(errno != ENOENT || dir == "/" || dir == ".") {
+            ::close(fd);
+            return -1;
+        }
+        dir = dir_name(dir);
+    }
+    return fd;
+}
+
+#elif defined(SERIAL_DEVICE_WATCHER_KQUEUE)
+
+# ifndef O_EVTONLY
+#  define O_EVTONLY O_RDONLY
+# endif
+
+// Returns a kqueue watching the closest existing parent of path, -1 on failure. The parent
+// stays open in dir_fd, as kqueue needs it to be.
+static int watch_parent(const std::string& path, int& dir_fd) {
+    std::string dir = dir_name(path);
+    while((dir_fd = ::open(dir.c_str(), O_EVTONLY)) < 0) {
+        if(errno != ENOENT || dir == "/" || dir == ".")
+            return -1;
+        dir = dir_name(dir);
+    }
+    int fd = ::kqueue();
+    struct kevent change;
+    EV_SET(&change, dir_fd, EVFILT_VNODE, EV_ADD | EV_CLEAR, NOTE_WRITE | NOTE_DELETE | NOTE_RENAME, 0, 0);
+    if(fd < 0 || ::kevent(fd, &change, 1, NULL, 0, NULL) < 0) {
+        if(fd >= 0)
+            ::close(fd);
+        ::close(dir_fd);
+        return -1;
+    }
+    return fd;
+}
+
+#endif
+
+DeviceWatcher::DeviceWatcher() {
+    this->cancel_fd[0] = -1;
+    this->cancel_fd[1] = -1;
+}
+
+DeviceWatcher::~DeviceWatcher() {
+    for(int i = 0; i < 2; ++i) {
+        if(this->cancel_fd[i] >= 0)
+            ::close(this->cancel_fd[i]);
+    }
+}
+
+int DeviceWatcher::cancel_descriptor() {
+    boost::mutex::scoped_lock lock(this->mutex);
+    if(this->cancel_fd[0] < 0) {
+#if defined(__linux__)
+        this->cancel_fd[0] = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#else
+        if(::pipe(this->cancel_fd) == 0) {
+            for(int i = 0; i < 2; ++i) {
+                ::fcntl(this->cancel_fd[i], F_SETFL, ::fcntl(this->cancel_fd[i], F_GETFL) | O_NONBLOCK);
+                ::fcntl(this->cancel_fd[i], F_SETFD, FD_CLOEXEC);
+            }
+        }
+#endif
+    }
+    return this->cancel_fd[0];
+}
+
+void DeviceWatcher::cancel() {
+    boost::mutex::scoped_lock lock(this->mutex);
+#if defined(__linux__)
+    uint64_t value = 1;
+    if(this->cancel_fd[0] >= 0) {
+        ssize_t result = ::write(this->cancel_fd[0], &value, sizeof(value));
+        (void)result;
+    }
+#else
+    char byte = 0;
+    if(this->cancel_fd[1] >= 0) {
+        ssize_t result = ::write(this->cancel_fd[1], &byte, 1);
+        (void)result;
+    }
+#endif
+}
+
+void DeviceWatcher::reset() {
+    int fd = this->cancel_descriptor();
+    char buffer[64];
+    while(fd >= 0 && ::read(fd, buffer, sizeof(buffer)) > 0) {}
+}
+
+bool DeviceWatcher::wait(const std::string& path, long timeout) {
+    int cancel_fd = this->cancel_descriptor();
+    long long deadline = timeout < 0 ? -1 : monotonic_milliseconds() + timeout;
+    while(true) {
+        // Watch before looking, so the device cannot appear in between unnoticed. The
+        // watch is set up again after each change, as the directory watched may change.
+#if defined(__linux__)
+        int fd = watch_parent(path);
+#elif defined(SERIAL_DEVICE_WATCHER_KQUEUE)
+        int dir_fd = -1;
+        int fd = watch_parent(path, dir_fd);
+#else
+        int fd = -1;
+#endif
+        if(::access(path.c_str(), F_OK) == 0) {
+            if(fd >= 0)
+                ::close(fd);
+#if defined(SERIAL_DEVICE_WATCHER_KQUEUE)
+            if(dir_fd >= 0)
+                ::close(dir_fd);
+#endif
+            return true;
+        }
+        
+        int wait = remaining(deadline);
+        if(wait == 0) {
+            if(fd >= 0)
+                ::close(fd);
+#if defined(SERIAL_DEVICE_WATCHER_KQUEUE)
+            if(dir_fd >= 0)
+                ::close(dir_fd);
+#endif
+            return false;
+        }
+        // Without a watch look again after a while, the cancel descriptor is waited on
+        // either way, and is left signaled until reset()
+        if(fd < 0 && (wait < 0 || wait > SERIAL_HOTPLUG_POLL_INTERVAL))
+            wait = SERIAL_HOTPLUG_POLL_INTERVAL;
+        struct pollfd pfds[2];
+        pfds[0].fd = cancel_fd;
+        pfds[1].fd = fd;
+        for(int i = 0; i < 2; ++i) {
+            pfds[i].events = POLLIN;
+            pfds[i].revents = 0;
+        }
+        ::poll(pfds, 2, wait);
+        if(fd >= 0)
+            ::close(fd);
+#if defined(SERIAL_DEVICE_WATCHER_KQUEUE)
+        if(dir_fd >= 0)
+            ::close(dir_fd);
+#endif
+        if(pfds[0].revents != 0)
+            return false;
+    }
+}
+
+#endif
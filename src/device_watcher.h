@@ -0,0 +1,61 @@
+#ifndef SERIAL_DEVICE_WATCHER_H
+#define SERIAL_DEVICE_WATCHER_H
+
+#include <string>
+
+#include <boost/thread/mutex.hpp>
+
+// How often the device is looked for where the system cannot tell when it appears
+#ifndef SERIAL_HOTPLUG_POLL_INTERVAL
+#define SERIAL_HOTPLUG_POLL_INTERVAL 50
+#endif
+
+namespace serial {
+
+/** Waits for a device to appear, e.g. a USB serial adapter which is plugged back in.
+* 
+* On Linux the wait blocks in inotify on the directory the device belongs in, or on its
+* closest parent which exists while that is still missing, as for the /dev/serial/by-id
+* links which udev only creates once the device is back. On macOS and the BSDs it blocks in
+* kqueue on the directory. Elsewhere the path is checked every
+* SERIAL_HOTPLUG_POLL_INTERVAL milliseconds. POSIX only, like the reconnects it serves.
+* 
+* A wait can be canceled from another thread. The descriptor which cancel() signals is
+* created by the first wait or reset(), so ports which never reconnect do not have one.
+*/
+class DeviceWatcher {
+public:
+    DeviceWatcher();
+    ~DeviceWatcher();
+    
+    /** Waits until path exists.
+    * 
+    * @param path The device, or a link to it.
+    * 
+    * @param timeout The most milliseconds to wait, negative to wait forever.
+    * 
+    * @return true if the device exists, false if the timeout expired or the wait was
+    *         canceled first.
+    */
+    bool wait(const std::string& path, long timeout);
+    
+    /** Makes the current wait return false. If no thread is waiting the next wait returns
+    * false straight away, unless reset() is called first. */
+    void cancel();
+    
+    /** Discards a cancel() which no wait has seen yet. */
+    void reset();
+private:
+    DeviceWatcher(const DeviceWatcher&);
+    void operator=(const DeviceWatcher&);
+    
+    int cancel_descriptor();
+    
+    // An eventfd on Linux, otherwise the read end of a pipe whose write end is cancel_fd[1]
+    boost::mutex mutex;
+    int cancel_fd[2];
+};
+
+} // namespace serial
+
+#endif
@@ -0,0 +1,234 @@
+#include "serial/framer.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace serial;
+
+/** Delimiter Framer **/
+
+DelimiterFramer::DelimiterFramer(const std::string& delimiter, size_t max_frame_size)
+    : delimiter(delimiter), max_frame_size(max_frame_size), scanned(0) {}
+
+size_t DelimiterFramer::extract(char* data, size_t size, const char*& frame, size_t& frame_size,
+                                bool& discarded) {
+    // Resume the search where the last call stopped, less a possibly split delimiter
+    std::size_t start = 0;
+    if(this->scanned >= this->delimiter.length())
+        start = this->scanned - this->delimiter.length() + 1;
+    char *found = std::search(data + start, data + size, this->delimiter.begin(), this->delimiter.end());
+    if(found == data + size || this->delimiter.empty()) {
+        this->scanned = size;
+        if(size > this->max_frame_size) { // Give up on this frame
+            this->scanned = 0;
+            frame = NULL;
+            frame_size = 0;
+            discarded = true;
+            return size;
+        }
+        return 0;
+    }
+    
+    this->scanned = 0;
+    frame = data;
+    frame_size = found - data;
+    discarded = false;
+    return frame_size + this->delimiter.length();
+}
+
+void DelimiterFramer::encode(const char* data, size_t size, std::vector<char>& encoded) const {
+    encoded.insert(encoded.end(), data, data + size);
+    encoded.insert(encoded.end(), this->delimiter.begin(), this->delimiter.end());
+}
+
+void DelimiterFramer::reset() {
+    this->scanned = 0;
+}
+
+/** Length Prefix Framer **/
+
+LengthPrefixFramer::LengthPrefixFramer(size_t prefix_size, bool big_endian, size_t max_frame_size)
+    : prefix_size(prefix_size), big_endian(big_endian), max_frame_size(max_frame_size) {
+    if(this->prefix_size != 1 && this->prefix_size != 2 && this->prefix_size != 4)
+        this->prefix_size = 2;
+}
+
+size_t LengthPrefixFramer::extract(char* data, size_t size, const char*& frame, size_t& frame_size,
+                                   bool& discarded) {
+    if(size < this->prefix_size)
+        return 0;
+    
+    const unsigned char *prefix = reinterpret_cast<const unsigned char*>(data);
+    std::size_t length = 0;
+    for(std::size_t i = 0; i < this->prefix_size; ++i) {
+        std::size_t byte = this->big_endian ? i : this->prefix_size - 1 - i;
+        length = (length << 8) | prefix[byte];
+    }
+    if(length > this->max_frame_size) { // Corrupt length, there is no way to resync so drop everything
+        frame = NULL;
+        frame_size = 0;
+        discarded = true;
+        return size;
+    }
+    if(size < this->prefix_size + length)
+        return 0;
+    
+    frame = data + this->prefix_size;
+    frame_size = length;
+    discarded = false;
+    return this->prefix_size + length;
+}
+
+void LengthPrefixFramer::encode(const char* data, size_t size, std::vector<char>& encoded) const {
+    if(this->prefix_size < sizeof(size_t) && size >> (8 * this->prefix_size) != 0)
+        throw(FrameTooLargeException());
+    
+    for(std::size_t i = 0; i < this->prefix_size; ++i) {
+        std::size_t shift = this->big_endian ? this->prefix_size - 1 - i : i;
+        encoded.push_back(char((size >> (8 * shift)) & 0xFF));
+    }
+    encoded.insert(encoded.end(), data, data + size);
+}
+
+/** SLIP Framer **/
+
+static const char SLIP_END = char(0xC0);
+static const char SLIP_ESC = char(0xDB);
+static const char SLIP_ESC_END = char(0xDC);
+static const char SLIP_ESC_ESC = char(0xDD);
+
+SlipFramer::SlipFramer(size_t max_frame_size) : max_frame_size(max_frame_size), scanned(0) {}
+
+size_t SlipFramer::extract(char* data, size_t size, const char*& frame, size_t& frame_size,
+                           bool& discarded) {
+    // Escaped bytes never contain END, so find the end of the frame before decoding it
+    char *end = static_cast<char*>(std::memchr(data + this->scanned, SLIP_END, size - this->scanned));
+    if(end == NULL) {
+        this->scanned = size;
+        if(size > this->max_frame_size) {
+            this->scanned = 0;
+            frame = NULL;
+            frame_size = 0;
+            discarded = true;
+            return size;
+        }
+        return 0;
+    }
+    this->scanned = 0;
+    
+    // Decode in place, the decoded frame is never longer than the encoded one
+    std::size_t encoded_size = end - data, w = 0;
+    frame = data;
+    discarded = false;
+    for(std::size_t r = 0; r < encoded_size; ++r) {
+        if(data[r] != SLIP_ESC) {
+            data[w++] = data[r];
+        } else if(r + 1 < encoded_size && data[r + 1] == SLIP_ESC_END) {
+            data[w++] = SLIP_END;
+            ++r;
+        } else if(r + 1 < encoded_size && data[r + 1] == SLIP_ESC_ESC) {
+            data[w++] = SLIP_ESC;
+            ++r;
+        } else { // Protocol violation
+            frame = NULL;
+            discarded = true;
+            break;
+        }
+    }
+    
+    // Back to back END bytes, like the leading END of each encoded frame, produce empty
+    // frames which are skipped rather than discarded
+    if(w == 0)
+        frame = NULL;
+    frame_size = frame != NULL ? w : 0;
+    return encoded_size + 1;
+}
+
+void SlipFramer::encode(const char* data, size_t size, std::vector<char>& encoded) const {
+    // A leading END flushes any line noise received before the frame
+    encoded.push_back(SLIP_END);
+    for(std::size_t i = 0; i < size; ++i) {
+        if(data[i] == SLIP_END) {
+            encoded.push_back(SLIP_ESC);
+            encoded.push_back(SLIP_ESC_END);
+        } else if(data[i] == SLIP_ESC) {
+            encoded.push_back(SLIP_ESC);
+            encoded.push_back(SLIP_ESC_ESC);
+        } else {
+            encoded.push_back(data[i]);
+        }
+    }
+    encoded.push_back(SLIP_END);
+}
+
+void SlipFramer::reset() {
+    this->scanned = 0;
+}
+
+/** COBS Framer **/
+
+CobsFramer::CobsFramer(size_t max_frame_size) : max_frame_size(max_frame_size), scanned(0) {}
+
+size_t CobsFramer::extract(char* data, size_t size, const char*& frame, size_t& frame_size,
+                           bool& discarded) {
+    char *end = static_cast<char*>(std::memchr(data + this->scanned, 0, size - this->scanned));
+    if(end == NULL) {
+        this->scanned = size;
+        if(size > this->max_frame_size) {
+            this->scanned = 0;
+            frame = NULL;
+            frame_size = 0;
+            discarded = true;
+            return size;
+        }
+        return 0;
+    }
+    this->scanned = 0;
+    
+    // Decode in place, each code byte is replaced by a zero (or nothing) so we never overtake r
+    std::size_t encoded_size = end - data, r = 0, w = 0;
+    // Back to back zero bytes produce empty frames, which are skipped
+    frame = encoded_size > 0 ? data : NULL;
+    discarded = false;
+    while(r < encoded_size) {
+        unsigned char code = static_cast<unsigned char>(data[r++]);
+        if(r + code - 1 > encoded_size) { // The code runs past the end of the frame
+            frame = NULL;
+            discarded = true;
+            break;
+        }
+        for(unsigned char i = 1; i < code; ++i)
+            data[w++] = data[r++];
+        if(code < 0xFF && r < encoded_size)
+            data[w++] = 0;
+    }
+    
+    frame_size = frame != NULL ? w : 0;
+    return encoded_size + 1;
+}
+
+void CobsFramer::encode(const char* data, size_t size, std::vector<char>& encoded) const {
+    std::size_t code_index = encoded.size();
+    unsigned char code = 1;
+    encoded.push_back(0);
+    for(std::size_t i = 0; i < size; ++i) {
+        if(data[i] != 0) {
+            encoded.push_back(data[i]);
+            ++code;
+        }
+        if(data[i] == 0 || code == 0xFF) {
+            encoded[code_index] = char(code);
+            code = 1;
+            code_index = encoded.size();
+            // A full block followed by the end of the data needs no extra code byte
+            if(data[i] == 0 || i + 1 < size)
+                encoded.push_back(0);
+        }
+    }
+    if(code_index < encoded.size())
+        encoded[code_index] = char(code);
+    encoded.push_back(0);
+}
+
+void CobsFramer::reset() {
+    this->scanned = 0;
+}
@@ -0,0 +1,88 @@
+#include "serial/latency_histogram.h"
+#include <cstring>
+
+using namespace serial;
+
+const size_t LatencyHistogram::SUB_BUCKETS;
+const size_t LatencyHistogram::BUCKETS;
+
+LatencyHistogram::LatencyHistogram() {
+    this->reset();
+}
+
+size_t LatencyHistogram::bucketIndex(uint64_t nanoseconds) {
+    // Values below SUB_BUCKETS are exact, above that each power of two gets SUB_BUCKETS buckets
+    if(nanoseconds < SUB_BUCKETS)
+        return size_t(nanoseconds);
+    size_t exponent = 0;
+    for(uint64_t v = nanoseconds; v > 1; v >>= 1)
+        ++exponent;
+    size_t index = (exponent - 2) * SUB_BUCKETS + size_t((nanoseconds >> (exponent - 3)) & (SUB_BUCKETS - 1));
+    return index < BUCKETS ? index : BUCKETS - 1;
+}
+
+uint64_t LatencyHistogram::bucketLowerBound(size_t bucket) {
+    if(bucket < SUB_BUCKETS)
+        return bucket;
+    size_t exponent = bucket / SUB_BUCKETS + 2;
+    return (uint64_t(SUB_BUCKETS + bucket % SUB_BUCKETS)) << (exponent - 3);
+}
+
+void LatencyHistogram::record(uint64_t nanoseconds) {
+    this->buckets[bucketIndex(nanoseconds)] += 1;
+    if(nanoseconds > this->max_)
+        this->max_ = nanoseconds;
+}
+
+void LatencyHistogram::add(const LatencyHistogram& other) {
+    for(size_t i = 0; i < BUCKETS; ++i)
+        this->buckets[i] += other.buckets[i];
+    if(other.max_ > this->max_)
+        this->max_ = other.max_;
+}
+
+void LatencyHistogram::add(const uint64_t* buckets, uint64_t max) {
+    for(size_t i = 0; i < BUCKETS; ++i)
+        this->buckets[i] += buckets[i];
+    if(max > this->max_)
+        this->max_ = max;
+}
+
+void LatencyHistogram::reset() {
+    std::memset(this->buckets, 0, sizeof(this->buckets));
+    this->max_ = 0;
+}
+
+uint64_t LatencyHistogram::count() const {
+    uint64_t total = 0;
+    for(size_t i = 0; i < BUCKETS; ++i)
+        total += this->buckets[i];
+    return total;
+}
+
+uint64_t LatencyHistogram::max() const {
+    return this->max_;
+}
+
+uint64_t LatencyHistogram::percentile(double fraction) const {
+    uint64_t total = this->count();
+    if(total == 0)
+        return 0;
+    uint64_t target = uint64_t(fraction * total + 0.5);
+    if(target < 1)
+        target = 1;
+    uint64_t seen = 0;
+    for(size_t i = 0; i < BUCKETS; ++i) {
+        seen += this->buckets[i];
+        if(seen >= target) {
+            // Report the bucket's upper bound, never more than the real maximum
+            uint64_t upper = i + 1 < BUCKETS ? bucketLowerBound(i + 1) - 1 : this->max_;
+            return upper < this->max_ ? upper : this->max_;
+        }
+    }
+    return this->max_;
+}
+
+uint64_t LatencyHistogram::bucketCount(size_t bucket) const {
+    return bucket < BUCKETS ? this->buckets[bucket] : 0;
+}
@@ -0,0 +1,101 @@
+#include "low_latency.h"
+
+#if defined(__linux__)
+# include <fstream>
+# include <limits.h>
+# include <stdlib.h>
+# include <sys/ioctl.h>
+# include <linux/serial.h>
+#endif
+
+using namespace serial;
+
+LowLatencyProfile::LowLatencyProfile() : set_low_latency_flag(false) {}
+
+#if defined(__linux__)
+
+// The sysfs directory of a tty, found through the real name of the device
+static std::string tty_sysfs_path(const std::string& device) {
+    char resolved[PATH_MAX];
+    if(::realpath(device.c_str(), resolved) == NULL)
+        return std::string();
+    std::string name(resolved);
+    std::string::size_type slash = name.rfind('/');
+    if(slash != std::string::npos)
+        name = name.substr(slash + 1);
+    return "/sys/class/tty/" + name;
+}
+
+static bool read_attribute(const std::string& path, std::string& value) {
+    std::ifstream file(path.c_str());
+    return bool(std::getline(file, value)) && !value.empty();
+}
+
+static bool write_attribute(const std::string& path, const std::string& value) {
+    std::ofstream file(path.c_str());
+    file << value << std::endl;
+    return bool(file);
+}
+
+// Saves the attribute's value and replaces it, leaving saved empty if that fails
+static bool replace_attribute(const std::string& path, const std::string& value, std::string& saved) {
+    saved.clear();
+    std::string current;
+    if(!read_attribute(path, current))
+        return false;
+    if(current == value || !write_attribute(path, value))
+        return false;
+    saved = current;
+    return true;
+}
+
+bool LowLatencyProfile::apply(native_handle_type handle, const std::string& device) {
+    bool applied = false;
+    
+    struct serial_struct info;
+    if(::ioctl(handle, TIOCGSERIAL, &info) == 0 && !(info.flags & ASYNC_LOW_LATENCY)) {
+        info.flags |= ASYNC_LOW_LATENCY;
+        this->set_low_latency_flag = ::ioctl(handle, TIOCSSERIAL, &info) == 0;
+        applied = this->set_low_latency_flag;
+    }
+    
+    std::string sysfs = tty_sysfs_path(device);
+    if(!sysfs.empty()) {
+        // ftdi_sio flushes its receive buffer every latency_timer milliseconds
+        if(replace_attribute(sysfs + "/device/latency_timer", "1", this->saved_latency_timer))
+            applied = true;
+        // 8250 UARTs raise the receive interrupt when this many bytes are in the FIFO
+        if(replace_attribute(sysfs + "/rx_trig_bytes", "1", this->saved_rx_trigger))
+            applied = true;
+    }
+    return applied;
+}
+
+void LowLatencyProfile::restore(native_handle_type handle, const std::string& device) {
+    if(this->set_low_latency_flag) {
+        struct serial_struct info;
+        if(::ioctl(handle, TIOCGSERIAL, &info) == 0) {
+            info.flags &= ~ASYNC_LOW_LATENCY;
+            ::ioctl(handle, TIOCSSERIAL, &info);
+        }
+        this->set_low_latency_flag = false;
+    }
+    
+    std::string sysfs = tty_sysfs_path(device);
+    if(!sysfs.empty() && !this->saved_latency_timer.empty())
+        write_attribute(sysfs + "/device/latency_timer", this->saved_latency_timer);
+    if(!sysfs.empty() && !this->saved_rx_trigger.empty())
+        write_attribute(sysfs + "/rx_trig_bytes", this->saved_rx_trigger);
+    this->saved_latency_timer.clear();
+    this->saved_rx_trigger.clear();
+}
+
+#else
+
+bool LowLatencyProfile::apply(native_handle_type, const std::string&) {
+    return false;
+}
+
+void LowLatencyProfile::restore(native_handle_type, const std::string&) {}
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef SERIAL_LOW_LATENCY_H
+#define SERIAL_LOW_LATENCY_H
+
+#include <string>
+
+#include <boost/asio.hpp>
+
+namespace serial {
+
+/** Tunes a serial port's driver to deliver received bytes as soon as possible.
+* 
+* On Linux this sets ASYNC_LOW_LATENCY with TIOCSSERIAL, which drivers such as ftdi_sio
+* use to shorten how long they hold received bytes, lowers the latency timer of FTDI USB
+* adapters from its 16 ms default to 1 ms, and sets the receive FIFO trigger of 16550 class
+* UARTs to a single byte. The latter two go through sysfs and usually need write access.
+* Every step is best effort, and the previous driver settings are kept so that restore()
+* can put them back. Other systems have no equivalent and are left unchanged.
+*/
+class LowLatencyProfile {
+public:
+#if defined(BOOST_WINDOWS) || defined(__CYGWIN__)
+    typedef HANDLE native_handle_type;
+#else
+    typedef int native_handle_type;
+#endif
+    
+    LowLatencyProfile();
+    
+    /** Applies the profile to an open port.
+    * 
+    * @param handle The port's native handle.
+    * 
+    * @param device The port's device name, used to find it in sysfs.
+    * 
+    * @return true if at least one setting was changed.
+    */
+    bool apply(native_handle_type handle, const std::string& device);
+    
+    /** Undoes what the last apply() changed. */
+    void restore(native_handle_type handle, const std::string& device);
+private:
+    // Whether apply() set ASYNC_LOW_LATENCY, and the sysfs values it replaced (empty if
+    // they were not changed)
+    bool set_low_latency_flag;
+    std::string saved_latency_timer;
+    std::string saved_rx_trigger;
+};
+
+} // namespace serial
+
+#endif
@@ -0,0 +1,297 @@
+#include "modem_lines.h"
+
+#include <cstring>
+
+#if !(defined(BOOST_WINDOWS) || defined(__CYGWIN__))
+# include <errno.h>
+# include <sys/ioctl.h>
+# if defined(__linux__)
+#  include <linux/serial.h>
+# endif
+#endif
+
+#include <boost/thread/once.hpp>
+
+using namespace serial;
+
+#if defined(BOOST_WINDOWS) || defined(__CYGWIN__)
+static boost::system::error_code last_error() {
+    return boost::system::error_code(::GetLastError(), boost::system::system_category());
+}
+#else
+static boost::system::error_code last_error() {
+    return boost::system::error_code(errno, boost::system::system_category());
+}
+#endif
+
+ModemLines::ModemLines() : generation(0), wait_generation(0), waiting(false) {
+#if defined(BOOST_WINDOWS) || defined(__CYGWIN__)
+    this->wait_event = NULL;
+    this->cancel_event = NULL;
+#else
+    this->signal_wakeup = false;
+#endif
+}
+
+ModemLines::~ModemLines() {
+    this->cancel();
+#if defined(BOOST_WINDOWS) || defined(__CYGWIN__)
+    if(this->wait_event != NULL)
+        ::CloseHandle(this->wait_event);
+    if(this->cancel_event != NULL)
+        ::CloseHandle(this->cancel_event);
+#endif
+}
+
+unsigned long ModemLines::begin_wait() {
+    boost::mutex::scoped_lock lock(this->mutex);
+    if(this->waiting)
+        boost::asio::detail::throw_error(boost::asio::error::already_started, "wait");
+#if defined(BOOST_WINDOWS) || defined(__CYGWIN__)
+    if(this->wait_event == NULL) {
+        this->wait_event = ::CreateEvent(NULL, TRUE, FALSE, NULL);
+        if(this->wait_event == NULL)
+            boost::asio::detail::throw_error(last_error(), "CreateEvent");
+    }
+    if(this->cancel_event == NULL) {
+        this->cancel_event = ::CreateEvent(NULL, TRUE, FALSE, NULL);
+        if(this->cancel_event == NULL)
+            boost::asio::detail::throw_error(last_error(), "CreateEvent");
+    }
+    ::ResetEvent(this->cancel_event);
+#else
+    this->waiter = ::pthread_self();
+    this->signal_wakeup = false;
+#endif
+    this->waiting = true;
+    this->wait_generation = this->generation;
+    return this->generation;
+}
+
+void ModemLines::end_wait() {
+    boost::mutex::scoped_lock lock(this->mutex);
+    this->waiting = false;
+    this->condition.notify_all();
+}
+
+bool ModemLines::is_canceled(unsigned long generation) {
+    boost::mutex::scoped_lock lock(this->mutex);
+    return this->generation != generation;
+}
+
+bool ModemLines::wait(native_handle_type handle, unsigned int lines, unsigned int& status) {
+    unsigned long generation = this->begin_wait();
+    bool changed = false;
+    try {
+        changed = this->wait_for_change(handle, lines, generation);
+    } catch(...) {
+        this->end_wait();
+        throw;
+    }
+    this->end_wait();
+    if(changed)
+        status = ModemLines::status(handle);
+    return changed;
+}
+
+void ModemLines::cancel() {
+    boost::mutex::scoped_lock lock(this->mutex);
+    ++this->generation;
+    while(this->waiting && this->wait_generation != this->generation) {
+#if defined(BOOST_WINDOWS) || defined(__CYGWIN__)
+        ::SetEvent(this->cancel_event);
+#elif defined(TIOCMIWAIT) && SERIAL_MODEM_WAKEUP_SIGNAL
+        if(this->signal_wakeup)
+            ::pthread_kill(this->waiter, SERIAL_MODEM_WAKEUP_SIGNAL);
+#endif
+        this->condition.notify_all();
+        // The signal is lost if it arrives just before the waiter blocks, so send it again
+        this->condition.timed_wait(lock, boost::posix_time::milliseconds(1));
+    }
+}
+
+#if defined(BOOST_WINDOWS) || defined(__CYGWIN__)
+
+void ModemLines::set_rts(native_handle_type handle, bool level) {
+    if(!::EscapeCommFunction(handle, level ? SETRTS : CLRRTS))
+        boost::asio::detail::throw_error(last_error(), "EscapeCommFunction");
+}
+
+void ModemLines::set_dtr(native_handle_type handle, bool level) {
+    if(!::EscapeCommFunction(handle, level ? SETDTR : CLRDTR))
+        boost::asio::detail::throw_error(last_error(), "EscapeCommFunction");
+}
+
+unsigned int ModemLines::status(native_handle_type handle) {
+    DWORD status = 0;
+    if(!::GetCommModemStatus(handle, &status))
+        boost::asio::detail::throw_error(last_error(), "GetCommModemStatus");
+    return (status & MS_CTS_ON ? MODEM_CTS : 0) | (status & MS_DSR_ON ? MODEM_DSR : 0) |
+           (status & MS_RING_ON ? MODEM_RI : 0) | (status & MS_RLSD_ON ? MODEM_CD : 0);
+}
+
+bool ModemLines::wait_for_change(native_handle_type handle, unsigned int lines, unsigned long generation) {
+    DWORD mask = (lines & MODEM_CTS ? EV_CTS : 0) | (lines & MODEM_DSR ? EV_DSR : 0) |
+                 (lines & MODEM_RI ? EV_RING : 0) | (lines & MODEM_CD ? EV_RLSD : 0);
+    if(!::SetCommMask(handle, mask))
+        boost::asio::detail::throw_error(last_error(), "SetCommMask");
+    
+    // The low bit keeps the completion off the port's I/O completion port, if it has one
+    OVERLAPPED overlapped;
+    ::ZeroMemory(&overlapped, sizeof(overlapped));
+    overlapped.hEvent = reinterpret_cast<HANDLE>(reinterpret_cast<DWORD_PTR>(this->wait_event) | 1);
+    DWORD events = 0;
+    if(::WaitCommEvent(handle, &events, &overlapped))
+        return events != 0;
+    if(::GetLastError() != ERROR_IO_PENDING)
+        boost::asio::detail::throw_error(last_error(), "WaitCommEvent");
+    
+    HANDLE handles[2] = { this->wait_event, this->cancel_event };
+    DWORD result = ::WaitForMultipleObjects(2, handles, FALSE, INFINITE);
+    if(result != WAIT_OBJECT_0)
+        ::CancelIoEx(handle, &overlapped);
+    DWORD transferred = 0;
+    if(!::GetOverlappedResult(handle, &overlapped, &transferred, TRUE)) {
+        if(::GetLastError() == ERROR_OPERATION_ABORTED && this->is_canceled(generation))
+            return false;
+        boost::asio::detail::throw_error(last_error(), "WaitCommEvent");
+    }
+    // Changing the mask completes the wait with no events, which counts as a cancel
+    return events != 0 && !this->is_canceled(generation);
+}
+
+#else
+
+static void set_modem_lines(ModemLines::native_handle_type handle, int lines, bool level) {
+    if(::ioctl(handle, level ? TIOCMBIS : TIOCMBIC, &lines) < 0)
+        boost::asio::detail::throw_error(last_error(), "ioctl");
+}
+
+void ModemLines::set_rts(native_handle_type handle, bool level) {
+    set_modem_lines(handle, TIOCM_RTS, level);
+}
+
+void ModemLines::set_dtr(native_handle_type handle, bool level) {
+    set_modem_lines(handle, TIOCM_DTR, level);
+}
+
+unsigned int ModemLines::status(native_handle_type handle) {
+    int status = 0;
+    if(::ioctl(handle, TIOCMGET, &status) < 0)
+        boost::asio::detail::throw_error(last_error(), "ioctl");
+    return (status & TIOCM_CTS ? MODEM_CTS : 0) | (status & TIOCM_DSR ? MODEM_DSR : 0) |
+           (status & TIOCM_RI ? MODEM_RI : 0) | (status & TIOCM_CD ? MODEM_CD : 0);
+}
+
+#if defined(TIOCMIWAIT) && SERIAL_MODEM_WAKEUP_SIGNAL
+static void wakeup_handler(int) {}
+
+static void install_wakeup_handler() {
+    // Installed without SA_RESTART so the signal interrupts TIOCMIWAIT, a handler the
+    // application already installed is left alone
+    struct sigaction action;
+    if(::sigaction(SERIAL_MODEM_WAKEUP_SIGNAL, NULL, &action) < 0)
+        return;
+    if((action.sa_flags & SA_SIGINFO) || action.sa_handler != SIG_DFL)
+        return;
+    std::memset(&action, 0, sizeof(action));
+    action.sa_handler = wakeup_handler;
+    sigemptyset(&action.sa_mask);
+    ::sigaction(SERIAL_MODEM_WAKEUP_SIGNAL, &action, NULL);
+}
+
+static boost::once_flag wakeup_handler_once = BOOST_ONCE_INIT;
+
+// Checked before every wait, the application may ignore, block or take over the signal
+static bool can_wake_up() {
+    boost::call_once(&install_wakeup_handler, wakeup_handler_once);
+    struct sigaction action;
+    if(::sigaction(SERIAL_MODEM_WAKEUP_SIGNAL, NULL, &action) < 0)
+        return false;
+    if((action.sa_flags & (SA_SIGINFO | SA_RESTART)) || action.sa_handler != wakeup_handler)
+        return false;
+    sigset_t blocked;
+    if(::pthread_sigmask(SIG_BLOCK, NULL, &blocked) != 0)
+        return false;
+    return !sigismember(&blocked, SERIAL_MODEM_WAKEUP_SIGNAL);
+}
+#endif
+
+// Sums the transitions the driver has counted on the given lines, so changes which revert
+// between two polls are not missed. Returns false if the driver does not count them.
+static bool count_transitions(ModemLines::native_handle_type handle, unsigned int lines,
+                              unsigned long& transitions) {
+#ifdef TIOCGICOUNT
+    struct serial_icounter_struct counters;
+    if(::ioctl(handle, TIOCGICOUNT, &counters) < 0) {
+        if(errno == EINVAL || errno == ENOTTY)
+            return false;
+        boost::asio::detail::throw_error(last_error(), "ioctl");
+    }
+    transitions = (lines & MODEM_CTS ? counters.cts : 0) + (lines & MODEM_DSR ? counters.dsr : 0) +
+                  (lines & MODEM_RI ? counters.rng : 0) + (lines & MODEM_CD ? counters.dcd : 0);
+    return true;
+#else
+    (void)handle;
+    (void)lines;
+    (void)transitions;
+    return false;
+#endif
+}
+
+bool ModemLines::wait_for_change(native_handle_type handle, unsigned int lines, unsigned long generation) {
+#if defined(TIOCMIWAIT) && SERIAL_MODEM_WAKEUP_SIGNAL
+    if(can_wake_up()) {
+        {
+            boost::mutex::scoped_lock lock(this->mutex);
+            this->signal_wakeup = true;
+        }
+        int mask = (lines & MODEM_CTS ? TIOCM_CTS : 0) | (lines & MODEM_DSR ? TIOCM_DSR : 0) |
+                   (lines & MODEM_RI ? TIOCM_RI : 0) | (lines & MODEM_CD ? TIOCM_CD : 0);
+        int result = -1;
+        while(!this->is_canceled(generation)) {
+            result = ::ioctl(handle, TIOCMIWAIT, mask);
+            if(result == 0 || errno != EINTR)
+                break;
+        }
+        int error = errno;
+        {
+            boost::mutex::scoped_lock lock(this->mutex);
+            this->signal_wakeup = false;
+        }
+        if(this->is_canceled(generation))
+            return false;
+        if(result == 0)
+            return true;
+        if(error != EINVAL && error != ENOTTY) {
+            errno = error;
+            boost::asio::detail::throw_error(last_error(), "ioctl");
+        }
+        // Not supported by this driver
+    }
+#endif
+    return this->poll_for_change(handle, lines, generation);
+}
+
+bool ModemLines::poll_for_change(native_handle_type handle, unsigned int lines, unsigned long generation) {
+    // cancel() wakes us through the condition
+    unsigned long transitions = 0, current_transitions = 0;
+    bool counted = count_transitions(handle, lines, transitions);
+    unsigned int initial = counted ? 0 : ModemLines::status(handle) & lines;
+    boost::mutex::scoped_lock lock(this->mutex);
+    while(this->generation == generation) {
+        this->condition.timed_wait(lock, boost::posix_time::milliseconds(SERIAL_MODEM_POLL_INTERVAL));
+        if(this->generation != generation)
+            break;
+        lock.unlock();
+        bool changed = counted ? count_transitions(handle, lines, current_transitions) &&
+                                 current_transitions != transitions
+                               : (ModemLines::status(handle) & lines) != initial;
+        lock.lock();
+        if(changed)
+            return true;
+    }
+    return false;
+}
+
+#endif
@@ -0,0 +1,112 @@
+#ifndef SERIAL_MODEM_LINES_H
+#define SERIAL_MODEM_LINES_H
+
+#include <boost/asio.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+#if !(defined(BOOST_WINDOWS) || defined(__CYGWIN__))
+# include <pthread.h>
+# include <signal.h>
+#endif
+
+#include "serial/serial.h"
+
+// How often the lines are read when the driver cannot wait for them to change
+#ifndef SERIAL_MODEM_POLL_INTERVAL
+#define SERIAL_MODEM_POLL_INTERVAL 10
+#endif
+
+// Sent to a thread blocked in TIOCMIWAIT to cancel its wait, defining it as 0 disables
+// TIOCMIWAIT so no signal handler is installed and the lines are always polled
+#ifndef SERIAL_MODEM_WAKEUP_SIGNAL
+#define SERIAL_MODEM_WAKEUP_SIGNAL SIGURG
+#endif
+
+namespace serial {
+
+/** Reads, sets and waits for changes of the modem lines of an open serial port.
+* 
+* The lines are accessed through the port's native handle, so the same code serves
+* boost::asio::serial_port and the native backends. Waiting blocks in TIOCMIWAIT or
+* WaitCommEvent instead of polling. TIOCMIWAIT can only be canceled by a signal, so it is
+* used only while the SERIAL_MODEM_WAKEUP_SIGNAL handler installed by the first wait is
+* in place and the signal is not blocked in the waiting thread. Otherwise, or where the
+* driver does not support TIOCMIWAIT, the transition counters (TIOCGICOUNT) or the lines
+* themselves are read every SERIAL_MODEM_POLL_INTERVAL milliseconds, which cancel() ends
+* without a signal.
+*/
+class ModemLines {
+public:
+#if defined(BOOST_WINDOWS) || defined(__CYGWIN__)
+    typedef HANDLE native_handle_type;
+#else
+    typedef int native_handle_type;
+#endif
+    
+    ModemLines();
+    ~ModemLines();
+    
+    /** Sets the RTS line.
+    * 
+    * @throw boost::system::system_error
+    */
+    static void set_rts(native_handle_type handle, bool level);
+    
+    /** Sets the DTR line.
+    * 
+    * @throw boost::system::system_error
+    */
+    static void set_dtr(native_handle_type handle, bool level);
+    
+    /** Gets the state of the CTS, DSR, RI and CD lines as a mask of modemline_t.
+    * 
+    * @throw boost::system::system_error
+    */
+    static unsigned int status(native_handle_type handle);
+    
+    /** Blocks until one of the lines in the mask changes.
+    * Only one thread can wait at a time, boost::asio::error::already_started is thrown to
+    * any other.
+    * 
+    * @return false if the wait was canceled, otherwise true with status set to the state
+    *         of the lines after the change.
+    * 
+    * @throw boost::system::system_error
+    */
+    bool wait(native_handle_type handle, unsigned int lines, unsigned int& status);
+    
+    /** Cancels the current wait, if any, and returns once it has been canceled. */
+    void cancel();
+private:
+    ModemLines(const ModemLines&);
+    void operator=(const ModemLines&);
+    
+    unsigned long begin_wait();
+    void end_wait();
+    bool is_canceled(unsigned long generation);
+    bool wait_for_change(native_handle_type handle, unsigned int lines, unsigned long generation);
+#if !(defined(BOOST_WINDOWS) || defined(__CYGWIN__))
+    bool poll_for_change(native_handle_type handle, unsigned int lines, unsigned long generation);
+#endif
+    
+    // Incremented by cancel(), a wait which started in an older generation is canceled
+    boost::mutex mutex;
+    boost::condition_variable condition;
+    unsigned long generation;
+    unsigned long wait_generation;
+    bool waiting;
+#if defined(BOOST_WINDOWS) || defined(__CYGWIN__)
+    // Created by the first wait
+    HANDLE wait_event;
+    HANDLE cancel_event;
+#else
+    pthread_t waiter;
+    // Whether the waiter is blocked in TIOCMIWAIT, only then is it sent the wakeup signal
+    bool signal_wakeup;
+#endif
+};
+
+} // namespace serial
+
+#endif
@@ -0,0 +1,249 @@
+#include "serial/port_info.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+
+#if defined(BOOST_WINDOWS) || defined(_WIN32) || defined(__CYGWIN__)
+# include <windows.h>
+# include <setupapi.h>
+# include <initguid.h>
+# include <devguid.h>
+#else
+# include <dirent.h>
+# include <limits.h>
+# include <stdlib.h>
+# if defined(__linux__)
+#  include <fstream>
+# endif
+#endif
+
+using namespace serial;
+
+static bool port_less(const PortInfo& a, const PortInfo& b) {
+    return a.port < b.port;
+}
+
+static std::string usb_hardware_id(const PortInfo& info) {
+    char ids[32];
+    std::snprintf(ids, sizeof(ids), "USB VID:PID=%04x:%04x", unsigned(info.vid), unsigned(info.pid));
+    std::string hardware_id(ids);
+    if(!info.serial_number.empty())
+        hardware_id += " SNR=" + info.serial_number;
+    return hardware_id;
+}
+
+#if defined(__linux__)
+
+static std::string real_path(const std::string& path) {
+    char resolved[PATH_MAX];
+    if(::realpath(path.c_str(), resolved) == NULL)
+        return std::string();
+    return std::string(resolved);
+}
+
+static std::string base_name(const std::string& path) {
+    std::string::size_type slash = path.rfind('/');
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+static std::string dir_name(const std::string& path) {
+    std::string::size_type slash = path.rfind('/');
+    return slash == std::string::npos || slash == 0 ? std::string("/") : path.substr(0, slash);
+}
+
+static std::string read_attribute(const std::string& path) {
+    std::ifstream file(path.c_str());
+    std::string value;
+    std::getline(file, value);
+    return value;
+}
+
+static std::vector<std::string> list_directory(const std::string& path) {
+    std::vector<std::string> names;
+    DIR *dir = ::opendir(path.c_str());
+    if(dir == NULL)
+        return names;
+    while(struct dirent *entry = ::readdir(dir)) {
+        if(entry->d_name[0] != '.')
+            names.push_back(entry->d_name);
+    }
+    ::closedir(dir);
+    return names;
+}
+
+// Fills in the USB attributes from the first parent of the tty's device which has them,
+// the interface's parent for ttyACM and the one above that for usb-serial's ttyUSB
+static void read_usb_attributes(const std::string& device, PortInfo& info) {
+    std::string dir = device;
+    for(int level = 0; level < 4 && dir.size() > std::string("/sys/devices").size(); ++level) {
+        std::string vid = read_attribute(dir + "/idVendor");
+        if(!vid.empty()) {
+            info.vid = uint16_t(std::strtoul(vid.c_str(), NULL, 16));
+            info.pid = uint16_t(std::strtoul(read_attribute(dir + "/idProduct").c_str(), NULL, 16));
+            info.serial_number = read_attribute(dir + "/serial");
+            info.manufacturer = read_attribute(dir + "/manufacturer");
+            info.description = read_attribute(dir + "/product");
+            info.hardware_id = usb_hardware_id(info);
+            return;
+        }
+        dir = dir_name(dir);
+    }
+}
+
+std::vector<PortInfo> serial::list_ports() {
+    // The by-id links are named after the USB device, find which tty each one points to
+    std::map<std::string, std::string> by_id;
+    std::vector<std::string> links = list_directory("/dev/serial/by-id");
+    for(std::size_t i = 0; i < links.size(); ++i) {
+        std::string link = "/dev/serial/by-id/" + links[i];
+        std::string target = real_path(link);
+        if(!target.empty())
+            by_id[target] = link;
+    }
+    
+    std::vector<PortInfo> ports;
+    std::vector<std::string> names = list_directory("/sys/class/tty");
+    for(std::size_t i = 0; i < names.size(); ++i) {
+        std::string sysfs = "/sys/class/tty/" + names[i];
+        // Virtual terminals and ptys have no device, the 8250 driver registers placeholders
+        // for UARTs which may not exist on its platform device
+        std::string device = real_path(sysfs + "/device");
+        if(device.empty() || base_name(real_path(device + "/driver")) == "serial8250")
+            continue;
+        
+        PortInfo info;
+        info.port = "/dev/" + names[i];
+        read_usb_attributes(device, info);
+        if(info.description.empty())
+            info.description = names[i];
+        std::map<std::string, std::string>::const_iterator link = by_id.find(info.port);
+        if(link != by_id.end())
+            info.by_id = link->second;
+        ports.push_back(info);
+    }
+    std::sort(ports.begin(), ports.end(), port_less);
+    return ports;
+}
+
+#elif defined(BOOST_WINDOWS) || defined(_WIN32) || defined(__CYGWIN__)
+
+static std::string registry_property(HDEVINFO devices, SP_DEVINFO_DATA& data, DWORD property) {
+    char value[256];
+    DWORD size = 0;
+    if(!::SetupDiGetDeviceRegistryPropertyA(devices, &data, property, NULL, reinterpret_cast<PBYTE>(value),
+                                            sizeof(value) - 1, &size))
+        return std::string();
+    value[std::min<DWORD>(size, sizeof(value) - 1)] = '\0';
+    return std::string(value);
+}
+
+// Reads a hexadecimal id such as the 0403 after "VID_" in a hardware id
+static uint16_t hardware_id_field(const std::string& hardware_id, const char* key) {
+    std::string::size_type at = hardware_id.find(key);
+    if(at == std::string::npos)
+        return 0;
+    return uint16_t(std::strtoul(hardware_id.substr(at + std::strlen(key), 4).c_str(), NULL, 16));
+}
+
+std::vector<PortInfo> serial::list_ports() {
+    std::vector<PortInfo> ports;
+    HDEVINFO devices = ::SetupDiGetClassDevsA(&GUID_DEVCLASS_PORTS, NULL, NULL, DIGCF_PRESENT);
+    if(devices == INVALID_HANDLE_VALUE)
+        return ports;
+    
+    SP_DEVINFO_DATA data;
+    data.cbSize = sizeof(data);
+    for(DWORD index = 0; ::SetupDiEnumDeviceInfo(devices, index, &data); ++index) {
+        // The COM name is only in the device's registry key, LPT ports share the class
+        HKEY key = ::SetupDiOpenDevRegKey(devices, &data, DICS_FLAG_GLOBAL, 0, DIREG_DEV, KEY_READ);
+        if(key == INVALID_HANDLE_VALUE)
+            continue;
+        char name[64];
+        DWORD size = sizeof(name) - 1;
+        DWORD type = 0;
+        LONG result = ::RegQueryValueExA(key, "PortName", NULL, &type, reinterpret_cast<LPBYTE>(name), &size);
+        ::RegCloseKey(key);
+        if(result != ERROR_SUCCESS || type != REG_SZ)
+            continue;
+        name[std::min<DWORD>(size, sizeof(name) - 1)] = '\0';
+        if(std::strncmp(name, "COM", 3) != 0)
+            continue;
+        
+        PortInfo info;
+        info.port = name;
+        info.description = registry_property(devices, data, SPDRP_FRIENDLYNAME);
+        info.manufacturer = registry_property(devices, data, SPDRP_MFG);
+        
+        // The instance id of a USB device is USB\VID_0403&PID_6001\A900ABCD, the last part
+        // is its serial number unless Windows made one up, which then contains a '&'
+        char instance[256];
+        if(::SetupDiGetDeviceInstanceIdA(devices, &data, instance, sizeof(instance), NULL) &&
+           std::strncmp(instance, "USB\\", 4) == 0) {
+            std::string id(instance);
+            info.vid = hardware_id_field(id, "VID_");
+            info.pid = hardware_id_field(id, "PID_");
+            std::string::size_type slash = id.rfind('\\');
+            if(slash != std::string::npos && id.find('&', slash) == std::string::npos)
+                info.serial_number = id.substr(slash + 1);
+            info.hardware_id = usb_hardware_id(info);
+        } else {
+            info.hardware_id = registry_property(devices, data, SPDRP_HARDWAREID);
+        }
+        if(info.description.empty())
+            info.description = info.port;
+        ports.push_back(info);
+    }
+    ::SetupDiDestroyDeviceInfoList(devices);
+    std::sort(ports.begin(), ports.end(), port_less);
+    return ports;
+}
+
+#else
+
+std::vector<PortInfo> serial::list_ports() {
+    // The callout devices, which open without waiting for carrier detect: cu.* on macOS,
+    // cuaU* for USB and cuau* for UARTs on FreeBSD
+    static const char *prefixes[] = { "cu.", "cuaU", "cuau" };
+    
+    std::vector<PortInfo> ports;
+    DIR *dir = ::opendir("/dev");
+    if(dir == NULL)
+        return ports;
+    while(struct dirent *entry = ::readdir(dir)) {
+        std::string name(entry->d_name);
+        for(std::size_t i = 0; i < sizeof(prefixes) / sizeof(prefixes[0]); ++i) {
+            // Skip the .init and .lock variants FreeBSD adds for each callout device
+            if(name.compare(0, std::strlen(prefixes[i]), prefixes[i]) == 0 && name.find(".init") == std::string::npos &&
+               name.find(".lock") == std::string::npos) {
+                PortInfo info;
+                info.port = "/dev/" + name;
+                info.description = name;
+                ports.push_back(info);
+                break;
+            }
+        }
+    }
+    ::closedir(dir);
+    std::sort(ports.begin(), ports.end(), port_less);
+    return ports;
+}
+
+#endif
+
+std::vector<PortInfo> serial::find_ports(uint16_t vid, uint16_t pid, const std::string& serial_number) {
+    std::vector<PortInfo> ports = list_ports();
+    std::vector<PortInfo> matches;
+    for(std::size_t i = 0; i < ports.size(); ++i) {
+        if(ports[i].vid == 0 || ports[i].vid != vid)
+            continue;
+        if(pid != 0 && ports[i].pid != pid)
+            continue;
+        if(!serial_number.empty() && ports[i].serial_number != serial_number)
+            continue;
+        matches.push_back(ports[i]);
+    }
+    return matches;
+}
@@ -0,0 +1,124 @@
+#include "posix_serial_port.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+using namespace serial;
+
+static boost::system::error_code last_error() {
+    return boost::system::error_code(errno, boost::system::system_category());
+}
+
+PosixSerialPort::PosixSerialPort(const std::string& device) : fd(-1) {
+    this->fd = ::open(device.c_str(), O_RDWR | O_NONBLOCK | O_NOCTTY);
+    if(this->fd < 0)
+        boost::asio::detail::throw_error(last_error(), "open");
+    
+    // Raw mode, the same settings boost::asio::serial_port starts from
+    struct termios storage;
+    boost::system::error_code ec;
+    this->get_attributes(storage, ec);
+    if(!ec) {
+        storage.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL | IXON);
+        storage.c_oflag &= ~OPOST;
+        storage.c_lflag &= ~(ECHO | ECHONL | ICANON | ISIG | IEXTEN);
+        storage.c_cflag &= ~(CSIZE | PARENB);
+        storage.c_cflag |= CS8;
+        storage.c_iflag |= IGNPAR;
+        storage.c_cflag |= CREAD | CLOCAL;
+        this->set_attributes(storage, ec);
+    }
+    if(ec) {
+        ::close(this->fd);
+        boost::asio::detail::throw_error(ec, "set_option");
+    }
+}
+
+PosixSerialPort::~PosixSerialPort() {
+    this->close();
+}
+
+bool PosixSerialPort::is_open() const {
+    return this->fd >= 0;
+}
+
+void PosixSerialPort::close() {
+    if(this->descriptor) {
+        // The descriptor does not own the fd, it is closed below
+        this->descriptor->cancel();
+        this->descriptor->release();
+        this->descriptor.reset();
+    }
+    if(this->fd >= 0) {
+        ::close(this->fd);
+        this->fd = -1;
+    }
+}
+
+void PosixSerialPort::cancel() {
+    if(this->descriptor)
+        this->descriptor->cancel();
+}
+
+PosixSerialPort::native_handle_type PosixSerialPort::native_handle() {
+    return this->fd;
+}
+
+void PosixSerialPort::replace(native_handle_type fd) {
+    // The stream_descriptor is registered with the reactor for the old device
+    if(this->descriptor) {
+        this->descriptor->cancel();
+        this->descriptor->release();
+        this->descriptor.reset();
+    }
+    int result;
+    do {
+        result = ::dup2(fd, this->fd);
+    } while(result < 0 && errno == EINTR);
+    boost::system::error_code ec = result < 0 ? last_error() : boost::system::error_code();
+    ::close(fd);
+    boost::asio::detail::throw_error(ec, "dup2");
+}
+
+void PosixSerialPort::get_attributes(struct termios& storage, boost::system::error_code& ec) {
+    ec = ::tcgetattr(this->fd, &storage) < 0 ? last_error() : boost::system::error_code();
+}
+
+void PosixSerialPort::set_attributes(const struct termios& storage, boost::system::error_code& ec) {
+    ec = ::tcsetattr(this->fd, TCSANOW, &storage) < 0 ? last_error() : boost::system::error_code();
+}
+
+boost::asio::posix::stream_descriptor& PosixSerialPort::async_stream(boost::asio::io_service& io_service) {
+    if(!this->descriptor)
+        this->descriptor.reset(new boost::asio::posix::stream_descriptor(io_service, this->fd));
+    return *this->descriptor;
+}
+
+std::size_t PosixSerialPort::write_iovecs(struct iovec* iov, int count, boost::system::error_code& ec) {
+    ec = boost::system::error_code();
+    if(count == 0)
+        return 0;
+    while(true) {
+        ssize_t result = ::writev(this->fd, iov, count);
+        if(result >= 0)
+            return std::size_t(result);
+        if(errno == EINTR)
+            continue;
+        if(errno != EAGAIN && errno != EWOULDBLOCK) {
+            ec = last_error();
+            return 0;
+        }
+        
+        // The descriptor is non-blocking, so wait for room in the output buffer
+        struct pollfd pfd;
+        pfd.fd = this->fd;
+        pfd.events = POLLOUT;
+        pfd.revents = 0;
+        if(::poll(&pfd, 1, -1) < 0 && errno != EINTR) {
+            ec = last_error();
+            return 0;
+        }
+    }
+}
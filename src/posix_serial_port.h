@@ -0,0 +1,126 @@
+#ifndef SERIAL_POSIX_SERIAL_PORT_H
+#define SERIAL_POSIX_SERIAL_PORT_H
+
+#include <string>
+
+#include <boost/asio.hpp>
+#include <boost/asio/posix/stream_descriptor.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <sys/uio.h>
+#include <termios.h>
+
+namespace serial {
+
+/** A serial port which is configured, read and written directly on its file descriptor.
+* 
+* It provides the part of the boost::asio::serial_port interface used by Serial, so it can
+* stand in for it on POSIX systems. Synchronous operations never touch an io_service, the
+* stream_descriptor used for asynchronous operations is only created when first needed.
+*/
+class PosixSerialPort {
+public:
+    typedef int native_handle_type;
+    
+    /** Opens the device in raw mode and non-blocking, like boost::asio::serial_port.
+    * 
+    * @throw boost::system::system_error
+    */
+    explicit PosixSerialPort(const std::string& device);
+    
+    /** Destructor, closes the port. */
+    ~PosixSerialPort();
+    
+    bool is_open() const;
+    
+    void close();
+    
+    /** Cancels outstanding asynchronous operations, if any were started. */
+    void cancel();
+    
+    native_handle_type native_handle();
+    
+    /** Replaces the port's descriptor with another one, e.g. the device opened again after
+    * it was unplugged, and closes the other one.
+    * 
+    * dup2() keeps native_handle() the same, so threads using it carry on with the new
+    * device. Outstanding asynchronous operations are canceled, later ones get a new
+    * stream_descriptor.
+    * 
+    * @throw boost::system::system_error
+    */
+    void replace(native_handle_type fd);
+    
+    /** Applies one of the boost::asio::serial_port_base options with a single tcsetattr().
+    * 
+    * @throw boost::system::system_error
+    */
+    template <typename SettableSerialPortOption>
+    void set_option(const SettableSerialPortOption& option) {
+        boost::system::error_code ec;
+        this->set_option(option, ec);
+        boost::asio::detail::throw_error(ec, "set_option");
+    }
+    
+    template <typename SettableSerialPortOption>
+    void set_option(const SettableSerialPortOption& option, boost::system::error_code& ec) {
+        struct termios storage;
+        this->get_attributes(storage, ec);
+        if(!ec)
+            option.store(storage, ec);
+        if(!ec)
+            this->set_attributes(storage, ec);
+    }
+    
+    /** Gets a stream_descriptor on the port for asynchronous operations, creating it on
+    * the given io_service the first time this is called. */
+    boost::asio::posix::stream_descriptor& async_stream(boost::asio::io_service& io_service);
+    
+    /** Writes the buffers with one writev() call, waiting for the port to become writable
+    * if its output buffer is full. Used by boost::asio::write(). */
+    template <typename ConstBufferSequence>
+    std::size_t write_some(const ConstBufferSequence& buffers, boost::system::error_code& ec) {
+        struct iovec iov[max_iovecs];
+        int count = fill_iovecs(boost::asio::buffer_sequence_begin(buffers),
+                                boost::asio::buffer_sequence_end(buffers), iov);
+        return this->write_iovecs(iov, count, ec);
+    }
+    
+    template <typename ConstBufferSequence>
+    std::size_t write_some(const ConstBufferSequence& buffers) {
+        boost::system::error_code ec;
+        std::size_t bytes_written = this->write_some(buffers, ec);
+        boost::asio::detail::throw_error(ec, "write_some");
+        return bytes_written;
+    }
+private:
+    PosixSerialPort(const PosixSerialPort&);
+    void operator=(const PosixSerialPort&);
+    
+    static const int max_iovecs = 16;
+    
+    template <typename Iterator>
+    static int fill_iovecs(Iterator begin, Iterator end, struct iovec* iov) {
+        int count = 0;
+        for(; begin != end && count < max_iovecs; ++begin) {
+            boost::asio::const_buffer buffer(*begin);
+            if(buffer.size() == 0)
+                continue;
+            iov[count].iov_base = const_cast<void*>(buffer.data());
+            iov[count].iov_len = buffer.size();
+            ++count;
+        }
+        return count;
+    }
+    
+    void get_attributes(struct termios& storage, boost::system::error_code& ec);
+    void set_attributes(const struct termios& storage, boost::system::error_code& ec);
+    std::size_t write_iovecs(struct iovec* iov, int count, boost::system::error_code& ec);
+    
+    int fd;
+    boost::scoped_ptr<boost::asio::posix::stream_descriptor> descriptor;
+};
+
+} // namespace serial
+
+#endif
@@ -0,0 +1,235 @@
+#include "read_buffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "delimiter_scan.h"
+
+using namespace serial;
+
+static const boost::posix_time::time_duration timeout_zero_comparison(boost::posix_time::milliseconds(0));
+
+// Counts one more of something, the counters are only statistics
+static void count(boost::atomic<uint64_t>* counter) {
+    if(counter)
+        counter->fetch_add(1, boost::memory_order_relaxed);
+}
+
+ReadBuffer::ReadBuffer(Source& source, boost::atomic<uint64_t>* timeouts, boost::atomic<uint64_t>* framing_errors,
+                       boost::atomic<uint64_t>* checksum_errors)
+    : source(source), timeouts(timeouts), framing_errors(framing_errors), checksum_errors(checksum_errors),
+      begin(0), end(0) {}
+
+char* ReadBuffer::prepare(std::size_t size) {
+    // Make room at the end of the buffer, moving unread data to the front first
+    if(this->begin > 0) {
+        std::size_t buffered = this->end - this->begin;
+        if(buffered > 0)
+            std::memmove(&this->buffer[0], &this->buffer[this->begin], buffered);
+        this->begin = 0;
+        this->end = buffered;
+    }
+    if(this->buffer.size() - this->end < size)
+        this->buffer.resize(std::max(std::max<std::size_t>(this->buffer.size() * 2, DEFAULT_READ_BUFFER_SIZE),
+                                     this->end + size));
+    return &this->buffer[0] + this->end;
+}
+
+void ReadBuffer::consume(std::size_t size) {
+    this->begin += size;
+    
+    // The framer's position in the stream is no longer the start of the buffer
+    if(this->framer && size > 0)
+        this->framer->reset();
+}
+
+std::size_t ReadBuffer::drain(char* buffer, std::size_t size) {
+    std::size_t buffered = this->end - this->begin;
+    if(size > buffered)
+        size = buffered;
+    if(size > 0) {
+        std::memcpy(buffer, &this->buffer[this->begin], size);
+        this->consume(size);
+    }
+    return size;
+}
+
+void ReadBuffer::clear() {
+    this->begin = 0;
+    this->end = 0;
+    if(this->framer)
+        this->framer->reset();
+}
+
+std::size_t ReadBuffer::fill(const boost::posix_time::time_duration& timeout, bool nonblocking) {
+    char *space = this->prepare();
+    std::size_t bytes_read = this->source.fill(space, this->space(), timeout, nonblocking);
+    this->end += bytes_read;
+    return bytes_read;
+}
+
+bool ReadBuffer::scan(const std::string& delim, bool any, std::size_t size, std::size_t& scanned,
+                      std::size_t& length) {
+    const char *begin = this->data();
+    length = std::min(this->end - this->begin, size);
+    
+    // Only search the newly read bytes, plus enough of the old ones to catch a split delimiter.
+    // With any, each byte of delim is a delimiter of its own.
+    std::size_t start = scanned, found, found_length = 1;
+    if(any) {
+        found = DelimiterScanner::find_any(begin + start, length - start, delim.data(), delim.length());
+    } else {
+        if(scanned >= delim.length())
+            start = std::min(scanned - delim.length() + 1, length);
+        else
+            start = 0;
+        found = DelimiterScanner::find(begin + start, length - start, delim.data(), delim.length());
+        found_length = delim.length();
+    }
+    if(start + found != length) {
+        length = start + found + found_length;
+        return true;
+    }
+    scanned = length;
+    return length == size;
+}
+
+std::size_t ReadBuffer::fill_until(const std::string& delim, bool any, std::size_t size,
+                                   const boost::posix_time::time_duration& timeout) {
+    using namespace boost::posix_time;
+    
+    // The timeout applies to the whole call, not each fill of the buffer. Without one, as
+    // with the default timeout of zero, it waits for the delimiter like read_until always has.
+    bool has_timeout = timeout > timeout_zero_comparison;
+    ptime deadline;
+    if(has_timeout)
+        deadline = microsec_clock::universal_time() + timeout;
+    
+    std::size_t length = 0, scanned = 0;
+    while(!this->scan(delim, any, size, scanned, length)) {
+        time_duration remaining = timeout;
+        if(has_timeout) {
+            remaining = deadline - microsec_clock::universal_time();
+            if(remaining <= timeout_zero_comparison) {
+                count(this->timeouts);
+                break;
+            }
+        }
+        if(this->fill(remaining, false) == 0) // Timed out, at the end of a replay or an error occured
+            break;
+    }
+    return length;
+}
+
+void ReadBuffer::setFramer(boost::shared_ptr<Framer> framer) {
+    this->framer = framer;
+    if(this->framer)
+        this->framer->reset();
+}
+
+bool ReadBuffer::read_frame(const char*& frame, std::size_t& size, const boost::posix_time::time_duration& timeout,
+                            bool nonblocking) {
+    using namespace boost::posix_time;
+    
+    if(!this->framer)
+        throw(FramerNotSetException());
+    
+    bool has_timeout = timeout > timeout_zero_comparison;
+    ptime deadline;
+    if(has_timeout)
+        deadline = microsec_clock::universal_time() + timeout;
+    
+    while(true) {
+        std::size_t buffered = this->end - this->begin;
+        if(buffered > 0) {
+            const char *frame_ = NULL;
+            std::size_t frame_size = 0;
+            bool discarded = false;
+            std::size_t consumed = this->framer->extract(&this->buffer[this->begin], buffered, frame_, frame_size,
+                                                         discarded);
+            if(consumed > 0) {
+                this->begin += consumed;
+                if(frame_ != NULL) {
+                    if(this->checksum) {
+                        if(!this->checksum->verify(frame_, frame_size)) {
+                            count(this->checksum_errors);
+                            continue;
+                        }
+                        frame_size -= this->checksum->size();
+                    }
+                    frame = frame_;
+                    size = frame_size;
+                    return true;
+                }
+                if(discarded)
+                    count(this->framing_errors);
+                continue; // The framer skipped or discarded data, there may be more frames buffered
+            }
+        }
+        
+        time_duration remaining = timeout;
+        if(has_timeout) {
+            remaining = deadline - microsec_clock::universal_time();
+            if(remaining <= timeout_zero_comparison) {
+                count(this->timeouts);
+                return false;
+            }
+        }
+        if(this->fill(remaining, nonblocking) == 0) // Timed out, non-blocking or an error occured
+            return false;
+    }
+}
+
+bool ReadBuffer::read_frame(PooledBuffer& frame, const boost::posix_time::time_duration& timeout,
+                            bool nonblocking) {
+    PooledBuffer frame_ = ReadBuffer::acquire(this->buffer_pool);
+    const char *data = NULL;
+    std::size_t size = 0;
+    while(this->read_frame(data, size, timeout, nonblocking)) {
+        // A frame which does not fit is dropped like one the framer rejects
+        if(size <= frame_.capacity()) {
+            std::memcpy(frame_.data(), data, size);
+            frame_.resize(size);
+            frame = frame_;
+            return true;
+        }
+        count(this->framing_errors);
+    }
+    return false;
+}
+
+void ReadBuffer::encode_frame(const char* data, std::size_t length, std::vector<char>& scratch,
+                              std::vector<char>& encoded) const {
+    if(!this->framer)
+        throw(FramerNotSetException());
+    if(!this->checksum) {
+        this->framer->encode(data, length, encoded);
+        return;
+    }
+    scratch.resize(length + this->checksum->size());
+    if(length > 0)
+        std::memcpy(&scratch[0], data, length);
+    this->checksum->compute(data, length, &scratch[0] + length);
+    this->framer->encode(scratch.empty() ? NULL : &scratch[0], scratch.size(), encoded);
+}
+
+PooledBuffer ReadBuffer::acquire(const boost::shared_ptr<BufferPool>& pool) {
+    if(!pool)
+        throw(BufferPoolNotSetException());
+    PooledBuffer buffer = pool->acquire();
+    if(!buffer.isValid())
+        throw(BufferPoolExhaustedException());
+    return buffer;
+}
+
+std::size_t ReadBuffer::read_until(PooledBuffer& buffer, const std::string& delim, std::size_t size,
+                                   const boost::posix_time::time_duration& timeout) {
+    PooledBuffer buffer_ = ReadBuffer::acquire(this->buffer_pool);
+    std::size_t length = this->fill_until(delim, false, std::min(size, buffer_.capacity()), timeout);
+    if(length > 0)
+        std::memcpy(buffer_.data(), this->data(), length);
+    buffer_.resize(length);
+    this->consume(length);
+    buffer = buffer_;
+    return length;
+}
@@ -0,0 +1,221 @@
+#ifndef SERIAL_READ_BUFFER_H
+#define SERIAL_READ_BUFFER_H
+
+#include <cstddef>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <boost/atomic.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "serial/serial.h"
+
+namespace serial {
+
+/** The data received but not read yet, and the reads which work on it, shared by Serial and
+* ReplaySerial.
+* 
+* read_until and read_frame take more from their Source than they return, the rest waits
+* here for the next read. The buffer is allocated on first use and made room in by moving
+* the unread data to its front, so it only grows when that is not enough. Frames are
+* decoded in place by the Framer and checked against the Checksum, and the frames which are
+* sent are encoded with the same two. The PooledBuffer reads copy what they return once, from
+* the buffer into one from the BufferPool.
+*/
+class ReadBuffer {
+public:
+    /** Where the data comes from, the port for Serial and the capture for ReplaySerial. */
+    class Source {
+    public:
+        virtual ~Source() {}
+        
+        /** Reads at least one byte into buffer, unless the timeout passes first or
+        * nonblocking is set and nothing has been received. A zero timeout waits forever.
+        * 
+        * @return The number of bytes read, 0 if none were.
+        */
+        virtual std::size_t fill(char* buffer, std::size_t size, const boost::posix_time::time_duration& timeout,
+                                 bool nonblocking) = 0;
+    };
+    
+    /** Creates an empty buffer. The counters may be NULL.
+    * 
+    * @param timeouts Counted when fill_until or read_frame gives up because its timeout passed.
+    * 
+    * @param framing_errors Counted for the data the Framer discards.
+    * 
+    * @param checksum_errors Counted for the frames whose Checksum does not match.
+    */
+    explicit ReadBuffer(Source& source, boost::atomic<uint64_t>* timeouts = NULL,
+                        boost::atomic<uint64_t>* framing_errors = NULL,
+                        boost::atomic<uint64_t>* checksum_errors = NULL);
+    
+    /** Gets the number of bytes which have not been read yet. */
+    std::size_t size() const {
+        return this->end - this->begin;
+    }
+    
+    /** Gets the first byte which has not been read yet, NULL before anything was buffered. */
+    const char* data() const {
+        return this->buffer.empty() ? NULL : &this->buffer[0] + this->begin;
+    }
+    
+    char* data() {
+        return this->buffer.empty() ? NULL : &this->buffer[0] + this->begin;
+    }
+    
+    /** Makes room for at least size more bytes.
+    * 
+    * @return Where to put them, commit() the number of bytes put there. There is room for
+    *         space() bytes.
+    */
+    char* prepare(std::size_t size = DEFAULT_READ_BUFFER_SIZE / 2);
+    
+    /** Gets the number of bytes there is room for after the unread ones. */
+    std::size_t space() const {
+        return this->buffer.size() - this->end;
+    }
+    
+    /** Adds size bytes put where prepare() returned to the unread ones. */
+    void commit(std::size_t size) {
+        this->end += size;
+    }
+    
+    /** Drops the first size unread bytes, which resets the Framer. */
+    void consume(std::size_t size);
+    
+    /** Copies up to size unread bytes to buffer and drops them.
+    * 
+    * @return The number of bytes copied.
+    */
+    std::size_t drain(char* buffer, std::size_t size);
+    
+    /** Drops all unread bytes and resets the Framer. */
+    void clear();
+    
+    /** Reads from the Source once, see Source::fill().
+    * 
+    * @return The number of bytes read.
+    */
+    std::size_t fill(const boost::posix_time::time_duration& timeout, bool nonblocking);
+    
+    /** Searches the unread bytes for delim, or with any for any byte of delim.
+    * 
+    * @param scanned The number of bytes searched by the previous call, 0 for the first. Only
+    *        bytes added since then are searched.
+    * 
+    * @param length Set to the length up to and including the delimiter, or the number
+    *        of unread bytes if there is no delimiter in them, at most size.
+    * 
+    * @return Whether the delimiter was found or length reached size.
+    */
+    bool scan(const std::string& delim, bool any, std::size_t size, std::size_t& scanned, std::size_t& length);
+    
+    /** Fills the buffer until it holds delim, or any byte of delim with any, or size bytes.
+    * A zero timeout waits forever, otherwise it applies to the whole call.
+    * 
+    * @return The length of the unread bytes up to and including the delimiter, or all of
+    *         them up to size if the delimiter was not received in time.
+    */
+    std::size_t fill_until(const std::string& delim, bool any, std::size_t size,
+                           const boost::posix_time::time_duration& timeout);
+    
+    void setFramer(boost::shared_ptr<Framer> framer);
+    
+    const boost::shared_ptr<Framer>& getFramer() const {
+        return this->framer;
+    }
+    
+    void setChecksum(boost::shared_ptr<Checksum> checksum) {
+        this->checksum = checksum;
+    }
+    
+    const boost::shared_ptr<Checksum>& getChecksum() const {
+        return this->checksum;
+    }
+    
+    /** Fills the buffer until the Framer finds a frame whose Checksum matches, and strips the
+    * Checksum off. See Source::fill() for timeout and nonblocking, a timeout applies to the
+    * whole call.
+    * 
+    * @param frame Set to the start of the frame, which is valid until the buffer changes.
+    * 
+    * @return false if no complete frame was received.
+    * 
+    * @throw FramerNotSetException
+    */
+    bool read_frame(const char*& frame, std::size_t& size, const boost::posix_time::time_duration& timeout,
+                    bool nonblocking);
+    
+    /** Reads a frame like read_frame(const char*&, size_t&, ...) into a buffer from the
+    * BufferPool. Frames which do not fit are dropped and counted as framing errors.
+    * 
+    * @throw FramerNotSetException
+    * @throw BufferPoolNotSetException
+    * @throw BufferPoolExhaustedException
+    */
+    bool read_frame(PooledBuffer& frame, const boost::posix_time::time_duration& timeout, bool nonblocking);
+    
+    /** Appends the Checksum to data and the encoding of both by the Framer to encoded.
+    * 
+    * @param scratch Holds the payload and Checksum for the Framer, so its storage can be
+    *        reused by the writing thread.
+    * 
+    * @throw FramerNotSetException
+    * @throw FrameTooLargeException
+    */
+    void encode_frame(const char* data, std::size_t length, std::vector<char>& scratch,
+                      std::vector<char>& encoded) const;
+    
+    void setBufferPool(boost::shared_ptr<BufferPool> pool) {
+        this->buffer_pool = pool;
+    }
+    
+    const boost::shared_ptr<BufferPool>& getBufferPool() const {
+        return this->buffer_pool;
+    }
+    
+    /** Takes a buffer out of pool.
+    * 
+    * @throw BufferPoolNotSetException if pool is empty.
+    * @throw BufferPoolExhaustedException
+    */
+    static PooledBuffer acquire(const boost::shared_ptr<BufferPool>& pool);
+    
+    /** Reads like fill_until() into a buffer from the BufferPool, at most its capacity. The
+    * data is removed from the buffer.
+    * 
+    * @return The length of the data read.
+    * 
+    * @throw BufferPoolNotSetException
+    * @throw BufferPoolExhaustedException
+    */
+    std::size_t read_until(PooledBuffer& buffer, const std::string& delim, std::size_t size,
+                           const boost::posix_time::time_duration& timeout);
+private:
+    ReadBuffer(const ReadBuffer&);
+    void operator=(const ReadBuffer&);
+    
+    Source& source;
+    boost::atomic<uint64_t>* timeouts;
+    boost::atomic<uint64_t>* framing_errors;
+    boost::atomic<uint64_t>* checksum_errors;
+    
+    std::vector<char> buffer;
+    std::size_t begin;
+    std::size_t end;
+    
+    // Splits the unread bytes into frames, its position is the start of the buffer
+    boost::shared_ptr<Framer> framer;
+    // Verified and removed from received frames, appended to sent ones before encoding
+    boost::shared_ptr<Checksum> checksum;
+    
+    // Supplies the buffers filled by the PooledBuffer reads
+    boost::shared_ptr<BufferPool> buffer_pool;
+};
+
+} // namespace serial
+
+#endif
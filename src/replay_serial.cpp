@@ -0,0 +1,296 @@
+#include "serial/replay_serial.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <boost/asio.hpp>
+
+#include "read_buffer.h"
+
+using namespace serial;
+
+/** ReplaySerial Implementation Class **/
+
+class ReplaySerial::ReplaySerialImpl : public ReadBuffer::Source {
+public:
+    ReplaySerialImpl(const std::string& path, bool follow_writes);
+    
+    std::size_t available();
+    bool atEnd();
+    void rewind();
+    uint64_t getTimestamp() const;
+    
+    std::size_t read(char* buffer, std::size_t size);
+    std::string read_until(const std::string& delim, bool any, std::size_t size);
+    
+    void setBufferPool(boost::shared_ptr<BufferPool> pool);
+    boost::shared_ptr<BufferPool> getBufferPool() const;
+    std::size_t read_until(PooledBuffer& buffer, const std::string& delim, std::size_t size);
+    bool read_frame(PooledBuffer& frame);
+    
+    void setFramer(boost::shared_ptr<Framer> framer);
+    boost::shared_ptr<Framer> getFramer() const;
+    void setChecksum(boost::shared_ptr<Checksum> checksum);
+    boost::shared_ptr<Checksum> getChecksum() const;
+    bool read_frame(const char*& frame, std::size_t& size);
+    std::size_t write_frame(const char* data, std::size_t length);
+    std::size_t write(const char* data, std::size_t length);
+private:
+    std::size_t fill(char* buffer, std::size_t size, const boost::posix_time::time_duration& timeout,
+                     bool nonblocking);
+    
+    CaptureReader reader;
+    bool follow_writes;
+    bool reader_done;
+    
+    // The received record being replayed and how much of it has been
+    CaptureRecord record;
+    std::size_t record_offset;
+    uint64_t timestamp;
+    
+    // Bytes written to the capture's port up to the last replayed record, and to this replay
+    uint64_t tx_replayed;
+    uint64_t tx_written;
+    
+    // Replayed data which has not been read yet, the Framer and Checksum of read_frame and the
+    // BufferPool of the PooledBuffer reads
+    ReadBuffer read_buffer;
+    
+    std::vector<char> write_frame_buffer;
+    std::vector<char> write_checksum_buffer;
+};
+
+ReplaySerial::ReplaySerialImpl::ReplaySerialImpl(const std::string& path, bool follow_writes)
+    : reader(path), follow_writes(follow_writes), reader_done(false), record_offset(0),
+      timestamp(0), tx_replayed(0), tx_written(0), read_buffer(*this) {
+    this->record.size = 0;
+}
+
+std::size_t ReplaySerial::ReplaySerialImpl::fill(char* buffer, std::size_t size,
+                                                 const boost::posix_time::time_duration& timeout,
+                                                 bool nonblocking) {
+    // Replay never waits, what is not in the capture yet never will be
+    (void)timeout;
+    (void)nonblocking;
+    while(this->record_offset == this->record.size) {
+        // The response to a write can not be replayed before the write has been made
+        if(this->follow_writes && this->tx_written < this->tx_replayed)
+            return 0;
+        if(!this->reader.next(this->record)) {
+            this->reader_done = true;
+            this->record.size = 0;
+            this->record_offset = 0;
+            return 0;
+        }
+        this->record_offset = 0;
+        if(this->record.direction == CAPTURE_TX) {
+            this->tx_replayed += this->record.size;
+            this->record_offset = this->record.size;
+            continue;
+        }
+        this->timestamp = this->record.timestamp;
+    }
+    std::size_t length = std::min(size, this->record.size - this->record_offset);
+    std::memcpy(buffer, this->record.data + this->record_offset, length);
+    this->record_offset += length;
+    return length;
+}
+
+std::size_t ReplaySerial::ReplaySerialImpl::available() {
+    if(this->read_buffer.size() == 0)
+        this->read_buffer.fill(boost::posix_time::time_duration(), false);
+    return this->read_buffer.size();
+}
+
+bool ReplaySerial::ReplaySerialImpl::atEnd() {
+    return this->available() == 0 && this->reader_done;
+}
+
+void ReplaySerial::ReplaySerialImpl::rewind() {
+    this->reader.rewind();
+    this->reader_done = false;
+    this->record.size = 0;
+    this->record_offset = 0;
+    this->timestamp = 0;
+    this->tx_replayed = 0;
+    this->tx_written = 0;
+    this->read_buffer.clear();
+}
+
+uint64_t ReplaySerial::ReplaySerialImpl::getTimestamp() const {
+    return this->timestamp;
+}
+
+std::size_t ReplaySerial::ReplaySerialImpl::read(char* buffer, std::size_t size) {
+    // Serve any data left over from a previous read_until first, then replay straight into buffer
+    std::size_t bytes_read_ = this->read_buffer.drain(buffer, size);
+    while(bytes_read_ < size) {
+        std::size_t length = this->fill(buffer + bytes_read_, size - bytes_read_,
+                                        boost::posix_time::time_duration(), false);
+        if(length == 0)
+            break;
+        bytes_read_ += length;
+    }
+    return bytes_read_;
+}
+
+std::string ReplaySerial::ReplaySerialImpl::read_until(const std::string& delim, bool any, std::size_t size) {
+    std::size_t length = this->read_buffer.fill_until(delim, any, size, boost::posix_time::time_duration());
+    std::string return_str;
+    if(length > 0)
+        return_str.assign(this->read_buffer.data(), length);
+    this->read_buffer.consume(length);
+    return return_str;
+}
+
+void ReplaySerial::ReplaySerialImpl::setBufferPool(boost::shared_ptr<BufferPool> pool) {
+    this->read_buffer.setBufferPool(pool);
+}
+
+boost::shared_ptr<BufferPool> ReplaySerial::ReplaySerialImpl::getBufferPool() const {
+    return this->read_buffer.getBufferPool();
+}
+
+std::size_t ReplaySerial::ReplaySerialImpl::read_until(PooledBuffer& buffer, const std::string& delim,
+                                                       std::size_t size) {
+    return this->read_buffer.read_until(buffer, delim, size, boost::posix_time::time_duration());
+}
+
+bool ReplaySerial::ReplaySerialImpl::read_frame(PooledBuffer& frame) {
+    return this->read_buffer.read_frame(frame, boost::posix_time::time_duration(), false);
+}
+
+void ReplaySerial::ReplaySerialImpl::setFramer(boost::shared_ptr<Framer> framer) {
+    this->read_buffer.setFramer(framer);
+}
+
+boost::shared_ptr<Framer> ReplaySerial::ReplaySerialImpl::getFramer() const {
+    return this->read_buffer.getFramer();
+}
+
+void ReplaySerial::ReplaySerialImpl::setChecksum(boost::shared_ptr<Checksum> checksum) {
+    this->read_buffer.setChecksum(checksum);
+}
+
+boost::shared_ptr<Checksum> ReplaySerial::ReplaySerialImpl::getChecksum() const {
+    return this->read_buffer.getChecksum();
+}
+
+bool ReplaySerial::ReplaySerialImpl::read_frame(const char*& frame, std::size_t& size) {
+    return this->read_buffer.read_frame(frame, size, boost::posix_time::time_duration(), false);
+}
+
+std::size_t ReplaySerial::ReplaySerialImpl::write_frame(const char* data, std::size_t length) {
+    this->write_frame_buffer.clear();
+    this->read_buffer.encode_frame(data, length, this->write_checksum_buffer, this->write_frame_buffer);
+    if(this->write_frame_buffer.empty())
+        return 0;
+    return this->write(&this->write_frame_buffer[0], this->write_frame_buffer.size());
+}
+
+std::size_t ReplaySerial::ReplaySerialImpl::write(const char* data, std::size_t length) {
+    (void)data;
+    this->tx_written += length;
+    return length;
+}
+
+/** ReplaySerial Class Implementation **/
+
+ReplaySerial::ReplaySerial(const std::string& path, bool follow_writes)
+    : pimpl(new ReplaySerialImpl(path, follow_writes)) {}
+
+ReplaySerial::~ReplaySerial() {}
+
+bool ReplaySerial::isOpen() {
+    return true;
+}
+
+size_t ReplaySerial::available() {
+    return this->pimpl->available();
+}
+
+bool ReplaySerial::atEnd() {
+    return this->pimpl->atEnd();
+}
+
+void ReplaySerial::rewind() {
+    this->pimpl->rewind();
+}
+
+uint64_t ReplaySerial::getTimestamp() const {
+    return this->pimpl->getTimestamp();
+}
+
+int ReplaySerial::read(char* buffer, int size) {
+    return int(this->pimpl->read(buffer, std::size_t(std::max(size, 0))));
+}
+
+size_t ReplaySerial::read(const std::vector<boost::asio::mutable_buffer>& buffers) {
+    std::size_t bytes_read = 0;
+    for(std::size_t i = 0; i < buffers.size(); ++i) {
+        std::size_t read_ = this->pimpl->read(static_cast<char*>(buffers[i].data()), buffers[i].size());
+        bytes_read += read_;
+        if(read_ < buffers[i].size())
+            break;
+    }
+    return bytes_read;
+}
+
+std::string ReplaySerial::read_until(std::string delim, size_t size) {
+    return this->pimpl->read_until(delim, false, size);
+}
+
+std::string ReplaySerial::read_until_any(const std::string& delims, size_t size) {
+    return this->pimpl->read_until(delims, true, size);
+}
+
+void ReplaySerial::setBufferPool(boost::shared_ptr<BufferPool> pool) {
+    this->pimpl->setBufferPool(pool);
+}
+
+boost::shared_ptr<BufferPool> ReplaySerial::getBufferPool() const {
+    return this->pimpl->getBufferPool();
+}
+
+size_t ReplaySerial::read_until(PooledBuffer& buffer, const std::string& delim, size_t size) {
+    return this->pimpl->read_until(buffer, delim, size);
+}
+
+void ReplaySerial::setFramer(boost::shared_ptr<Framer> framer) {
+    this->pimpl->setFramer(framer);
+}
+
+boost::shared_ptr<Framer> ReplaySerial::getFramer() const {
+    return this->pimpl->getFramer();
+}
+
+void ReplaySerial::setChecksum(boost::shared_ptr<Checksum> checksum) {
+    this->pimpl->setChecksum(checksum);
+}
+
+boost::shared_ptr<Checksum> ReplaySerial::getChecksum() const {
+    return this->pimpl->getChecksum();
+}
+
+bool ReplaySerial::read_frame(const char*& frame, size_t& size) {
+    return this->pimpl->read_frame(frame, size);
+}
+
+bool ReplaySerial::read_frame(PooledBuffer& frame) {
+    return this->pimpl->read_frame(frame);
+}
+
+size_t ReplaySerial::write_frame(const char* data, size_t length) {
+    return this->pimpl->write_frame(data, length);
+}
+
+int ReplaySerial::write(const char* data, int length) {
+    return int(this->pimpl->write(data, std::size_t(std::max(length, 0))));
+}
+
+size_t ReplaySerial::write(const std::vector<boost::asio::const_buffer>& buffers) {
+    std::size_t bytes_wrote = 0;
+    for(std::size_t i = 0; i < buffers.size(); ++i)
+        bytes_wrote += this->pimpl->write(static_cast<const char*>(buffers[i].data()), buffers[i].size());
+    return bytes_wrote;
+}
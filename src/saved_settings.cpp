@@ -0,0 +1,227 @@
+#include "saved_settings.h"
+
+#include <errno.h>
+
+#if defined(__linux__)
+# include <asm/termbits.h>
+# include <sys/ioctl.h>
+#elif !(defined(BOOST_WINDOWS) || defined(__CYGWIN__))
+# include <termios.h>
+#endif
+
+#include <boost/asio/error.hpp>
+#if !defined(__linux__)
+# include <boost/asio/serial_port_base.hpp>
+#endif
+
+#include "custom_baudrate.h"
+
+using namespace serial;
+
+#if defined(__linux__)
+
+struct SavedSettings::Storage {
+    struct termios2 attributes;
+    
+    bool get(int fd) {
+        return ::ioctl(fd, TCGETS2, &this->attributes) == 0;
+    }
+    
+    bool set(int fd) const {
+        return ::ioctl(fd, TCSETS2, &this->attributes) == 0;
+    }
+    
+    // The same flags as boost::asio::serial_port_base's options, with the rate as a number
+    void update(const PortSettings& settings, boost::system::error_code& ec) {
+        if(settings.stopbits == STOPBITS_ONE_POINT_FIVE) {
+            ec = boost::asio::error::operation_not_supported;
+            return;
+        }
+        struct termios2& t = this->attributes;
+        t.c_cflag &= ~(CBAUD | (CBAUD << IBSHIFT));
+        t.c_cflag |= BOTHER | (BOTHER << IBSHIFT);
+        t.c_ispeed = settings.baudrate;
+        t.c_ospeed = settings.baudrate;
+        
+        t.c_cflag &= ~CSIZE;
+        switch(settings.bytesize) {
+            case FIVEBITS: t.c_cflag |= CS5; break;
+            case SIXBITS: t.c_cflag |= CS6; break;
+            case SEVENBITS: t.c_cflag |= CS7; break;
+            default: t.c_cflag |= CS8; break;
+        }
+        
+        if(settings.parity == PARITY_NONE) {
+            t.c_iflag |= IGNPAR;
+            t.c_cflag &= ~(PARENB | PARODD);
+        } else {
+            t.c_iflag &= ~(IGNPAR | PARMRK);
+            t.c_iflag |= INPCK;
+            t.c_cflag |= PARENB;
+            if(settings.parity == PARITY_ODD)
+                t.c_cflag |= PARODD;
+            else
+                t.c_cflag &= ~PARODD;
+        }
+        
+        if(settings.stopbits == STOPBITS_TWO)
+            t.c_cflag |= CSTOPB;
+        else
+            t.c_cflag &= ~CSTOPB;
+        
+        t.c_iflag &= ~(IXOFF | IXON);
+        t.c_cflag &= ~CRTSCTS;
+        if(settings.flowcontrol == FLOWCONTROL_SOFTWARE)
+            t.c_iflag |= IXOFF | IXON;
+        else if(settings.flowcontrol == FLOWCONTROL_HARDWARE)
+            t.c_cflag |= CRTSCTS;
+        ec = boost::system::error_code();
+    }
+};
+
+#else
+
+// Stores the settings with boost::asio::serial_port_base's own options, into the termios or
+// DCB they use. The rate goes last, as it is the one which can fail on macOS.
+template <typename Storage>
+static void store_options(const PortSettings& settings, Storage& storage, boost::system::error_code& ec) {
+    using boost::asio::serial_port_base;
+    
+    serial_port_base::flow_control::type flowcontrol = serial_port_base::flow_control::none;
+    if(settings.flowcontrol == FLOWCONTROL_SOFTWARE)
+        flowcontrol = serial_port_base::flow_control::software;
+    else if(settings.flowcontrol == FLOWCONTROL_HARDWARE)
+        flowcontrol = serial_port_base::flow_control::hardware;
+    serial_port_base::parity::type parity = serial_port_base::parity::none;
+    if(settings.parity == PARITY_ODD)
+        parity = serial_port_base::parity::odd;
+    else if(settings.parity == PARITY_EVEN)
+        parity = serial_port_base::parity::even;
+    serial_port_base::stop_bits::type stopbits = serial_port_base::stop_bits::one;
+    if(settings.stopbits == STOPBITS_ONE_POINT_FIVE)
+        stopbits = serial_port_base::stop_bits::onepointfive;
+    else if(settings.stopbits == STOPBITS_TWO)
+        stopbits = serial_port_base::stop_bits::two;
+    
+    serial_port_base::flow_control(flowcontrol).store(storage, ec);
+    if(!ec)
+        serial_port_base::parity(parity).store(storage, ec);
+    if(!ec)
+        serial_port_base::stop_bits(stopbits).store(storage, ec);
+    if(!ec)
+        serial_port_base::character_size(settings.bytesize).store(storage, ec);
+    if(!ec)
+        serial_port_base::baud_rate(settings.baudrate).store(storage, ec);
+}
+
+# if defined(BOOST_WINDOWS) || defined(__CYGWIN__)
+
+struct SavedSettings::Storage {
+    DCB dcb;
+    
+    bool get(HANDLE handle) {
+        ::ZeroMemory(&this->dcb, sizeof(this->dcb));
+        this->dcb.DCBlength = sizeof(this->dcb);
+        return ::GetCommState(handle, &this->dcb) != 0;
+    }
+    
+    bool set(HANDLE handle) const {
+        DCB dcb_ = this->dcb;
+        return ::SetCommState(handle, &dcb_) != 0;
+    }
+    
+    void update(const PortSettings& settings, boost::system::error_code& ec) {
+        store_options(settings, this->dcb, ec);
+    }
+};
+
+# else
+
+struct SavedSettings::Storage {
+    struct termios attributes;
+    unsigned int rate;
+    
+    bool get(int fd) {
+        return ::tcgetattr(fd, &this->attributes) == 0;
+    }
+    
+    bool set(int fd) const {
+        if(::tcsetattr(fd, TCSANOW, &this->attributes) != 0)
+            return false;
+#  if defined(__APPLE__)
+        // tcsetattr() put back the speed in the termios, which is not the rate if it was custom
+        if(::cfgetospeed(&this->attributes) != speed_t(this->rate)) {
+            boost::system::error_code ec;
+            CustomBaudrate::set(fd, this->rate, ec);
+            if(ec) {
+                errno = ec.value();
+                return false;
+            }
+        }
+#  endif
+        return true;
+    }
+    
+    void update(const PortSettings& settings, boost::system::error_code& ec) {
+        this->rate = settings.baudrate;
+        store_options(settings, this->attributes, ec);
+#  if defined(__APPLE__)
+        // A rate termios has no constant for is set by set() through CustomBaudrate
+        if(ec == boost::asio::error::invalid_argument)
+            ec = boost::system::error_code();
+#  endif
+    }
+};
+
+# endif
+#endif
+
+SavedSettings::SavedSettings() : valid(false) {}
+
+SavedSettings::~SavedSettings() {}
+
+void SavedSettings::save(native_handle_type handle, unsigned int rate) {
+    if(!this->storage)
+        this->storage.reset(new Storage());
+#if !defined(__linux__) && !(defined(BOOST_WINDOWS) || defined(__CYGWIN__))
+    this->storage->rate = rate;
+#else
+    (void)rate;
+#endif
+    this->valid = this->storage->get(handle);
+}
+
+void SavedSettings::restore(native_handle_type handle, boost::system::error_code& ec) const {
+    if(!this->valid) {
+        ec = boost::asio::error::invalid_argument;
+        return;
+    }
+    if(this->storage->set(handle)) {
+        ec = boost::system::error_code();
+        return;
+    }
+#if defined(BOOST_WINDOWS) || defined(__CYGWIN__)
+    ec = boost::system::error_code(::GetLastError(), boost::system::system_category());
+#else
+    ec = boost::system::error_code(errno, boost::system::system_category());
+#endif
+}
+
+void SavedSettings::update(const PortSettings& settings, boost::system::error_code& ec) {
+    if(!this->valid) {
+        ec = boost::asio::error::invalid_argument;
+        return;
+    }
+    this->storage->update(settings, ec);
+    // What is saved may now be half way between the old settings and the new ones
+    if(ec)
+        this->valid = false;
+}
+
+bool SavedSettings::isValid() const {
+    return this->valid;
+}
+
+void SavedSettings::clear() {
+    this->valid = false;
+}
@@ -0,0 +1,72 @@
+#ifndef SERIAL_SAVED_SETTINGS_H
+#define SERIAL_SAVED_SETTINGS_H
+
+#include <boost/scoped_ptr.hpp>
+#include <boost/system/error_code.hpp>
+
+#include "serial/serial.h"
+
+#if defined(BOOST_WINDOWS) || defined(__CYGWIN__)
+# include <boost/asio.hpp>
+#endif
+
+namespace serial {
+
+/** The complete driver configuration of a port, so it can be put back with one call.
+* 
+* Serial saves it once a port is configured and restores it when the same port is opened
+* again with the same settings, instead of applying each setting in turn. New settings for
+* an open port are made with update() and applied with one restore(). On Linux it is
+* the termios2 of TCGETS2, which includes any custom baud rate, elsewhere the termios
+* of tcgetattr() and on Windows the DCB of GetCommState(). On macOS a baud rate termios has
+* no constant for is set again with CustomBaudrate after the termios is restored. This
+* header is kept free of termios.h like custom_baudrate.h.
+*/
+class SavedSettings {
+public:
+#if defined(BOOST_WINDOWS) || defined(__CYGWIN__)
+    typedef HANDLE native_handle_type;
+#else
+    typedef int native_handle_type;
+#endif
+    
+    SavedSettings();
+    ~SavedSettings();
+    
+    /** Saves the configuration of an open port, only clear() on failure.
+    * 
+    * @param rate The baud rate the port was set to.
+    */
+    void save(native_handle_type handle, unsigned int rate);
+    
+    /** Applies the saved configuration to an open port.
+    * 
+    * @param ec Set to the error, if any.
+    */
+    void restore(native_handle_type handle, boost::system::error_code& ec) const;
+    
+    /** Changes the saved configuration to new settings, leaving the rest of it as it is.
+    * The port is not touched until restore().
+    * 
+    * @param ec Set to the error, e.g. operation_not_supported for settings the system does
+    *        not have. The saved configuration is then cleared.
+    */
+    void update(const PortSettings& settings, boost::system::error_code& ec);
+    
+    /** Whether a configuration has been saved since the last clear(). */
+    bool isValid() const;
+    
+    /** Forgets the saved configuration, e.g. because a setting changed. */
+    void clear();
+private:
+    SavedSettings(const SavedSettings&);
+    void operator=(const SavedSettings&);
+    
+    struct Storage;
+    boost::scoped_ptr<Storage> storage;
+    bool valid;
+};
+
+} // namespace serial
+
+#endif
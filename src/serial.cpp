@@ -1,5 +1,49 @@
 #include "serial/serial.h"
+#include <algorithm>
+#include <cstring>
 #include <iostream>
+#include <sstream>
+
+#include <boost/asio.hpp>
+#include <boost/asio/serial_port.hpp>
+#include <boost/atomic.hpp>
+#include <boost/bind.hpp>
+#include <boost/lockfree/spsc_queue.hpp>
+#include <boost/thread.hpp>
+#include <boost/weak_ptr.hpp>
+
+#include "custom_baudrate.h"
+#include "device_watcher.h"
+#include "low_latency.h"
+#include "modem_lines.h"
+#include "read_buffer.h"
+#include "saved_settings.h"
+
+#if defined(SERIAL_NATIVE_BACKEND) && defined(_WIN32)
+# include "win_serial_port.h"
+#elif defined(SERIAL_NATIVE_BACKEND)
+# include "posix_serial_port.h"
+#endif
+
+#if !defined(BOOST_WINDOWS) && !defined(__CYGWIN__)
+# include <errno.h>
+# include <fcntl.h>
+# include <poll.h>
+# include <sys/ioctl.h>
+# include <time.h>
+# include <unistd.h>
+#endif
+
+// Keeps the state updated by reads and by writes apart, see SerialImpl::StatsCounters
+#ifndef SERIAL_CACHE_LINE_SIZE
+#define SERIAL_CACHE_LINE_SIZE 64
+#endif
+
+// How long a reconnect waits before trying again to open a device which is there but not
+// ready yet, e.g. before udev has given it its permissions
+#ifndef SERIAL_RECONNECT_RETRY_INTERVAL
+#define SERIAL_RECONNECT_RETRY_INTERVAL 10
+#endif
 
 using namespace serial;
 
@@ -34,101 +78,398 @@ private:
     std::size_t minimum_;
 };
 
-/** Classes for Handshaking control **/
+/** Serial Implementation Class **/
 
-#if defined(BOOST_WINDOWS) || defined(__CYGWIN__)
-# define BOOST_ASIO_OPTION_STORAGE DCB
+// The native backends configure and read the port on its handle directly, and only use
+// boost::asio for asynchronous operations
+#if defined(SERIAL_NATIVE_BACKEND) && defined(_WIN32)
+typedef WinSerialPort serial_port_type;
+typedef boost::asio::windows::stream_handle async_stream_type;
+#elif defined(SERIAL_NATIVE_BACKEND)
+typedef PosixSerialPort serial_port_type;
+typedef boost::asio::posix::stream_descriptor async_stream_type;
 #else
-# define BOOST_ASIO_OPTION_STORAGE termios
+typedef boost::asio::serial_port serial_port_type;
+typedef boost::asio::serial_port async_stream_type;
 #endif
 
-class DTRControl {
+class Serial::SerialImpl : public ReadBuffer::Source {
 public:
-    explicit DTRControl(bool enable = false) : m_enable(enable) {};
+    explicit SerialImpl(boost::asio::io_service* io_service);
+    ~SerialImpl();
     
-    boost::system::error_code store(BOOST_ASIO_OPTION_STORAGE& storage,
-                                    boost::system::error_code& ec) const
-    {
-        #if defined(BOOST_WINDOWS) || defined(__CYGWIN__)
-            if(m_enable)
-                storage.fDtrControl = DTR_CONTROL_ENABLE;
-            else
-                storage.fDtrControl = DTR_CONTROL_DISABLE;
-        #else
-            ec = boost::asio::error::operation_not_supported;
-            ec = boost::system::error_code();
-        #endif
-        return ec;
-    };
-    
-    boost::system::error_code load(const BOOST_ASIO_OPTION_STORAGE& storage,
-                                   boost::system::error_code& ec)
-    {
-        #if defined(BOOST_WINDOWS) || defined(__CYGWIN__)
-            if(storage.fDtrControl == DTR_CONTROL_ENABLE)
-                m_enable = true;
-            else
-                m_enable = true;
-        #else
-        #endif
-        return ec;
-    };
+    void setup(std::string port, int baudrate, long timeout, bytesize_t bytesize,
+               parity_t parity, stopbits_t stopbits, flowcontrol_t flowcontrol);
+    void open();
+    bool isOpen();
+    void close();
+    
+    void startReaderThread(std::size_t buffer_size);
+    void stopReaderThread();
+    bool isReaderThreadRunning() const;
+    std::size_t available();
+    bool waitReadable(long timeout);
+    bool waitWritable(long timeout);
+    bool getSelectHandle(intptr_t& handle, unsigned long& generation) const;
+    std::size_t getBufferedSize() const;
+    void addHandleListener(const boost::shared_ptr<HandleListener>& listener);
+    void removeHandleListener(const HandleListener* listener);
+    
+    int read(char* buffer, int size);
+    std::size_t read(const std::vector<boost::asio::mutable_buffer>& buffers);
+    std::string read_until(std::string delim, std::size_t size);
+    std::string read_until_any(const std::string& delims, std::size_t size);
+    
+    void setBufferPool(boost::shared_ptr<BufferPool> pool);
+    boost::shared_ptr<BufferPool> getBufferPool() const;
+    std::size_t read_until(PooledBuffer& buffer, const std::string& delim, std::size_t size);
+    bool read_frame(PooledBuffer& frame);
+    
+    void setFramer(boost::shared_ptr<Framer> framer);
+    boost::shared_ptr<Framer> getFramer() const;
+    void setChecksum(boost::shared_ptr<Checksum> checksum);
+    boost::shared_ptr<Checksum> getChecksum() const;
+    bool read_frame(const char*& frame, std::size_t& size);
+    std::size_t write_frame(const char* data, std::size_t length);
+    
+    void async_read(char* buffer, std::size_t size, ReadHandler handler);
+    void async_read_until(const std::string& delim, ReadUntilHandler handler, std::size_t size);
+    void async_write(const char* data, std::size_t length, WriteHandler handler);
+    void cancel();
+    boost::asio::io_service& getIoService();
+    
+    int write(const char* data, int length);
+    std::size_t write(const std::vector<boost::asio::const_buffer>& buffers);
+    void setWriteQueue(std::size_t flush_threshold, long max_latency);
+    std::size_t flush();
+    
+    void write_frames(const std::vector<std::string>& requests, std::size_t begin, std::size_t end);
+    
+    SerialStats getStats() const;
+    void resetStats();
+    void setTraceCallback(TraceCallback callback);
+    void setCapture(boost::shared_ptr<CaptureLog> capture);
+    boost::shared_ptr<CaptureLog> getCapture() const;
+    LatencyHistogram getLatencyHistogram(latency_t operation) const;
+    void resetLatencyHistograms();
+    
+    void setRTS(bool level);
+    void setDTR(bool level);
+    bool getCTS() const;
+    bool getDSR() const;
+    bool getRI() const;
+    bool getCD() const;
+    unsigned int getModemLines() const;
+    bool waitForChange(unsigned int lines);
+    void startModemMonitor(ModemLinesCallback callback, unsigned int lines);
+    void stopModemMonitor();
+    
+    void setPort(std::string port);
+    std::string getPort() const;
+    void setSettings(const PortSettings& settings);
+    PortSettings getSettings() const;
+    void setTimeoutMilliseconds(long timeout);
+    long getTimeoutMilliseconds() const;
+    void setBaudrate(int baudrate);
+    int getBaudrate() const;
+    void setBytesize(bytesize_t bytesize);
+    bytesize_t getBytesize() const;
+    void setParity(parity_t parity);
+    parity_t getParity() const;
+    void setStopbits(stopbits_t stopbits);
+    stopbits_t getStopbits() const;
+    void setFlowcontrol(flowcontrol_t flowcontrol);
+    flowcontrol_t getFlowcontrol() const;
+    bool setLowLatency(bool enable);
+    bool getLowLatency() const;
+    bool setAutoReconnect(bool enable);
+    bool getAutoReconnect() const;
+    void setBusyPoll(long microseconds);
+    long getBusyPoll() const;
 private:
-    bool m_enable;
+    void init();
+    void apply_baudrate();
+    void apply_settings(const PortSettings& settings);
+    bool reconnect(unsigned long generation, long timeout);
+    void notify_handle_closing();
+    long reconnect_timeout(const boost::posix_time::ptime& deadline, bool nonblocking) const;
+    template <typename ConstBufferSequence>
+    std::size_t write_to_port(const ConstBufferSequence& buffers);
+    async_stream_type& async_stream();
+    void read_complete(const boost::system::error_code& error, std::size_t bytes_transferred);
+    void timeout_callback(const boost::system::error_code& error);
+    std::size_t flush_write_queue();
+    void flush_timeout(const boost::system::error_code& error);
+    std::size_t port_available();
+    bool wait_port(bool write, long timeout);
+    int read_from_port(char* buffer, int size, int minimum,
+                       const boost::posix_time::time_duration& timeout, bool nonblocking);
+    std::size_t fill(char* buffer, std::size_t size, const boost::posix_time::time_duration& timeout,
+                     bool nonblocking);
+    void async_read_complete(const char* data, std::size_t buffered, ReadHandler handler,
+                             const boost::system::error_code& error, std::size_t bytes_transferred);
+    void async_read_until_complete(const std::string& delim, std::size_t size, std::size_t scanned,
+                                   ReadUntilHandler handler, const boost::system::error_code& error,
+                                   std::size_t bytes_transferred);
+    std::size_t pop_read_ring(char* buffer, std::size_t size);
+    std::size_t read_from_ring(char* buffer, std::size_t size, std::size_t minimum,
+                               const boost::posix_time::time_duration& timeout, bool nonblocking);
+    void reader_thread_main();
+    void start_reader_read();
+    void reader_read_complete(const boost::system::error_code& error, std::size_t bytes_transferred);
+    void modem_monitor_main(ModemLinesCallback callback, unsigned int lines);
+    uint64_t trace_begin(tracepoint_t point);
+    void trace_end(tracepoint_t point, latency_t operation, uint64_t begin, std::size_t bytes);
+    void trace_event(tracepoint_t point, std::size_t bytes);
+    void capture_data(capture_direction_t direction, const char* data, std::size_t size);
+    
+    // Only set if the io_service is not shared with other ports, created when first needed
+    boost::scoped_ptr<boost::asio::io_service> owned_io_service;
+    
+    boost::scoped_ptr<boost::asio::io_service::work> work;
+    
+    boost::asio::io_service* io_service;
+    boost::mutex io_service_mutex;
+    
+    boost::scoped_ptr<serial_port_type> serial_port;
+    
+    // Incremented by each successful open() and reconnect
+    boost::atomic<unsigned long> open_count;
+    
+    // Told before the native handle is closed or replaced, see notify_handle_closing()
+    std::vector<boost::weak_ptr<HandleListener> > handle_listeners;
+    boost::mutex handle_listeners_mutex;
+    
+    // What open() or setSettings() last applied to the driver, valid until the port changes
+    SavedSettings saved_settings;
+    
+    // Whether reads and writes reopen the port when its device goes away, one at a time.
+    // close() sets closing and holds reconnect_mutex while it takes the port away, and the
+    // device_watcher wait of a reconnect is canceled by close() and cancel().
+    bool auto_reconnect;
+    boost::mutex reconnect_mutex;
+    boost::atomic<bool> closing;
+#if defined(SERIAL_NATIVE_BACKEND) && !defined(_WIN32)
+    DeviceWatcher device_watcher;
+#endif
+    
+    // Applied to the driver on each open() while low_latency is set
+    bool low_latency;
+    LowLatencyProfile low_latency_profile;
+    long busy_poll;
+    
+    // Created when first needed, most ports never use either of them
+    boost::scoped_ptr<boost::asio::deadline_timer> timeout_timer;
+    
+    boost::scoped_ptr<boost::asio::deadline_timer> flush_timer;
+    
+    std::string port;
+    boost::asio::serial_port_base::baud_rate baudrate;
+    boost::posix_time::time_duration timeout;
+    boost::asio::serial_port_base::character_size bytesize;
+    boost::asio::serial_port_base::parity parity;
+    boost::asio::serial_port_base::stop_bits stopbits;
+    boost::asio::serial_port_base::flow_control flowcontrol;
+    
+    // Bytes received from the port but not yet returned by a read, the Framer and Checksum of
+    // read_frame and the BufferPool of the PooledBuffer reads. The Framer and Checksum also
+    // encode the frames of write_frame.
+    ReadBuffer read_buffer;
+    
+    // Background reader thread and the ring buffer it fills
+    boost::scoped_ptr<boost::thread> reader_thread;
+    boost::scoped_ptr<boost::lockfree::spsc_queue<char> > read_ring;
+    std::vector<char> reader_chunk;
+    boost::atomic<bool> reader_active;
+    bool reader_read_pending;
+    boost::atomic<bool> reader_stalled;
+    boost::mutex read_ring_mutex;
+    boost::condition_variable read_ring_condition;
+    
+    // Waits for modem line changes, for waitForChange and the modem monitor thread
+    ModemLines modem_lines;
+    boost::scoped_ptr<boost::thread> modem_monitor;
+    boost::atomic<bool> modem_monitor_active;
+    
+    int bytes_read;
+    int bytes_to_read;
+    bool reading;
+    bool timer_pending;
+    bool nonblocking;
+    
+    // Counters behind getStats(). Those updated by writes are on a cache line of their own,
+    // so a thread writing does not slow down the one reading and the other way around.
+    struct StatsCounters {
+        boost::atomic<uint64_t> bytes_read;
+        boost::atomic<uint64_t> read_calls;
+        boost::atomic<uint64_t> timeouts;
+        boost::atomic<uint64_t> partial_reads;
+        boost::atomic<uint64_t> read_syscalls;
+        boost::atomic<uint64_t> ring_high_water;
+        boost::atomic<uint64_t> ring_overruns;
+        boost::atomic<uint64_t> framing_errors;
+        boost::atomic<uint64_t> checksum_errors;
+        boost::atomic<uint64_t> reconnects;
+        boost::atomic<uint64_t> capture_errors;
+        char padding[SERIAL_CACHE_LINE_SIZE];
+        boost::atomic<uint64_t> bytes_written;
+        boost::atomic<uint64_t> write_calls;
+        boost::atomic<uint64_t> write_syscalls;
+    } stats;
+    
+    // Everything below is only used by writes, the state above by reads
+    
+    // Queued writes, protected by write_mutex. write_queue_pending tells reads whether
+    // there is anything to flush without taking the mutex.
+    std::vector<char> write_queue;
+    std::size_t write_queue_threshold;
+    boost::posix_time::time_duration write_queue_latency;
+    boost::posix_time::ptime write_queue_oldest;
+    boost::atomic<bool> write_queue_pending;
+    boost::mutex write_mutex;
+    
+    std::vector<char> write_frame_buffer;
+    std::vector<char> write_checksum_buffer;
+    
+    // Latency histograms and the trace callback, only allocated with SERIAL_ENABLE_TRACING
+    struct TraceState;
+    boost::scoped_ptr<TraceState> trace;
+    
+    // Receives a copy of all data read and written while set
+    boost::shared_ptr<CaptureLog> capture;
+    
+    // Outstanding handlers on the io_service, protected by handler_mutex
+    int flush_timers_pending;
+    boost::mutex handler_mutex;
+    boost::condition_variable handler_condition;
 };
 
-class RTSControl {
-public:
-    explicit RTSControl(bool enable = false) : m_enable(enable) {};
-    boost::system::error_code store(BOOST_ASIO_OPTION_STORAGE& storage,
-                                    boost::system::error_code& ec) const
-    {
-        #if defined(BOOST_WINDOWS) || defined(__CYGWIN__)
-            if(m_enable)
-                storage.fRtsControl = RTS_CONTROL_ENABLE;
-            else
-                storage.fRtsControl = RTS_CONTROL_DISABLE;
-        #else
-            ec = boost::asio::error::operation_not_supported;
-            ec = boost::system::error_code();
-        #endif
-        return ec;
-    };
-    
-    boost::system::error_code load(const BOOST_ASIO_OPTION_STORAGE& storage,
-                                   boost::system::error_code& ec)
-    {
-        #if defined(BOOST_WINDOWS) || defined(__CYGWIN__)
-            if(storage.fRtsControl == RTS_CONTROL_ENABLE)
-                m_enable = true;
-            else
-                m_enable = true;
-        #else
-        #endif
-        return ec;
-    };
-private:
-    bool m_enable;
+/** Statistics **/
+
+static inline void count(boost::atomic<uint64_t>& counter, uint64_t n = 1) {
+    counter.fetch_add(n, boost::memory_order_relaxed);
+}
+
+/** Tracing **/
+
+// The hooks expand to nothing unless the library is built with SERIAL_ENABLE_TRACING
+#ifdef SERIAL_ENABLE_TRACING
+# define SERIAL_TRACE_BEGIN(point) uint64_t trace_begin_ = this->trace_begin(point)
+# define SERIAL_TRACE_END(point, operation, bytes) this->trace_end(point, operation, trace_begin_, bytes)
+# define SERIAL_TRACE(point, bytes) this->trace_event(point, bytes)
+#else
+# define SERIAL_TRACE_BEGIN(point)
+# define SERIAL_TRACE_END(point, operation, bytes) ((void)0)
+# define SERIAL_TRACE(point, bytes) ((void)0)
+#endif
+
+// The buckets of a LatencyHistogram as relaxed atomics, so the reading and the writing
+// thread record without a lock. Each is padded to keep them off each other's cache lines.
+struct AtomicLatencyHistogram {
+    AtomicLatencyHistogram() {
+        this->reset();
+    }
+    
+    void record(uint64_t nanoseconds) {
+        this->buckets[LatencyHistogram::bucketIndex(nanoseconds)].fetch_add(1, boost::memory_order_relaxed);
+        uint64_t max = this->max.load(boost::memory_order_relaxed);
+        while(nanoseconds > max && !this->max.compare_exchange_weak(max, nanoseconds, boost::memory_order_relaxed))
+            ;
+    }
+    
+    // Recording may go on meanwhile, so each bucket is as of some moment during the copy
+    LatencyHistogram snapshot() const {
+        uint64_t counts[LatencyHistogram::BUCKETS];
+        for(std::size_t i = 0; i < LatencyHistogram::BUCKETS; ++i)
+            counts[i] = this->buckets[i].load(boost::memory_order_relaxed);
+        LatencyHistogram histogram;
+        histogram.add(counts, this->max.load(boost::memory_order_relaxed));
+        return histogram;
+    }
+    
+    void reset() {
+        for(std::size_t i = 0; i < LatencyHistogram::BUCKETS; ++i)
+            this->buckets[i].store(0, boost::memory_order_relaxed);
+        this->max.store(0, boost::memory_order_relaxed);
+    }
+    
+    char padding[SERIAL_CACHE_LINE_SIZE];
+    boost::atomic<uint64_t> buckets[LatencyHistogram::BUCKETS];
+    boost::atomic<uint64_t> max;
 };
 
-/** Serial Class Implementation **/
+struct Serial::SerialImpl::TraceState {
+    TraceCallback callback;
+    AtomicLatencyHistogram histograms[LATENCY_READ_UNTIL + 1];
+    char padding[SERIAL_CACHE_LINE_SIZE];
+};
 
-Serial::Serial() : io_service(), work(io_service), timeout_timer(io_service) {
-    this->init();
+#ifdef SERIAL_ENABLE_TRACING
+
+#if defined(BOOST_WINDOWS) || defined(__CYGWIN__)
+static uint64_t query_performance_frequency() {
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    return uint64_t(frequency.QuadPart);
 }
 
-Serial::Serial(std::string port,
-               int baudrate,
-               long timeout,
-               bytesize_t bytesize,
-               parity_t parity,
-               stopbits_t stopbits,
-               flowcontrol_t flowcontrol)
-               : io_service(), work(io_service), timeout_timer(io_service)
-{
-    // Call default constructor to initialize variables
+// The frequency is fixed at boot, so it is only queried once
+static const uint64_t performance_frequency = query_performance_frequency();
+#endif
+
+static uint64_t trace_clock() {
+#if defined(BOOST_WINDOWS) || defined(__CYGWIN__)
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    uint64_t ticks = uint64_t(counter.QuadPart);
+    return ticks / performance_frequency * 1000000000ULL +
+           ticks % performance_frequency * 1000000000ULL / performance_frequency;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return uint64_t(now.tv_sec) * 1000000000ULL + uint64_t(now.tv_nsec);
+#endif
+}
+
+uint64_t Serial::SerialImpl::trace_begin(tracepoint_t point) {
+    uint64_t now = trace_clock();
+    if(this->trace->callback)
+        this->trace->callback(point, now, 0);
+    return now;
+}
+
+void Serial::SerialImpl::trace_end(tracepoint_t point, latency_t operation, uint64_t begin, std::size_t bytes) {
+    uint64_t now = trace_clock();
+    this->trace->histograms[operation].record(now - begin);
+    if(this->trace->callback)
+        this->trace->callback(point, now, bytes);
+}
+
+void Serial::SerialImpl::trace_event(tracepoint_t point, std::size_t bytes) {
+    if(this->trace->callback)
+        this->trace->callback(point, trace_clock(), bytes);
+}
+#endif
+
+/** Serial Implementation Class **/
+
+Serial::SerialImpl::SerialImpl(boost::asio::io_service* io_service)
+    : io_service(io_service),
+      read_buffer(*this, &this->stats.timeouts, &this->stats.framing_errors, &this->stats.checksum_errors) {
     this->init();
-    
+}
+
+Serial::SerialImpl::~SerialImpl() {
+    this->close();
+}
+
+void Serial::SerialImpl::setup(std::string port,
+                   int baudrate,
+                   long timeout,
+                   bytesize_t bytesize,
+                   parity_t parity,
+                   stopbits_t stopbits,
+                   flowcontrol_t flowcontrol) {
     // Write provided settings
     this->port = port;
     this->setBaudrate(baudrate);
@@ -142,7 +483,7 @@ Serial::Serial(std::string port,
     this->open();
 }
 
-void Serial::init() {
+void Serial::SerialImpl::init() {
     // Boost asio variables
     this->serial_port.reset();
     
@@ -152,17 +493,31 @@ void Serial::init() {
     this->setTimeoutMilliseconds(DEFAULT_TIMEOUT);
     
     // Private variables
+    this->open_count = 0;
+    this->auto_reconnect = false;
+    this->closing = false;
+    this->low_latency = false;
+    this->busy_poll = 0;
+    this->reader_active = false;
+    this->reader_read_pending = false;
+    this->reader_stalled = false;
+    this->modem_monitor_active = false;
     this->bytes_read = 0;
     this->bytes_to_read = 0;
     this->reading = false;
+    this->timer_pending = false;
     this->nonblocking = false;
+    this->write_queue_threshold = 0;
+    this->write_queue_pending = false;
+    this->write_queue_latency = boost::posix_time::milliseconds(0);
+    this->flush_timers_pending = 0;
+    this->resetStats();
+#ifdef SERIAL_ENABLE_TRACING
+    this->trace.reset(new TraceState());
+#endif
 }
 
-Serial::~Serial() {
-    this->close();
-}
-
-void Serial::open() {
+void Serial::SerialImpl::open() {
     // Make sure the Serial port is not already open.
     if(this->serial_port != NULL && this->serial_port->is_open()) {
         throw(SerialPortAlreadyOpenException(this->port.c_str()));
@@ -170,289 +525,1425 @@ void Serial::open() {
     
     // Try to open the serial port
     try {
-        this->serial_port.reset(new boost::asio::serial_port(this->io_service, this->port));
+#ifdef SERIAL_NATIVE_BACKEND
+        this->serial_port.reset(new serial_port_type(this->port));
+#else
+        this->serial_port.reset(new boost::asio::serial_port(this->getIoService(), this->port));
+#endif
         
-        this->serial_port->set_option(this->baudrate);
-        this->serial_port->set_option(this->flowcontrol);
-        this->serial_port->set_option(this->parity);
-        this->serial_port->set_option(this->stopbits);
-        this->serial_port->set_option(this->bytesize);
+        if(this->saved_settings.isValid()) {
+            // Nothing changed since the port was last configured, so put all of it back at once
+            boost::system::error_code ec;
+            this->saved_settings.restore(this->serial_port->native_handle(), ec);
+            boost::asio::detail::throw_error(ec, "set_option");
+        } else {
+            this->serial_port->set_option(this->flowcontrol);
+            this->serial_port->set_option(this->parity);
+            this->serial_port->set_option(this->stopbits);
+            this->serial_port->set_option(this->bytesize);
+            this->apply_baudrate();
+            this->saved_settings.save(this->serial_port->native_handle(), this->baudrate.value());
+        }
     } catch(std::exception &e) {
         this->serial_port.reset();
         throw(SerialPortFailedToOpenException(e.what()));
     }
+    ++this->open_count;
+    this->closing = false;
+    if(this->low_latency)
+        this->low_latency_profile.apply(this->serial_port->native_handle(), this->port);
 }
 
-bool Serial::isOpen() {
+void Serial::SerialImpl::apply_baudrate() {
+    boost::system::error_code ec;
+#if defined(__linux__)
+    // termios2 takes any rate, and unlike cfsetspeed() it also replaces a custom input speed
+    // which an earlier open left in the driver
+    CustomBaudrate::set(this->serial_port->native_handle(), this->baudrate.value(), ec);
+    if(ec == boost::asio::error::operation_not_supported)
+        this->serial_port->set_option(this->baudrate, ec);
+#elif !(defined(BOOST_WINDOWS) || defined(__CYGWIN__))
+    // termios only has constants for the standard rates, the driver is asked for any other
+    this->serial_port->set_option(this->baudrate, ec);
+    if(ec == boost::asio::error::invalid_argument)
+        CustomBaudrate::set(this->serial_port->native_handle(), this->baudrate.value(), ec);
+#else
+    this->serial_port->set_option(this->baudrate, ec);
+#endif
+    boost::asio::detail::throw_error(ec, "set_option");
+}
+
+bool Serial::SerialImpl::reconnect(unsigned long generation, long timeout) {
+#if defined(SERIAL_NATIVE_BACKEND) && !defined(_WIN32)
+    using namespace boost::posix_time;
+    
+    if(!this->auto_reconnect || this->read_ring || !this->saved_settings.isValid())
+        return false;
+    boost::mutex::scoped_lock lock(this->reconnect_mutex);
+    // A cancel() from before this reconnect started is not for it, close() sets closing first
+    this->device_watcher.reset();
+    if(this->closing || !this->isOpen())
+        return false;
+    // The other of a reading and a writing thread found the device gone too, and was first
+    if(this->open_count != generation)
+        return true;
+    
+    ptime deadline = microsec_clock::universal_time() + milliseconds(std::max(timeout, 0L));
+    int fd = -1;
+    while(true) {
+        long remaining = -1;
+        if(timeout >= 0)
+            remaining = std::max(0L, long((deadline - microsec_clock::universal_time()).total_milliseconds()));
+        if(this->closing || !this->device_watcher.wait(this->port, remaining))
+            return false;
+        
+        // The new descriptor is configured before it replaces the old one, so a thread
+        // using the port never sees the device with the driver's defaults
+        fd = ::open(this->port.c_str(), O_RDWR | O_NONBLOCK | O_NOCTTY);
+        if(fd >= 0) {
+            boost::system::error_code ec;
+            this->saved_settings.restore(fd, ec);
+            if(!ec)
+                break;
+            ::close(fd);
+        }
+        if(remaining == 0)
+            return false;
+        boost::this_thread::sleep(milliseconds(SERIAL_RECONNECT_RETRY_INTERVAL));
+    }
+    // The port was closed while the device was away
+    if(this->closing || !this->isOpen()) {
+        ::close(fd);
+        return false;
+    }
+    this->notify_handle_closing();
+    this->serial_port->replace(fd);
+    if(this->low_latency)
+        this->low_latency_profile.apply(this->serial_port->native_handle(), this->port);
+    ++this->open_count;
+    count(this->stats.reconnects);
+    return true;
+#else
+    // boost::asio::serial_port can only be given a new descriptor by closing its own, which
+    // a thread using the port at the same time may still be reading or writing
+    (void)generation;
+    (void)timeout;
+    return false;
+#endif
+}
+
+long Serial::SerialImpl::reconnect_timeout(const boost::posix_time::ptime& deadline, bool nonblocking) const {
+    if(nonblocking)
+        return 0;
+    if(deadline.is_not_a_date_time())
+        return -1;
+    boost::posix_time::time_duration remaining = deadline - boost::posix_time::microsec_clock::universal_time();
+    return std::max(0L, long(remaining.total_milliseconds()));
+}
+
+bool Serial::SerialImpl::isOpen() {
     if(this->serial_port != NULL)
         return this->serial_port->is_open();
     return false;
 }
 
-void Serial::close() {
-    // Cancel the current timeout timer and async reads
-    this->timeout_timer.cancel();
+void Serial::SerialImpl::close() {
+    // A read or write waiting for the device to come back gives up, and none starts waiting
+    this->closing = true;
+#if defined(SERIAL_NATIVE_BACKEND) && !defined(_WIN32)
+    this->device_watcher.cancel();
+#endif
+    this->stopReaderThread();
+    this->stopModemMonitor();
+    this->modem_lines.cancel();
+    
+    // Send whatever is still queued and wait for the flush timer's handler to finish
+    if(this->isOpen())
+        this->flush();
+    {
+        boost::mutex::scoped_lock lock(this->write_mutex);
+        this->write_queue.clear();
+        if(this->flush_timer)
+            this->flush_timer->cancel();
+    }
+    if(this->owned_io_service) {
+        while(this->flush_timers_pending > 0)
+            this->io_service->run_one();
+    } else {
+        boost::mutex::scoped_lock lock(this->handler_mutex);
+        while(this->flush_timers_pending > 0)
+            this->handler_condition.wait(lock);
+    }
+    
+    // Cancel the current timeout timer and async reads, once a reconnect has let go of the port
+    boost::mutex::scoped_lock reconnect_lock(this->reconnect_mutex);
+    if(this->timeout_timer)
+        this->timeout_timer->cancel();
     if(this->serial_port != NULL) {
+        if(this->low_latency && this->serial_port->is_open())
+            this->low_latency_profile.restore(this->serial_port->native_handle(), this->port);
         this->serial_port->cancel();
+        if(this->serial_port->is_open())
+            this->notify_handle_closing();
         this->serial_port->close();
         this->serial_port.reset();
     }
-}
-
-static const boost::posix_time::time_duration timeout_zero_comparison(boost::posix_time::milliseconds(0));
-
-int Serial::read(char* buffer, int size) {
-    this->reading = true;
-    if(this->nonblocking) {// Do not wait for data
-        this->serial_port->async_read_some(boost::asio::buffer(buffer, size),
-                                boost::bind(&Serial::read_complete, this,
-                                boost::asio::placeholders::error,
-                                boost::asio::placeholders::bytes_transferred));
-    } else {               // Wait for data until size is read or timeout occurs
-        boost::asio::async_read(*this->serial_port, boost::asio::buffer(buffer, size), transfer_at_least_ignore_invalid_argument(size),
-                                boost::bind(&Serial::read_complete, this,
-                                boost::asio::placeholders::error,
-                                boost::asio::placeholders::bytes_transferred));
-    }
-    if(this->timeout > timeout_zero_comparison) { // Only set a timeout_timer if there is a valid timeout
-        this->timeout_timer.expires_from_now(this->timeout);
-        this->timeout_timer.async_wait(boost::bind(&Serial::timeout_callback, this,
-                                 boost::asio::placeholders::error));
-    } else if(this->nonblocking) {
-        this->timeout_timer.expires_from_now(boost::posix_time::milliseconds(1));
-        this->timeout_timer.async_wait(boost::bind(&Serial::timeout_callback, this,
-                                 boost::asio::placeholders::error));
-    }
     
-    while(this->reading)
-        this->io_service.run_one();
-    
-    this->bytes_to_read = size;
+    this->closing = false;
+    reconnect_lock.unlock();
     
-    return this->bytes_read;
-}
-
-std::string Serial::read(int size) {
-    char *serial_buffer = new char[size];
-    int bytes_read_ = this->read(serial_buffer, size);
-    std::string return_str(serial_buffer, (std::size_t)bytes_read_);
-    delete[] serial_buffer;
-    return return_str;
+    // Anything left in the read buffer belongs to the old connection
+    this->read_buffer.clear();
 }
 
-std::string 
-Serial::read_until(char delim, size_t size) {
-    using namespace std;
-    string r = "";
+void Serial::SerialImpl::startReaderThread(size_t buffer_size) {
+    if(!this->isOpen())
+        throw(SerialPortNotOpenException(this->port.c_str()));
+    if(this->read_ring)
+        return;
     
-    while (r.find(delim) == string::npos) {
-        string s = read(1);
-        if (s.length() > 0) 
-            r += s;
+    this->read_ring.reset(new boost::lockfree::spsc_queue<char>(buffer_size));
+    this->reader_chunk.resize(DEFAULT_READ_BUFFER_SIZE);
+    {
+        boost::mutex::scoped_lock lock(this->read_ring_mutex);
+        this->reader_active = true;
+        this->reader_stalled = false;
+        this->reader_read_pending = true;
+        this->start_reader_read();
     }
     
-    return r;
+    // A shared io_service is already being run by its owner, so no thread is needed
+    if(this->owned_io_service)
+        this->reader_thread.reset(new boost::thread(boost::bind(&SerialImpl::reader_thread_main, this)));
 }
 
-std::string 
-Serial::read_until(std::string delim, size_t size) {
-    using namespace std;
-    string r = "";
+void Serial::SerialImpl::stopReaderThread() {
+    if(!this->read_ring)
+        return;
     
-    while (r.find(delim) == string::npos) {
-        string s = read(1);
-        if (s.length() > 0) 
-            r += s;
+    // Abort the outstanding read and wait for its handler, it will not start another
+    {
+        boost::mutex::scoped_lock lock(this->read_ring_mutex);
+        this->reader_active = false;
+        this->serial_port->cancel();
+        while(this->reader_read_pending)
+            this->read_ring_condition.wait(lock);
     }
     
-    return r;
-}
-
-void Serial::read_complete(const boost::system::error_code& error, std::size_t bytes_transferred) {
-    if(!error || error != boost::asio::error::operation_aborted) { // If there was no error OR the error wasn't operation aborted (canceled), Cancel the timer
-        this->timeout_timer.cancel();  // will cause timeout_callback to fire with an error
+    if(this->reader_thread) {
+        this->io_service->stop();
+        this->reader_thread->join();
+        this->reader_thread.reset();
+        this->io_service->reset();
     }
     
-    this->bytes_read = bytes_transferred;
-    
-    this->reading = false;
+    // Move whatever was not read yet into the read buffer so it is not lost
+    std::size_t pending = this->read_ring->read_available();
+    if(pending > 0)
+        this->read_buffer.commit(this->read_ring->pop(this->read_buffer.prepare(pending), pending));
+    this->read_ring.reset();
 }
 
-void Serial::timeout_callback(const boost::system::error_code& error) {
-    if (!error) {
-        // The timeout wasn't canceled, so cancel the async read
-        this->serial_port->cancel();
+bool Serial::SerialImpl::isReaderThreadRunning() const {
+    return this->read_ring != NULL;
+}
+
+size_t Serial::SerialImpl::available() {
+    std::size_t buffered = this->getBufferedSize();
+    if(this->isOpen())
+        buffered += this->port_available();
+    return buffered;
+}
+
+bool Serial::SerialImpl::waitReadable(long timeout) {
+    if(!this->isOpen())
+        throw(SerialPortNotOpenException(this->port.c_str()));
+    if(this->read_buffer.size() > 0)
+        return true;
+    if(!this->read_ring)
+        return this->wait_port(false, timeout);
+    
+    // The reader thread takes the data from the port, so wait for it to push some
+    boost::posix_time::ptime deadline = boost::posix_time::microsec_clock::universal_time() +
+                                        boost::posix_time::milliseconds(std::max(timeout, 0L));
+    boost::mutex::scoped_lock lock(this->read_ring_mutex);
+    while(this->read_ring->read_available() == 0 && this->reader_active && timeout != 0) {
+        if(timeout < 0)
+            this->read_ring_condition.wait(lock);
+        else if(!this->read_ring_condition.timed_wait(lock, deadline))
+            break;
     }
+    return this->read_ring->read_available() > 0;
 }
 
-int Serial::write(char data[], int length) {
-    return boost::asio::write(*this->serial_port, boost::asio::buffer(data, length), boost::asio::transfer_all());
+bool Serial::SerialImpl::waitWritable(long timeout) {
+    if(!this->isOpen())
+        throw(SerialPortNotOpenException(this->port.c_str()));
+    return this->wait_port(true, timeout);
 }
 
-int Serial::write(std::string data) {
-    char *cstr = new char[data.size()+1];
-    std::strcpy(cstr, data.c_str());
-    int bytes_wrote = this->write(cstr, data.length());
-    delete[] cstr;
-    return bytes_wrote;
+bool Serial::SerialImpl::getSelectHandle(intptr_t& handle, unsigned long& generation) const {
+    if(this->serial_port == NULL || !this->serial_port->is_open())
+        return false;
+    handle = (intptr_t)this->serial_port->native_handle();
+    generation = this->open_count;
+    return true;
 }
 
-void Serial::setRTS(bool level) {
-    this->serial_port->set_option(RTSControl(level));
+void Serial::SerialImpl::addHandleListener(const boost::shared_ptr<HandleListener>& listener) {
+    this->removeHandleListener(NULL); // Drop the listeners which have gone away
+    boost::mutex::scoped_lock lock(this->handle_listeners_mutex);
+    this->handle_listeners.push_back(listener);
 }
 
-void Serial::setDTR(bool level) {
-    this->serial_port->set_option(DTRControl(level));
+void Serial::SerialImpl::removeHandleListener(const HandleListener* listener) {
+    boost::mutex::scoped_lock lock(this->handle_listeners_mutex);
+    for(std::size_t i = 0; i < this->handle_listeners.size(); ) {
+        boost::shared_ptr<HandleListener> listener_ = this->handle_listeners[i].lock();
+        if(!listener_ || listener_.get() == listener)
+            this->handle_listeners.erase(this->handle_listeners.begin() + i);
+        else
+            ++i;
+    }
 }
 
-bool Serial::getCTS() const {
-    throw(boost::asio::error::operation_not_supported);
-    return false;
+void Serial::SerialImpl::notify_handle_closing() {
+    intptr_t handle = (intptr_t)this->serial_port->native_handle();
+    boost::mutex::scoped_lock lock(this->handle_listeners_mutex);
+    for(std::size_t i = 0; i < this->handle_listeners.size(); ) {
+        boost::shared_ptr<HandleListener> listener = this->handle_listeners[i].lock();
+        if(!listener) {
+            this->handle_listeners.erase(this->handle_listeners.begin() + i);
+            continue;
+        }
+        listener->closing(handle);
+        ++i;
+    }
 }
 
-bool Serial::getDSR() const {
-    throw(boost::asio::error::operation_not_supported);
-    return false;
+size_t Serial::SerialImpl::getBufferedSize() const {
+    std::size_t buffered = this->read_buffer.size();
+    if(this->read_ring)
+        buffered += this->read_ring->read_available();
+    return buffered;
 }
 
-void Serial::setPort(std::string port) {
-    this->port = port;
+void Serial::SerialImpl::reader_thread_main() {
+    this->io_service->run();
 }
 
-std::string Serial::getPort() const {
-    return this->port;
+void Serial::SerialImpl::start_reader_read() {
+    // Never read more than fits in the ring, so a slow consumer leaves data in the OS buffer
+    std::size_t space = std::min(this->reader_chunk.size(), this->read_ring->write_available());
+    this->async_stream().async_read_some(boost::asio::buffer(&this->reader_chunk[0], space),
+                            boost::bind(&SerialImpl::reader_read_complete, this,
+                            boost::asio::placeholders::error,
+                            boost::asio::placeholders::bytes_transferred));
 }
 
-void Serial::setTimeoutMilliseconds(long timeout) {
-    // If timeout > 0 then read until size or timeout occurs
-    // If timeout == 0 then read nonblocking, return data available immediately up to size
-    // If timeout < 0 then read blocking, until size is read, period.
-    if(timeout > 0) {
-        this->timeout = boost::posix_time::time_duration(boost::posix_time::milliseconds(timeout));
+void Serial::SerialImpl::reader_read_complete(const boost::system::error_code& error, std::size_t bytes_transferred) {
+    count(this->stats.read_syscalls);
+    if(bytes_transferred > 0) {
+        this->read_ring->push(&this->reader_chunk[0], bytes_transferred);
+        count(this->stats.bytes_read, bytes_transferred);
+        SERIAL_TRACE(TRACE_READ_DATA, bytes_transferred);
+        this->capture_data(CAPTURE_RX, &this->reader_chunk[0], bytes_transferred);
+        
+        // Only this thread pushes, so there is no race between the load and the store
+        uint64_t used = this->read_ring->read_available();
+        if(used > this->stats.ring_high_water.load(boost::memory_order_relaxed))
+            this->stats.ring_high_water.store(used, boost::memory_order_relaxed);
+    }
+    
+    // Starting the next read under the lock keeps it from racing with stopReaderThread
+    boost::mutex::scoped_lock lock(this->read_ring_mutex);
+    if(error && error != boost::asio::error::invalid_argument)
+        this->reader_active = false;
+    if(this->reader_active && this->read_ring->write_available() > 0) {
+        this->start_reader_read();
     } else {
-        this->timeout = boost::posix_time::time_duration(boost::posix_time::milliseconds(0));
+        // When the ring is full the consumer restarts reading once it has made room
+        this->reader_stalled = this->reader_active.load();
+        this->reader_read_pending = false;
+        if(this->reader_stalled)
+            count(this->stats.ring_overruns);
     }
     
-    if(timeout == 0)
-        this->nonblocking = true;
-    else // Must be negative
-        this->nonblocking = false;
+    // Wake up a consumer waiting for data, or for the reader to stop
+    this->read_ring_condition.notify_all();
 }
 
-long Serial::getTimeoutMilliseconds() const {
-    return this->timeout.total_milliseconds();
+static const boost::posix_time::time_duration timeout_zero_comparison(boost::posix_time::milliseconds(0));
+
+#if !defined(BOOST_WINDOWS) && !defined(__CYGWIN__)
+std::size_t Serial::SerialImpl::port_available() {
+    int pending = 0;
+    count(this->stats.read_syscalls);
+    if(::ioctl(this->serial_port->native_handle(), FIONREAD, &pending) < 0)
+        return 0;
+    return std::size_t(pending);
 }
 
-void Serial::setBaudrate(int baudrate) {
-    this->baudrate = boost::asio::serial_port_base::baud_rate(baudrate);
+bool Serial::SerialImpl::wait_port(bool write, long timeout) {
+    using namespace boost::posix_time;
+    
+    ptime deadline = microsec_clock::universal_time() + milliseconds(std::max(timeout, 0L));
+    struct pollfd pfd;
+    pfd.fd = this->serial_port->native_handle();
+    pfd.events = write ? POLLOUT : POLLIN;
+    int poll_timeout = timeout < 0 ? -1 : int(timeout);
+    while(true) {
+        pfd.revents = 0;
+        int ready = ::poll(&pfd, 1, poll_timeout);
+        count(write ? this->stats.write_syscalls : this->stats.read_syscalls);
+        if(ready >= 0)
+            return ready > 0;
+        if(errno != EINTR)
+            return false;
+        if(timeout > 0) {
+            time_duration remaining = deadline - microsec_clock::universal_time();
+            poll_timeout = std::max(0, int((remaining.total_microseconds() + 999) / 1000));
+        }
+    }
+}
+#else
+std::size_t Serial::SerialImpl::port_available() {
+    COMSTAT status;
+    DWORD errors = 0;
+    count(this->stats.read_syscalls);
+    if(!::ClearCommError(this->serial_port->native_handle(), &errors, &status))
+        return 0;
+    return status.cbInQue;
 }
 
-int Serial::getBaudrate() const {
-    return this->baudrate.value();
+bool Serial::SerialImpl::wait_port(bool write, long timeout) {
+    // Writes are buffered by the driver
+    if(write)
+        return true;
+#ifdef SERIAL_NATIVE_BACKEND
+    if(timeout == 0)
+        return this->port_available() > 0;
+    boost::system::error_code ec;
+    count(this->stats.read_syscalls);
+    bool ready = this->serial_port->wait_readable(timeout < 0 ? INFINITE : DWORD(timeout), ec);
+    // Let the read report the error
+    return ready || ec.value() != 0;
+#else
+    // boost::asio::serial_port has no readiness notification for reads, so the input queue
+    // is polled
+    using namespace boost::posix_time;
+    ptime deadline = microsec_clock::universal_time() + milliseconds(std::max(timeout, 0L));
+    while(this->port_available() == 0) {
+        if(timeout >= 0 && microsec_clock::universal_time() >= deadline)
+            return false;
+        ::Sleep(1);
+    }
+    return true;
+#endif
 }
+#endif
 
-void Serial::setBytesize(bytesize_t bytesize) {
-    switch(bytesize) {
-        case FIVEBITS:
-            this->bytesize = boost::asio::serial_port_base::character_size(5);
+int Serial::SerialImpl::read_from_port(char* buffer, int size, int minimum,
+                           const boost::posix_time::time_duration& timeout, bool nonblocking) {
+    // A response can not arrive before the request has been sent
+    if(this->write_queue_pending.load(boost::memory_order_acquire))
+        this->flush();
+    
+#if !defined(BOOST_WINDOWS) && !defined(__CYGWIN__)
+    // The descriptor is non-blocking, so read what is there and only poll() when it runs
+    // dry, this avoids arming and canceling timers on the io_service for every read.
+    using namespace boost::posix_time;
+    
+    int fd = this->serial_port->native_handle();
+    unsigned long generation = this->open_count;
+    bool has_timeout = timeout > timeout_zero_comparison;
+    ptime deadline, spin_deadline;
+    if(has_timeout)
+        deadline = microsec_clock::universal_time() + timeout;
+    
+    int bytes_read_ = 0;
+    while(bytes_read_ < size) {
+        ssize_t result = ::read(fd, buffer + bytes_read_, size - bytes_read_);
+        count(this->stats.read_syscalls);
+        if(result > 0) {
+            bytes_read_ += int(result);
+            count(this->stats.bytes_read, result);
+            SERIAL_TRACE(TRACE_READ_DATA, std::size_t(result));
+            this->capture_data(CAPTURE_RX, buffer + bytes_read_ - result, std::size_t(result));
+            if(bytes_read_ >= minimum)
+                break;
+            continue;
+        }
+        if(result < 0 && errno == EINTR)
+            continue;
+        if(result == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+            // End of file or an error, e.g. the device was unplugged or the other end of a
+            // pty hung up. A reconnect keeps the descriptor, so the read carries on.
+            if(this->auto_reconnect && this->reconnect(generation, this->reconnect_timeout(deadline, nonblocking))) {
+                generation = this->open_count;
+                continue;
+            }
             break;
-        case SIXBITS:
-            this->bytesize = boost::asio::serial_port_base::character_size(6);
+        }
+        if(nonblocking)
             break;
-        case SEVENBITS:
-            this->bytesize = boost::asio::serial_port_base::character_size(7);
+        
+        // Keep reading instead of sleeping in poll() until the busy poll time is used up
+        if(this->busy_poll > 0) {
+            ptime now = microsec_clock::universal_time();
+            if(spin_deadline.is_not_a_date_time()) {
+                spin_deadline = now + microseconds(this->busy_poll);
+                if(has_timeout && spin_deadline > deadline)
+                    spin_deadline = deadline;
+            }
+            if(now < spin_deadline)
+                continue;
+        }
+        
+        int poll_timeout = -1;
+        if(has_timeout) {
+            time_duration remaining = deadline - microsec_clock::universal_time();
+            if(remaining <= timeout_zero_comparison) {
+                count(this->stats.timeouts);
+                break;
+            }
+            poll_timeout = int((remaining.total_microseconds() + 999) / 1000);
+        }
+        struct pollfd pfd;
+        pfd.fd = fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        int ready = ::poll(&pfd, 1, poll_timeout);
+        count(this->stats.read_syscalls);
+        if(ready == 0) { // Timed out
+            count(this->stats.timeouts);
             break;
-        case EIGHTBITS:
-            this->bytesize = boost::asio::serial_port_base::character_size(8);
+        }
+        if(ready < 0 && errno != EINTR)
             break;
-        default:
-            throw(InvalidBytesizeException(bytesize));
+    }
+    
+    this->bytes_read = bytes_read_;
+    this->bytes_to_read = size;
+    
+    return bytes_read_;
+#elif defined(SERIAL_NATIVE_BACKEND)
+    // An overlapped read waited on with the remaining timeout, COMMTIMEOUTS return it as soon
+    // as data arrives so the io_service and its timers are not involved.
+    using namespace boost::posix_time;
+    
+    bool has_timeout = timeout > timeout_zero_comparison;
+    ptime deadline, spin_deadline;
+    if(has_timeout)
+        deadline = microsec_clock::universal_time() + timeout;
+    
+    int bytes_read_ = 0;
+    while(bytes_read_ < size) {
+        // Only check the input queue instead of waiting until the busy poll time is used up
+        bool spinning = false;
+        if(this->busy_poll > 0 && !nonblocking) {
+            ptime now = microsec_clock::universal_time();
+            if(spin_deadline.is_not_a_date_time()) {
+                spin_deadline = now + microseconds(this->busy_poll);
+                if(has_timeout && spin_deadline > deadline)
+                    spin_deadline = deadline;
+            }
+            spinning = now < spin_deadline;
+        }
+        
+        DWORD wait = INFINITE;
+        if(nonblocking || spinning) {
+            wait = 0;
+        } else if(has_timeout) {
+            time_duration remaining = deadline - microsec_clock::universal_time();
+            if(remaining <= timeout_zero_comparison) {
+                count(this->stats.timeouts);
+                break;
+            }
+            wait = DWORD((remaining.total_microseconds() + 999) / 1000);
+        }
+        boost::system::error_code ec;
+        std::size_t result = this->serial_port->read(buffer + bytes_read_, size - bytes_read_, wait, ec);
+        count(this->stats.read_syscalls);
+        if(ec)
             break;
+        if(result > 0) {
+            bytes_read_ += int(result);
+            count(this->stats.bytes_read, result);
+            SERIAL_TRACE(TRACE_READ_DATA, result);
+            this->capture_data(CAPTURE_RX, buffer + bytes_read_ - result, result);
+            if(bytes_read_ >= minimum)
+                break;
+        } else if(nonblocking) {
+            break;
+        }
     }
+    
+    this->bytes_read = bytes_read_;
+    this->bytes_to_read = size;
+    
+    return bytes_read_;
+#else
+    // Nothing is waiting in the driver, so there is no need to start a read and a timer
+    if(nonblocking && this->port_available() == 0) {
+        this->bytes_read = 0;
+        this->bytes_to_read = size;
+        return 0;
+    }
+    
+    this->reading = true;
+    if(nonblocking) {// Do not wait for data
+        this->serial_port->async_read_some(boost::asio::buffer(buffer, size),
+                                boost::bind(&SerialImpl::read_complete, this,
+                                boost::asio::placeholders::error,
+                                boost::asio::placeholders::bytes_transferred));
+    } else {               // Wait for data until minimum is read or timeout occurs
+        boost::asio::async_read(*this->serial_port, boost::asio::buffer(buffer, size), transfer_at_least_ignore_invalid_argument(minimum),
+                                boost::bind(&SerialImpl::read_complete, this,
+                                boost::asio::placeholders::error,
+                                boost::asio::placeholders::bytes_transferred));
+    }
+    if(!this->timeout_timer)
+        this->timeout_timer.reset(new boost::asio::deadline_timer(this->getIoService()));
+    if(timeout > timeout_zero_comparison) { // Only set a timeout_timer if there is a valid timeout
+        this->timer_pending = true;
+        this->timeout_timer->expires_from_now(timeout);
+        this->timeout_timer->async_wait(boost::bind(&SerialImpl::timeout_callback, this,
+                                 boost::asio::placeholders::error));
+    } else if(nonblocking) {
+        this->timer_pending = true;
+        this->timeout_timer->expires_from_now(boost::posix_time::milliseconds(1));
+        this->timeout_timer->async_wait(boost::bind(&SerialImpl::timeout_callback, this,
+                                 boost::asio::placeholders::error));
+    }
+    
+    // Wait for the timer's handler too, so it cannot cancel a later read
+    if(this->owned_io_service) {
+        while(this->reading || this->timer_pending)
+            this->io_service->run_one();
+    } else {               // The owner of a shared io_service runs the handlers
+        boost::mutex::scoped_lock lock(this->handler_mutex);
+        while(this->reading || this->timer_pending)
+            this->handler_condition.wait(lock);
+    }
+    
+    this->bytes_to_read = size;
+    this->capture_data(CAPTURE_RX, buffer, std::size_t(this->bytes_read));
+    
+    return this->bytes_read;
+#endif
 }
 
-bytesize_t Serial::getBytesize() const {
-    return bytesize_t(this->bytesize.value());
+std::size_t Serial::SerialImpl::fill(char* buffer, std::size_t size, const boost::posix_time::time_duration& timeout,
+                                     bool nonblocking) {
+    if(this->read_ring)
+        return this->read_from_ring(buffer, size, 1, timeout, nonblocking);
+    return std::size_t(this->read_from_port(buffer, int(size), 1, timeout, nonblocking));
 }
 
-void Serial::setParity(parity_t parity) {
-    switch(parity) {
-        case PARITY_NONE:
-            this->parity = boost::asio::serial_port_base::parity(boost::asio::serial_port_base::parity::none);
-            break;
-        case PARITY_ODD:
-            this->parity = boost::asio::serial_port_base::parity(boost::asio::serial_port_base::parity::odd);
+std::size_t Serial::SerialImpl::pop_read_ring(char* buffer, std::size_t size) {
+    std::size_t popped = this->read_ring->pop(buffer, size);
+    if(popped > 0 && this->reader_stalled) {
+        boost::mutex::scoped_lock lock(this->read_ring_mutex);
+        if(this->reader_stalled && this->reader_active) {
+            this->reader_stalled = false;
+            this->reader_read_pending = true;
+            this->start_reader_read();
+        }
+    }
+    return popped;
+}
+
+std::size_t Serial::SerialImpl::read_from_ring(char* buffer, std::size_t size, std::size_t minimum,
+                                   const boost::posix_time::time_duration& timeout, bool nonblocking) {
+    using namespace boost::posix_time;
+    
+    bool has_timeout = timeout > timeout_zero_comparison;
+    ptime deadline;
+    if(has_timeout)
+        deadline = microsec_clock::universal_time() + timeout;
+    
+    std::size_t bytes_read_ = this->pop_read_ring(buffer, size);
+    if(bytes_read_ < minimum && this->write_queue_pending.load(boost::memory_order_acquire))
+        this->flush();
+    while(bytes_read_ < minimum && !nonblocking) {
+        // Only sleep when the ring is empty, the reader thread wakes us when it pushes
+        {
+            boost::mutex::scoped_lock lock(this->read_ring_mutex);
+            while(this->read_ring->read_available() == 0 && this->reader_active) {
+                if(!has_timeout)
+                    this->read_ring_condition.wait(lock);
+                else if(!this->read_ring_condition.timed_wait(lock, deadline)) {
+                    count(this->stats.timeouts);
+                    break;
+                }
+            }
+        }
+        std::size_t popped = this->pop_read_ring(buffer + bytes_read_, size - bytes_read_);
+        if(popped == 0) // Timed out, or the reader thread stopped
             break;
-        case PARITY_EVEN:
-            this->parity = boost::asio::serial_port_base::parity(boost::asio::serial_port_base::parity::even);
+        bytes_read_ += popped;
+    }
+    return bytes_read_;
+}
+
+int Serial::SerialImpl::read(char* buffer, int size) {
+    count(this->stats.read_calls);
+    SERIAL_TRACE_BEGIN(TRACE_READ_BEGIN);
+    
+    // Serve any data left over from a previous read_until first
+    int bytes_read_ = int(this->read_buffer.drain(buffer, size));
+    if(bytes_read_ < size) {
+        if(this->read_ring)
+            bytes_read_ += int(this->read_from_ring(buffer + bytes_read_, size - bytes_read_,
+                                                    size - bytes_read_, this->timeout, this->nonblocking));
+        else
+            bytes_read_ += this->read_from_port(buffer + bytes_read_, size - bytes_read_,
+                                                size - bytes_read_, this->timeout, this->nonblocking);
+        if(bytes_read_ < size)
+            count(this->stats.partial_reads);
+    }
+    SERIAL_TRACE_END(TRACE_READ_END, LATENCY_READ, bytes_read_);
+    return bytes_read_;
+}
+
+size_t Serial::SerialImpl::read(const std::vector<boost::asio::mutable_buffer>& buffers) {
+    using namespace boost::posix_time;
+    
+    // The timeout applies to the whole call, not each buffer
+    bool has_timeout = this->timeout > timeout_zero_comparison;
+    ptime deadline;
+    if(has_timeout)
+        deadline = microsec_clock::universal_time() + this->timeout;
+    
+    count(this->stats.read_calls);
+    SERIAL_TRACE_BEGIN(TRACE_READ_BEGIN);
+    
+    std::size_t bytes_read_ = 0;
+    for(std::size_t i = 0; i < buffers.size(); ++i) {
+        char *data = static_cast<char*>(buffers[i].data());
+        std::size_t size = buffers[i].size();
+        
+        std::size_t read_ = this->read_buffer.drain(data, size);
+        if(read_ < size) {
+            time_duration remaining = this->timeout;
+            if(has_timeout)
+                remaining = deadline - microsec_clock::universal_time();
+            if(!has_timeout || remaining > timeout_zero_comparison) {
+                if(this->read_ring)
+                    read_ += this->read_from_ring(data + read_, size - read_, size - read_, remaining,
+                                                  this->nonblocking);
+                else
+                    read_ += this->read_from_port(data + read_, int(size - read_), int(size - read_), remaining,
+                                                  this->nonblocking);
+            }
+        }
+        bytes_read_ += read_;
+        if(read_ < size) { // Timed out
+            count(this->stats.partial_reads);
             break;
+        }
+    }
+    SERIAL_TRACE_END(TRACE_READ_END, LATENCY_READ, bytes_read_);
+    return bytes_read_;
+}
+
+std::string 
+Serial::SerialImpl::read_until(std::string delim, size_t size) {
+    count(this->stats.read_calls);
+    SERIAL_TRACE_BEGIN(TRACE_READ_UNTIL_BEGIN);
+    
+    std::size_t length = this->read_buffer.fill_until(delim, false, size, this->timeout);
+    std::string return_str(this->read_buffer.data(), length);
+    this->read_buffer.consume(length);
+    SERIAL_TRACE_END(TRACE_READ_UNTIL_END, LATENCY_READ_UNTIL, length);
+    return return_str;
+}
+
+std::string Serial::SerialImpl::read_until_any(const std::string& delims, std::size_t size) {
+    count(this->stats.read_calls);
+    SERIAL_TRACE_BEGIN(TRACE_READ_UNTIL_BEGIN);
+    
+    std::size_t length = this->read_buffer.fill_until(delims, true, size, this->timeout);
+    std::string return_str(this->read_buffer.data(), length);
+    this->read_buffer.consume(length);
+    SERIAL_TRACE_END(TRACE_READ_UNTIL_END, LATENCY_READ_UNTIL, length);
+    return return_str;
+}
+
+void Serial::SerialImpl::setBufferPool(boost::shared_ptr<BufferPool> pool) {
+    this->read_buffer.setBufferPool(pool);
+}
+
+boost::shared_ptr<BufferPool> Serial::SerialImpl::getBufferPool() const {
+    return this->read_buffer.getBufferPool();
+}
+
+std::size_t Serial::SerialImpl::read_until(PooledBuffer& buffer, const std::string& delim, std::size_t size) {
+    count(this->stats.read_calls);
+    SERIAL_TRACE_BEGIN(TRACE_READ_UNTIL_BEGIN);
+    
+    std::size_t length = this->read_buffer.read_until(buffer, delim, size, this->timeout);
+    SERIAL_TRACE_END(TRACE_READ_UNTIL_END, LATENCY_READ_UNTIL, length);
+    return length;
+}
+
+bool Serial::SerialImpl::read_frame(PooledBuffer& frame) {
+    count(this->stats.read_calls);
+    return this->read_buffer.read_frame(frame, this->timeout, this->nonblocking);
+}
+
+void Serial::SerialImpl::setFramer(boost::shared_ptr<Framer> framer) {
+    this->read_buffer.setFramer(framer);
+}
+
+boost::shared_ptr<Framer> Serial::SerialImpl::getFramer() const {
+    return this->read_buffer.getFramer();
+}
+
+void Serial::SerialImpl::setChecksum(boost::shared_ptr<Checksum> checksum) {
+    this->read_buffer.setChecksum(checksum);
+}
+
+boost::shared_ptr<Checksum> Serial::SerialImpl::getChecksum() const {
+    return this->read_buffer.getChecksum();
+}
+
+bool Serial::SerialImpl::read_frame(const char*& frame, size_t& size) {
+    if(!this->read_buffer.getFramer())
+        throw(FramerNotSetException());
+    count(this->stats.read_calls);
+    return this->read_buffer.read_frame(frame, size, this->timeout, this->nonblocking);
+}
+
+size_t Serial::SerialImpl::write_frame(const char* data, size_t length) {
+    this->write_frame_buffer.clear();
+    this->read_buffer.encode_frame(data, length, this->write_checksum_buffer, this->write_frame_buffer);
+    if(this->write_frame_buffer.empty())
+        return 0;
+    return this->write(&this->write_frame_buffer[0], int(this->write_frame_buffer.size()));
+}
+
+void Serial::SerialImpl::async_read(char* buffer, size_t size, ReadHandler handler) {
+    if(!this->isOpen() || this->read_ring) {
+        this->getIoService().post(boost::bind(handler, this->read_ring ? 
+                                          boost::asio::error::operation_not_supported :
+                                          boost::asio::error::bad_descriptor, 0));
+        return;
+    }
+    
+    // Serve any data left over from a previous read_until first
+    count(this->stats.read_calls);
+    std::size_t buffered = this->read_buffer.drain(buffer, size);
+    if(buffered == size) {
+        this->getIoService().post(boost::bind(handler, boost::system::error_code(), size));
+        return;
+    }
+    
+    boost::asio::async_read(this->async_stream(), boost::asio::buffer(buffer + buffered, size - buffered),
+                            boost::bind(&SerialImpl::async_read_complete, this, buffer + buffered, buffered, handler,
+                            boost::asio::placeholders::error,
+                            boost::asio::placeholders::bytes_transferred));
+}
+
+void Serial::SerialImpl::async_read_complete(const char* data, std::size_t buffered, ReadHandler handler,
+                                 const boost::system::error_code& error, std::size_t bytes_transferred) {
+    count(this->stats.bytes_read, bytes_transferred);
+    SERIAL_TRACE(TRACE_READ_DATA, bytes_transferred);
+    this->capture_data(CAPTURE_RX, data, bytes_transferred);
+    handler(error, buffered + bytes_transferred);
+}
+
+void Serial::SerialImpl::async_read_until(const std::string& delim, ReadUntilHandler handler, size_t size) {
+    if(!this->isOpen() || this->read_ring) {
+        this->getIoService().post(boost::bind(handler, this->read_ring ? 
+                                          boost::asio::error::operation_not_supported :
+                                          boost::asio::error::bad_descriptor, std::string()));
+        return;
+    }
+    
+    count(this->stats.read_calls);
+    this->async_read_until_complete(delim, size, 0, handler, boost::system::error_code(), 0);
+}
+
+void Serial::SerialImpl::async_read_until_complete(const std::string& delim, std::size_t size, std::size_t scanned,
+                                       ReadUntilHandler handler, const boost::system::error_code& error,
+                                       std::size_t bytes_transferred) {
+    count(this->stats.bytes_read, bytes_transferred);
+    if(bytes_transferred > 0) {
+        SERIAL_TRACE(TRACE_READ_DATA, bytes_transferred);
+        this->capture_data(CAPTURE_RX, this->read_buffer.data() + this->read_buffer.size(), bytes_transferred);
+    }
+    this->read_buffer.commit(bytes_transferred);
+    
+    std::size_t length = 0;
+    if(this->read_buffer.scan(delim, false, size, scanned, length) || error) {
+        std::string return_str(this->read_buffer.data(), length);
+        this->read_buffer.consume(length);
+        handler(error, return_str);
+        return;
+    }
+    
+    // Scanned offsets are relative to the unread data, so they survive compacting the buffer
+    char *space = this->read_buffer.prepare();
+    this->async_stream().async_read_some(boost::asio::buffer(space, this->read_buffer.space()),
+                                       boost::bind(&SerialImpl::async_read_until_complete, this, delim, size, scanned, handler,
+                                       boost::asio::placeholders::error,
+                                       boost::asio::placeholders::bytes_transferred));
+}
+
+void Serial::SerialImpl::async_write(const char* data, size_t length, WriteHandler handler) {
+    if(!this->isOpen()) {
+        this->getIoService().post(boost::bind(handler, boost::asio::error::bad_descriptor, 0));
+        return;
+    }
+    if(this->write_queue_threshold > 0)
+        this->flush();
+    count(this->stats.write_calls);
+    count(this->stats.write_syscalls);
+    count(this->stats.bytes_written, length);
+    this->capture_data(CAPTURE_TX, data, length);
+    boost::asio::async_write(this->async_stream(), boost::asio::buffer(data, length), handler);
+}
+
+void Serial::SerialImpl::cancel() {
+    if(this->serial_port != NULL)
+        this->serial_port->cancel();
+#if defined(SERIAL_NATIVE_BACKEND) && !defined(_WIN32)
+    this->device_watcher.cancel();
+#endif
+    if(!this->modem_monitor)
+        this->modem_lines.cancel();
+}
+
+async_stream_type& Serial::SerialImpl::async_stream() {
+#ifdef SERIAL_NATIVE_BACKEND
+    return this->serial_port->async_stream(this->getIoService());
+#else
+    return *this->serial_port;
+#endif
+}
+
+boost::asio::io_service& Serial::SerialImpl::getIoService() {
+    // Ports which are never opened never create a reactor of their own. A reading and a
+    // writing thread can both be the first to need it.
+    boost::mutex::scoped_lock lock(this->io_service_mutex);
+    if(this->io_service == NULL) {
+        this->owned_io_service.reset(new boost::asio::io_service());
+        this->work.reset(new boost::asio::io_service::work(*this->owned_io_service));
+        this->io_service = this->owned_io_service.get();
+    }
+    return *this->io_service;
+}
+
+void Serial::SerialImpl::read_complete(const boost::system::error_code& error, std::size_t bytes_transferred) {
+    if(!error || error != boost::asio::error::operation_aborted) { // If there was no error OR the error wasn't operation aborted (canceled), Cancel the timer
+        this->timeout_timer->cancel();  // will cause timeout_callback to fire with an error
+    }
+    
+    count(this->stats.read_syscalls);
+    count(this->stats.bytes_read, bytes_transferred);
+    SERIAL_TRACE(TRACE_READ_DATA, bytes_transferred);
+    
+    boost::mutex::scoped_lock lock(this->handler_mutex);
+    this->bytes_read = bytes_transferred;
+    
+    this->reading = false;
+    this->handler_condition.notify_all();
+}
+
+void Serial::SerialImpl::timeout_callback(const boost::system::error_code& error) {
+    if (!error) {
+        // The timeout wasn't canceled, so cancel the async read
+        this->serial_port->cancel();
+        if(this->timeout > timeout_zero_comparison)
+            count(this->stats.timeouts);
+    }
+    
+    boost::mutex::scoped_lock lock(this->handler_mutex);
+    this->timer_pending = false;
+    this->handler_condition.notify_all();
+}
+
+template <typename ConstBufferSequence>
+std::size_t Serial::SerialImpl::write_to_port(const ConstBufferSequence& buffers) {
+    unsigned long generation = this->open_count;
+    boost::system::error_code ec;
+    std::size_t bytes_wrote = boost::asio::write(*this->serial_port, buffers, boost::asio::transfer_all(), ec);
+    if(ec && this->auto_reconnect) {
+        boost::posix_time::ptime deadline;
+        if(this->timeout > timeout_zero_comparison)
+            deadline = boost::posix_time::microsec_clock::universal_time() + this->timeout;
+        // What the old device took is lost with it, so all of the write is sent again
+        while(ec && this->reconnect(generation, this->reconnect_timeout(deadline, this->nonblocking))) {
+            generation = this->open_count;
+            bytes_wrote = boost::asio::write(*this->serial_port, buffers, boost::asio::transfer_all(), ec);
+        }
+    }
+    boost::asio::detail::throw_error(ec, "write");
+    return bytes_wrote;
+}
+
+int Serial::SerialImpl::write(const char* data, int length) {
+    count(this->stats.write_calls);
+    SERIAL_TRACE_BEGIN(TRACE_WRITE_BEGIN);
+    if(this->write_queue_threshold == 0) {
+        std::size_t bytes_wrote = this->write_to_port(boost::asio::buffer(data, length));
+        count(this->stats.write_syscalls);
+        count(this->stats.bytes_written, bytes_wrote);
+        this->capture_data(CAPTURE_TX, data, bytes_wrote);
+        SERIAL_TRACE_END(TRACE_WRITE_END, LATENCY_WRITE, bytes_wrote);
+        return int(bytes_wrote);
+    }
+    
+    using namespace boost::posix_time;
+    
+    boost::mutex::scoped_lock lock(this->write_mutex);
+    bool has_latency = this->write_queue_latency > timeout_zero_comparison;
+    if(this->write_queue.empty() && has_latency) {
+        this->write_queue_oldest = microsec_clock::universal_time();
+        {
+            boost::mutex::scoped_lock handler_lock(this->handler_mutex);
+            this->flush_timers_pending += 1;
+        }
+        if(!this->flush_timer)
+            this->flush_timer.reset(new boost::asio::deadline_timer(this->getIoService()));
+        this->flush_timer->expires_from_now(this->write_queue_latency);
+        this->flush_timer->async_wait(boost::bind(&SerialImpl::flush_timeout, this,
+                                     boost::asio::placeholders::error));
+    }
+    this->write_queue.insert(this->write_queue.end(), data, data + length);
+    this->write_queue_pending.store(true, boost::memory_order_release);
+    
+    if(this->write_queue.size() >= this->write_queue_threshold ||
+       (has_latency && microsec_clock::universal_time() - this->write_queue_oldest >= this->write_queue_latency))
+        this->flush_write_queue();
+    SERIAL_TRACE_END(TRACE_WRITE_END, LATENCY_WRITE, std::size_t(length));
+    return length;
+}
+
+size_t Serial::SerialImpl::write(const std::vector<boost::asio::const_buffer>& buffers) {
+    if(this->write_queue_threshold == 0) {
+        count(this->stats.write_calls);
+        SERIAL_TRACE_BEGIN(TRACE_WRITE_BEGIN);
+        std::size_t bytes_wrote = this->write_to_port(buffers);
+        count(this->stats.write_syscalls);
+        count(this->stats.bytes_written, bytes_wrote);
+        if(this->capture) {
+            for(std::size_t i = 0; i < buffers.size(); ++i)
+                this->capture_data(CAPTURE_TX, static_cast<const char*>(buffers[i].data()), buffers[i].size());
+        }
+        SERIAL_TRACE_END(TRACE_WRITE_END, LATENCY_WRITE, bytes_wrote);
+        return bytes_wrote;
+    }
+    
+    std::size_t bytes_wrote = 0;
+    for(std::size_t i = 0; i < buffers.size(); ++i)
+        bytes_wrote += this->write(static_cast<const char*>(buffers[i].data()), int(buffers[i].size()));
+    return bytes_wrote;
+}
+
+void Serial::SerialImpl::setWriteQueue(size_t flush_threshold, long max_latency) {
+    boost::mutex::scoped_lock lock(this->write_mutex);
+    if(this->isOpen())
+        this->flush_write_queue();
+    this->write_queue_threshold = flush_threshold;
+    this->write_queue_latency = boost::posix_time::milliseconds(max_latency > 0 ? max_latency : 0);
+    if(flush_threshold > 0)
+        this->write_queue.reserve(flush_threshold);
+}
+
+size_t Serial::SerialImpl::flush() {
+    boost::mutex::scoped_lock lock(this->write_mutex);
+    return this->flush_write_queue();
+}
+
+std::size_t Serial::SerialImpl::flush_write_queue() {
+    // Must be called with write_mutex held
+    if(this->write_queue.empty())
+        return 0;
+    std::size_t bytes_wrote = this->write_to_port(boost::asio::buffer(this->write_queue));
+    count(this->stats.write_syscalls);
+    count(this->stats.bytes_written, bytes_wrote);
+    this->capture_data(CAPTURE_TX, &this->write_queue[0], bytes_wrote);
+    this->write_queue.clear();
+    this->write_queue_pending.store(false, boost::memory_order_release);
+    if(this->flush_timer)
+        this->flush_timer->cancel();
+    return bytes_wrote;
+}
+
+void Serial::SerialImpl::flush_timeout(const boost::system::error_code& error) {
+    if(!error) {
+        boost::mutex::scoped_lock lock(this->write_mutex);
+        if(this->isOpen())
+            this->flush_write_queue();
+    }
+    
+    boost::mutex::scoped_lock lock(this->handler_mutex);
+    this->flush_timers_pending -= 1;
+    this->handler_condition.notify_all();
+}
+
+void Serial::SerialImpl::write_frames(const std::vector<std::string>& requests, std::size_t begin,
+                                      std::size_t end) {
+    if(begin == end)
+        return;
+    this->write_frame_buffer.clear();
+    for(std::size_t i = begin; i < end; ++i)
+        this->read_buffer.encode_frame(requests[i].data(), requests[i].size(), this->write_checksum_buffer,
+                                       this->write_frame_buffer);
+    if(!this->write_frame_buffer.empty())
+        this->write(&this->write_frame_buffer[0], int(this->write_frame_buffer.size()));
+}
+
+SerialStats Serial::SerialImpl::getStats() const {
+    SerialStats stats;
+    stats.bytes_read = this->stats.bytes_read.load(boost::memory_order_relaxed);
+    stats.bytes_written = this->stats.bytes_written.load(boost::memory_order_relaxed);
+    stats.read_calls = this->stats.read_calls.load(boost::memory_order_relaxed);
+    stats.write_calls = this->stats.write_calls.load(boost::memory_order_relaxed);
+    stats.timeouts = this->stats.timeouts.load(boost::memory_order_relaxed);
+    stats.partial_reads = this->stats.partial_reads.load(boost::memory_order_relaxed);
+    stats.syscalls = this->stats.read_syscalls.load(boost::memory_order_relaxed) +
+                     this->stats.write_syscalls.load(boost::memory_order_relaxed);
+    stats.ring_high_water = this->stats.ring_high_water.load(boost::memory_order_relaxed);
+    stats.ring_overruns = this->stats.ring_overruns.load(boost::memory_order_relaxed);
+    stats.framing_errors = this->stats.framing_errors.load(boost::memory_order_relaxed);
+    stats.checksum_errors = this->stats.checksum_errors.load(boost::memory_order_relaxed);
+    stats.reconnects = this->stats.reconnects.load(boost::memory_order_relaxed);
+    stats.capture_errors = this->stats.capture_errors.load(boost::memory_order_relaxed);
+    return stats;
+}
+
+void Serial::SerialImpl::resetStats() {
+    this->stats.bytes_read.store(0, boost::memory_order_relaxed);
+    this->stats.bytes_written.store(0, boost::memory_order_relaxed);
+    this->stats.read_calls.store(0, boost::memory_order_relaxed);
+    this->stats.write_calls.store(0, boost::memory_order_relaxed);
+    this->stats.timeouts.store(0, boost::memory_order_relaxed);
+    this->stats.partial_reads.store(0, boost::memory_order_relaxed);
+    this->stats.read_syscalls.store(0, boost::memory_order_relaxed);
+    this->stats.write_syscalls.store(0, boost::memory_order_relaxed);
+    this->stats.ring_high_water.store(0, boost::memory_order_relaxed);
+    this->stats.ring_overruns.store(0, boost::memory_order_relaxed);
+    this->stats.framing_errors.store(0, boost::memory_order_relaxed);
+    this->stats.checksum_errors.store(0, boost::memory_order_relaxed);
+    this->stats.reconnects.store(0, boost::memory_order_relaxed);
+    this->stats.capture_errors.store(0, boost::memory_order_relaxed);
+}
+
+void Serial::SerialImpl::setTraceCallback(TraceCallback callback) {
+#ifdef SERIAL_ENABLE_TRACING
+    this->trace->callback = callback;
+#else
+    (void)callback;
+#endif
+}
+
+void Serial::SerialImpl::setCapture(boost::shared_ptr<CaptureLog> capture) {
+    this->capture = capture;
+}
+
+boost::shared_ptr<CaptureLog> Serial::SerialImpl::getCapture() const {
+    return this->capture;
+}
+
+void Serial::SerialImpl::capture_data(capture_direction_t direction, const char* data, std::size_t size) {
+    if(!this->capture || size == 0)
+        return;
+    // Called with data already taken from or given to the port, so a capture which cannot
+    // keep up loses the record rather than the read or write. A CaptureLog which failed to
+    // grow drops everything after it.
+    try {
+        this->capture->append(direction, data, size);
+    } catch(const std::exception&) {
+        count(this->stats.capture_errors);
+    }
+}
+
+LatencyHistogram Serial::SerialImpl::getLatencyHistogram(latency_t operation) const {
+    LatencyHistogram histogram;
+#ifdef SERIAL_ENABLE_TRACING
+    histogram = this->trace->histograms[operation].snapshot();
+#else
+    (void)operation;
+#endif
+    return histogram;
+}
+
+void Serial::SerialImpl::resetLatencyHistograms() {
+#ifdef SERIAL_ENABLE_TRACING
+    for(std::size_t i = 0; i <= LATENCY_READ_UNTIL; ++i)
+        this->trace->histograms[i].reset();
+#endif
+}
+
+void Serial::SerialImpl::setRTS(bool level) {
+    if(this->serial_port == NULL)
+        throw(SerialPortNotOpenException(this->port.c_str()));
+    ModemLines::set_rts(this->serial_port->native_handle(), level);
+}
+
+void Serial::SerialImpl::setDTR(bool level) {
+    if(this->serial_port == NULL)
+        throw(SerialPortNotOpenException(this->port.c_str()));
+    ModemLines::set_dtr(this->serial_port->native_handle(), level);
+}
+
+bool Serial::SerialImpl::getCTS() const {
+    return (this->getModemLines() & MODEM_CTS) != 0;
+}
+
+bool Serial::SerialImpl::getDSR() const {
+    return (this->getModemLines() & MODEM_DSR) != 0;
+}
+
+bool Serial::SerialImpl::getRI() const {
+    return (this->getModemLines() & MODEM_RI) != 0;
+}
+
+bool Serial::SerialImpl::getCD() const {
+    return (this->getModemLines() & MODEM_CD) != 0;
+}
+
+unsigned int Serial::SerialImpl::getModemLines() const {
+    if(this->serial_port == NULL)
+        throw(SerialPortNotOpenException(this->port.c_str()));
+    return ModemLines::status(this->serial_port->native_handle());
+}
+
+bool Serial::SerialImpl::waitForChange(unsigned int lines) {
+    if(this->serial_port == NULL)
+        throw(SerialPortNotOpenException(this->port.c_str()));
+    unsigned int status = 0;
+    return this->modem_lines.wait(this->serial_port->native_handle(), lines, status);
+}
+
+void Serial::SerialImpl::startModemMonitor(ModemLinesCallback callback, unsigned int lines) {
+    if(this->serial_port == NULL)
+        throw(SerialPortNotOpenException(this->port.c_str()));
+    if(this->modem_monitor)
+        return;
+    this->modem_monitor_active = true;
+    this->modem_monitor.reset(new boost::thread(boost::bind(&SerialImpl::modem_monitor_main, this, callback, lines)));
+}
+
+void Serial::SerialImpl::stopModemMonitor() {
+    if(!this->modem_monitor)
+        return;
+    
+    // The monitor may be running the callback rather than waiting, so cancel until it exits
+    this->modem_monitor_active = false;
+    do {
+        this->modem_lines.cancel();
+    } while(!this->modem_monitor->timed_join(boost::posix_time::milliseconds(10)));
+    this->modem_monitor.reset();
+}
+
+void Serial::SerialImpl::modem_monitor_main(ModemLinesCallback callback, unsigned int lines) {
+    ModemLines::native_handle_type handle = this->serial_port->native_handle();
+    while(this->modem_monitor_active) {
+        unsigned int status = 0;
+        try {
+            if(!this->modem_lines.wait(handle, lines, status))
+                continue;
+        } catch(boost::system::system_error &e) {
+            callback(e.code(), 0);
+            return;
+        }
+        callback(boost::system::error_code(), status);
+    }
+}
+
+static boost::asio::serial_port_base::character_size bytesize_option(bytesize_t bytesize) {
+    switch(bytesize) {
+        case FIVEBITS:
+            return boost::asio::serial_port_base::character_size(5);
+        case SIXBITS:
+            return boost::asio::serial_port_base::character_size(6);
+        case SEVENBITS:
+            return boost::asio::serial_port_base::character_size(7);
+        case EIGHTBITS:
+            return boost::asio::serial_port_base::character_size(8);
         default:
-            throw(InvalidParityException(parity));
-            break;
+            throw(InvalidBytesizeException(bytesize));
     }
 }
 
-parity_t Serial::getParity() const {
-    switch(this->parity.value()) {
-        case boost::asio::serial_port_base::parity::none:
-            return parity_t(PARITY_NONE);
-        case boost::asio::serial_port_base::parity::odd:
-            return parity_t(PARITY_ODD);
-        case boost::asio::serial_port_base::parity::even:
-            return parity_t(PARITY_EVEN);
+static boost::asio::serial_port_base::parity parity_option(parity_t parity) {
+    switch(parity) {
+        case PARITY_NONE:
+            return boost::asio::serial_port_base::parity(boost::asio::serial_port_base::parity::none);
+        case PARITY_ODD:
+            return boost::asio::serial_port_base::parity(boost::asio::serial_port_base::parity::odd);
+        case PARITY_EVEN:
+            return boost::asio::serial_port_base::parity(boost::asio::serial_port_base::parity::even);
         default:
-            throw(InvalidParityException(this->parity.value()));
+            throw(InvalidParityException(parity));
     }
 }
 
-void Serial::setStopbits(stopbits_t stopbits) {
+static boost::asio::serial_port_base::stop_bits stopbits_option(stopbits_t stopbits) {
     switch(stopbits) {
         case STOPBITS_ONE:
-            this->stopbits = boost::asio::serial_port_base::stop_bits(boost::asio::serial_port_base::stop_bits::one);
-            break;
+            return boost::asio::serial_port_base::stop_bits(boost::asio::serial_port_base::stop_bits::one);
         case STOPBITS_ONE_POINT_FIVE:
-            this->stopbits = boost::asio::serial_port_base::stop_bits(boost::asio::serial_port_base::stop_bits::onepointfive);
-            break;
+            return boost::asio::serial_port_base::stop_bits(boost::asio::serial_port_base::stop_bits::onepointfive);
         case STOPBITS_TWO:
-            this->stopbits = boost::asio::serial_port_base::stop_bits(boost::asio::serial_port_base::stop_bits::two);
-            break;
+            return boost::asio::serial_port_base::stop_bits(boost::asio::serial_port_base::stop_bits::two);
         default:
             throw(InvalidStopbitsException(stopbits));
-            break;
     }
 }
 
-stopbits_t Serial::getStopbits() const {
-    switch(this->stopbits.value()) {
-        case boost::asio::serial_port_base::stop_bits::one:
-            return stopbits_t(STOPBITS_ONE);
-        case boost::asio::serial_port_base::stop_bits::onepointfive:
-            return stopbits_t(STOPBITS_ONE_POINT_FIVE);
-        case boost::asio::serial_port_base::stop_bits::two:
-            return stopbits_t(STOPBITS_TWO);
+static boost::asio::serial_port_base::flow_control flowcontrol_option(flowcontrol_t flowcontrol) {
+    switch(flowcontrol) {
+        case FLOWCONTROL_NONE:
+            return boost::asio::serial_port_base::flow_control(boost::asio::serial_port_base::flow_control::none);
+        case FLOWCONTROL_SOFTWARE:
+            return boost::asio::serial_port_base::flow_control(boost::asio::serial_port_base::flow_control::software);
+        case FLOWCONTROL_HARDWARE:
+            return boost::asio::serial_port_base::flow_control(boost::asio::serial_port_base::flow_control::hardware);
         default:
-            throw(InvalidStopbitsException(this->stopbits.value()));
+            throw(InvalidFlowcontrolException(flowcontrol));
     }
 }
 
-void Serial::setFlowcontrol(flowcontrol_t flowcontrol) {
-    switch(flowcontrol) {
-        case FLOWCONTROL_NONE:
-            this->flowcontrol = boost::asio::serial_port_base::flow_control(boost::asio::serial_port_base::flow_control::none);
-            break;
-        case FLOWCONTROL_SOFTWARE:
-            this->flowcontrol = boost::asio::serial_port_base::flow_control(boost::asio::serial_port_base::flow_control::software);
-            break;
-        case FLOWCONTROL_HARDWARE:
-            this->flowcontrol = boost::asio::serial_port_base::flow_control(boost::asio::serial_port_base::flow_control::hardware);
-            break;
+void Serial::SerialImpl::setPort(std::string port) {
+    this->port = port;
+    this->saved_settings.clear();
+}
+
+std::string Serial::SerialImpl::getPort() const {
+    return this->port;
+}
+
+void Serial::SerialImpl::setTimeoutMilliseconds(long timeout) {
+    // If timeout > 0 then read until size or timeout occurs
+    // If timeout == 0 then read nonblocking, return data available immediately up to size
+    // If timeout < 0 then read blocking, until size is read, period.
+    if(timeout > 0) {
+        this->timeout = boost::posix_time::time_duration(boost::posix_time::milliseconds(timeout));
+    } else {
+        this->timeout = boost::posix_time::time_duration(boost::posix_time::milliseconds(0));
+    }
+    
+    if(timeout == 0)
+        this->nonblocking = true;
+    else // Must be negative
+        this->nonblocking = false;
+}
+
+long Serial::SerialImpl::getTimeoutMilliseconds() const {
+    return this->timeout.total_milliseconds();
+}
+
+void Serial::SerialImpl::setSettings(const PortSettings& settings) {
+    // Converting checks every setting before anything is changed
+    boost::asio::serial_port_base::baud_rate baudrate(settings.baudrate);
+    boost::asio::serial_port_base::character_size bytesize = bytesize_option(settings.bytesize);
+    boost::asio::serial_port_base::parity parity = parity_option(settings.parity);
+    boost::asio::serial_port_base::stop_bits stopbits = stopbits_option(settings.stopbits);
+    boost::asio::serial_port_base::flow_control flowcontrol = flowcontrol_option(settings.flowcontrol);
+    
+    if(this->isOpen())
+        this->apply_settings(settings);
+    else
+        this->saved_settings.clear();
+    this->baudrate = baudrate;
+    this->bytesize = bytesize;
+    this->parity = parity;
+    this->stopbits = stopbits;
+    this->flowcontrol = flowcontrol;
+}
+
+PortSettings Serial::SerialImpl::getSettings() const {
+    return PortSettings(this->getBaudrate(), this->getBytesize(), this->getParity(),
+                        this->getStopbits(), this->getFlowcontrol());
+}
+
+void Serial::SerialImpl::apply_settings(const PortSettings& settings) {
+    // The new settings are made in a copy of the driver's whole configuration, which is
+    // then applied at once
+    SavedSettings::native_handle_type handle = this->serial_port->native_handle();
+    boost::system::error_code ec;
+    if(!this->saved_settings.isValid())
+        this->saved_settings.save(handle, this->baudrate.value());
+    this->saved_settings.update(settings, ec);
+    if(!ec)
+        this->saved_settings.restore(handle, ec);
+    if(ec) {
+        this->saved_settings.clear();
+        boost::asio::detail::throw_error(ec, "set_option");
+    }
+}
+
+void Serial::SerialImpl::setBaudrate(int baudrate) {
+    PortSettings settings = this->getSettings();
+    settings.baudrate = baudrate;
+    this->setSettings(settings);
+}
+
+int Serial::SerialImpl::getBaudrate() const {
+    return this->baudrate.value();
+}
+
+void Serial::SerialImpl::setBytesize(bytesize_t bytesize) {
+    PortSettings settings = this->getSettings();
+    settings.bytesize = bytesize;
+    this->setSettings(settings);
+}
+
+bytesize_t Serial::SerialImpl::getBytesize() const {
+    return bytesize_t(this->bytesize.value());
+}
+
+void Serial::SerialImpl::setParity(parity_t parity) {
+    PortSettings settings = this->getSettings();
+    settings.parity = parity;
+    this->setSettings(settings);
+}
+
+parity_t Serial::SerialImpl::getParity() const {
+    switch(this->parity.value()) {
+        case boost::asio::serial_port_base::parity::none:
+            return parity_t(PARITY_NONE);
+        case boost::asio::serial_port_base::parity::odd:
+            return parity_t(PARITY_ODD);
+        case boost::asio::serial_port_base::parity::even:
+            return parity_t(PARITY_EVEN);
         default:
-            throw(InvalidFlowcontrolException(flowcontrol));
-            break;
+            throw(InvalidParityException(this->parity.value()));
     }
 }
 
-flowcontrol_t Serial::getFlowcontrol() const {
+void Serial::SerialImpl::setStopbits(stopbits_t stopbits) {
+    PortSettings settings = this->getSettings();
+    settings.stopbits = stopbits;
+    this->setSettings(settings);
+}
+
+stopbits_t Serial::SerialImpl::getStopbits() const {
+    switch(this->stopbits.value()) {
+        case boost::asio::serial_port_base::stop_bits::one:
+            return stopbits_t(STOPBITS_ONE);
+        case boost::asio::serial_port_base::stop_bits::onepointfive:
+            return stopbits_t(STOPBITS_ONE_POINT_FIVE);
+        case boost::asio::serial_port_base::stop_bits::two:
+            return stopbits_t(STOPBITS_TWO);
+        default:
+            throw(InvalidStopbitsException(this->stopbits.value()));
+    }
+}
+
+void Serial::SerialImpl::setFlowcontrol(flowcontrol_t flowcontrol) {
+    PortSettings settings = this->getSettings();
+    settings.flowcontrol = flowcontrol;
+    this->setSettings(settings);
+}
+
+flowcontrol_t Serial::SerialImpl::getFlowcontrol() const {
     switch(this->flowcontrol.value()) {
         case boost::asio::serial_port_base::flow_control::none:
             return flowcontrol_t(FLOWCONTROL_NONE);
@@ -464,3 +1955,458 @@ flowcontrol_t Serial::getFlowcontrol() const {
             throw(InvalidFlowcontrolException(this->flowcontrol.value()));
     }
 }
+
+bool Serial::SerialImpl::setLowLatency(bool enable) {
+    bool changed = false;
+    if(this->isOpen() && enable && !this->low_latency)
+        changed = this->low_latency_profile.apply(this->serial_port->native_handle(), this->port);
+    else if(this->isOpen() && !enable && this->low_latency)
+        this->low_latency_profile.restore(this->serial_port->native_handle(), this->port);
+    this->low_latency = enable;
+    return changed;
+}
+
+bool Serial::SerialImpl::getLowLatency() const {
+    return this->low_latency;
+}
+
+bool Serial::SerialImpl::setAutoReconnect(bool enable) {
+#if defined(SERIAL_NATIVE_BACKEND) && !defined(_WIN32)
+    this->auto_reconnect = enable;
+    return true;
+#else
+    (void)enable;
+    return false;
+#endif
+}
+
+bool Serial::SerialImpl::getAutoReconnect() const {
+    return this->auto_reconnect;
+}
+
+void Serial::SerialImpl::setBusyPoll(long microseconds) {
+    this->busy_poll = std::max(microseconds, 0L);
+}
+
+long Serial::SerialImpl::getBusyPoll() const {
+    return this->busy_poll;
+}
+
+/** ResponseMatch **/
+
+ResponseMatch ResponseMatch::length(size_t size) {
+    ResponseMatch match;
+    match.kind = LENGTH;
+    match.size = size;
+    return match;
+}
+
+ResponseMatch ResponseMatch::delimiter(const std::string& delim, size_t size) {
+    ResponseMatch match;
+    match.kind = DELIMITER;
+    match.size = size;
+    match.delim = delim;
+    return match;
+}
+
+ResponseMatch ResponseMatch::frame() {
+    ResponseMatch match;
+    match.kind = FRAME;
+    match.size = 0;
+    return match;
+}
+
+/** Serial Class Implementation **/
+
+Serial::Serial() : pimpl(new SerialImpl(NULL)) {}
+
+Serial::Serial(std::string port,
+               int baudrate,
+               long timeout,
+               bytesize_t bytesize,
+               parity_t parity,
+               stopbits_t stopbits,
+               flowcontrol_t flowcontrol)
+               : pimpl(new SerialImpl(NULL))
+{
+    this->pimpl->setup(port, baudrate, timeout, bytesize, parity, stopbits, flowcontrol);
+}
+
+Serial::Serial(boost::asio::io_service& io_service) : pimpl(new SerialImpl(&io_service)) {}
+
+Serial::Serial(boost::asio::io_service& io_service,
+               std::string port,
+               int baudrate,
+               long timeout,
+               bytesize_t bytesize,
+               parity_t parity,
+               stopbits_t stopbits,
+               flowcontrol_t flowcontrol)
+               : pimpl(new SerialImpl(&io_service))
+{
+    this->pimpl->setup(port, baudrate, timeout, bytesize, parity, stopbits, flowcontrol);
+}
+
+Serial::~Serial() {}
+
+void Serial::open() {
+    this->pimpl->open();
+}
+
+bool Serial::isOpen() {
+    return this->pimpl->isOpen();
+}
+
+void Serial::close() {
+    this->pimpl->close();
+}
+
+void Serial::startReaderThread(size_t buffer_size) {
+    this->pimpl->startReaderThread(buffer_size);
+}
+
+void Serial::stopReaderThread() {
+    this->pimpl->stopReaderThread();
+}
+
+bool Serial::isReaderThreadRunning() const {
+    return this->pimpl->isReaderThreadRunning();
+}
+
+size_t Serial::available() {
+    return this->pimpl->available();
+}
+
+bool Serial::waitReadable(long timeout) {
+    return this->pimpl->waitReadable(timeout);
+}
+
+bool Serial::waitWritable(long timeout) {
+    return this->pimpl->waitWritable(timeout);
+}
+
+bool Serial::getSelectHandle(intptr_t& handle, unsigned long& generation) const {
+    return this->pimpl->getSelectHandle(handle, generation);
+}
+
+void Serial::addHandleListener(const boost::shared_ptr<HandleListener>& listener) {
+    this->pimpl->addHandleListener(listener);
+}
+
+void Serial::removeHandleListener(const HandleListener* listener) {
+    this->pimpl->removeHandleListener(listener);
+}
+
+size_t Serial::getBufferedSize() const {
+    return this->pimpl->getBufferedSize();
+}
+
+int Serial::read(char* buffer, int size) {
+    return this->pimpl->read(buffer, size);
+}
+
+size_t Serial::read(const std::vector<boost::asio::mutable_buffer>& buffers) {
+    return this->pimpl->read(buffers);
+}
+
+std::string 
+Serial::read_until(std::string delim, size_t size) {
+    return this->pimpl->read_until(delim, size);
+}
+
+std::string Serial::read_until_any(const std::string& delims, size_t size) {
+    return this->pimpl->read_until_any(delims, size);
+}
+
+size_t Serial::read_until(PooledBuffer& buffer, const std::string& delim, size_t size) {
+    return this->pimpl->read_until(buffer, delim, size);
+}
+
+void Serial::setBufferPool(boost::shared_ptr<BufferPool> pool) {
+    this->pimpl->setBufferPool(pool);
+}
+
+boost::shared_ptr<BufferPool> Serial::getBufferPool() const {
+    return this->pimpl->getBufferPool();
+}
+
+void Serial::setFramer(boost::shared_ptr<Framer> framer) {
+    this->pimpl->setFramer(framer);
+}
+
+boost::shared_ptr<Framer> Serial::getFramer() const {
+    return this->pimpl->getFramer();
+}
+
+void Serial::setChecksum(boost::shared_ptr<Checksum> checksum) {
+    this->pimpl->setChecksum(checksum);
+}
+
+boost::shared_ptr<Checksum> Serial::getChecksum() const {
+    return this->pimpl->getChecksum();
+}
+
+bool Serial::read_frame(const char*& frame, size_t& size) {
+    return this->pimpl->read_frame(frame, size);
+}
+
+bool Serial::read_frame(PooledBuffer& frame) {
+    return this->pimpl->read_frame(frame);
+}
+
+size_t Serial::write_frame(const char* data, size_t length) {
+    return this->pimpl->write_frame(data, length);
+}
+
+void Serial::async_read(char* buffer, size_t size, ReadHandler handler) {
+    this->pimpl->async_read(buffer, size, handler);
+}
+
+void Serial::async_read_until(const std::string& delim, ReadUntilHandler handler, size_t size) {
+    this->pimpl->async_read_until(delim, handler, size);
+}
+
+void Serial::async_write(const char* data, size_t length, WriteHandler handler) {
+    this->pimpl->async_write(data, length, handler);
+}
+
+void Serial::cancel() {
+    this->pimpl->cancel();
+}
+
+boost::asio::io_service& Serial::getIoService() {
+    return this->pimpl->getIoService();
+}
+
+int Serial::write(const char* data, int length) {
+    return this->pimpl->write(data, length);
+}
+
+size_t Serial::write(const std::vector<boost::asio::const_buffer>& buffers) {
+    return this->pimpl->write(buffers);
+}
+
+void Serial::setWriteQueue(size_t flush_threshold, long max_latency) {
+    this->pimpl->setWriteQueue(flush_threshold, max_latency);
+}
+
+size_t Serial::flush() {
+    return this->pimpl->flush();
+}
+
+void Serial::write_requests(const std::vector<std::string>& requests, size_t begin, size_t end,
+                            const ResponseMatch& match) {
+    if(match.kind == ResponseMatch::FRAME)
+        this->pimpl->write_frames(requests, begin, end);
+    else
+        SerialStream::write_requests(requests, begin, end, match);
+}
+
+SerialStats Serial::getStats() const {
+    return this->pimpl->getStats();
+}
+
+void Serial::resetStats() {
+    this->pimpl->resetStats();
+}
+
+bool Serial::isTracingEnabled() {
+#ifdef SERIAL_ENABLE_TRACING
+    return true;
+#else
+    return false;
+#endif
+}
+
+void Serial::setTraceCallback(TraceCallback callback) {
+    this->pimpl->setTraceCallback(callback);
+}
+
+void Serial::setCapture(boost::shared_ptr<CaptureLog> capture) {
+    this->pimpl->setCapture(capture);
+}
+
+boost::shared_ptr<CaptureLog> Serial::getCapture() const {
+    return this->pimpl->getCapture();
+}
+
+LatencyHistogram Serial::getLatencyHistogram(latency_t operation) const {
+    return this->pimpl->getLatencyHistogram(operation);
+}
+
+void Serial::resetLatencyHistograms() {
+    this->pimpl->resetLatencyHistograms();
+}
+
+void Serial::setRTS(bool level) {
+    this->pimpl->setRTS(level);
+}
+
+void Serial::setDTR(bool level) {
+    this->pimpl->setDTR(level);
+}
+
+bool Serial::getCTS() const {
+    return this->pimpl->getCTS();
+}
+
+bool Serial::getDSR() const {
+    return this->pimpl->getDSR();
+}
+
+bool Serial::getRI() const {
+    return this->pimpl->getRI();
+}
+
+bool Serial::getCD() const {
+    return this->pimpl->getCD();
+}
+
+unsigned int Serial::getModemLines() const {
+    return this->pimpl->getModemLines();
+}
+
+bool Serial::waitForChange(unsigned int lines) {
+    return this->pimpl->waitForChange(lines);
+}
+
+void Serial::startModemMonitor(ModemLinesCallback callback, unsigned int lines) {
+    this->pimpl->startModemMonitor(callback, lines);
+}
+
+void Serial::stopModemMonitor() {
+    this->pimpl->stopModemMonitor();
+}
+
+void Serial::setPort(std::string port) {
+    this->pimpl->setPort(port);
+}
+
+std::string Serial::getPort() const {
+    return this->pimpl->getPort();
+}
+
+void Serial::setTimeoutMilliseconds(long timeout) {
+    this->pimpl->setTimeoutMilliseconds(timeout);
+}
+
+long Serial::getTimeoutMilliseconds() const {
+    return this->pimpl->getTimeoutMilliseconds();
+}
+
+void Serial::setSettings(const PortSettings& settings) {
+    this->pimpl->setSettings(settings);
+}
+
+PortSettings Serial::getSettings() const {
+    return this->pimpl->getSettings();
+}
+
+void Serial::setBaudrate(int baudrate) {
+    this->pimpl->setBaudrate(baudrate);
+}
+
+int Serial::getBaudrate() const {
+    return this->pimpl->getBaudrate();
+}
+
+void Serial::setBytesize(bytesize_t bytesize) {
+    this->pimpl->setBytesize(bytesize);
+}
+
+bytesize_t Serial::getBytesize() const {
+    return this->pimpl->getBytesize();
+}
+
+void Serial::setParity(parity_t parity) {
+    this->pimpl->setParity(parity);
+}
+
+parity_t Serial::getParity() const {
+    return this->pimpl->getParity();
+}
+
+void Serial::setStopbits(stopbits_t stopbits) {
+    this->pimpl->setStopbits(stopbits);
+}
+
+stopbits_t Serial::getStopbits() const {
+    return this->pimpl->getStopbits();
+}
+
+void Serial::setFlowcontrol(flowcontrol_t flowcontrol) {
+    this->pimpl->setFlowcontrol(flowcontrol);
+}
+
+flowcontrol_t Serial::getFlowcontrol() const {
+    return this->pimpl->getFlowcontrol();
+}
+
+bool Serial::setLowLatency(bool enable) {
+    return this->pimpl->setLowLatency(enable);
+}
+
+bool Serial::getLowLatency() const {
+    return this->pimpl->getLowLatency();
+}
+
+bool Serial::setAutoReconnect(bool enable) {
+    return this->pimpl->setAutoReconnect(enable);
+}
+
+bool Serial::getAutoReconnect() const {
+    return this->pimpl->getAutoReconnect();
+}
+
+void Serial::setBusyPoll(long microseconds) {
+    this->pimpl->setBusyPoll(microseconds);
+}
+
+long Serial::getBusyPoll() const {
+    return this->pimpl->getBusyPoll();
+}
+
+/** Exceptions **/
+
+// The message is built once here, what() must not return a pointer into a temporary
+SerialPortAlreadyOpenException::SerialPortAlreadyOpenException(const char * port) {
+    std::stringstream ss;
+    ss << "Serial Port already open: " << port;
+    this->e_what_ = ss.str();
+}
+
+SerialPortNotOpenException::SerialPortNotOpenException(const char * port) {
+    std::stringstream ss;
+    ss << "Serial Port not open: " << port;
+    this->e_what_ = ss.str();
+}
+
+SerialPortFailedToOpenException::SerialPortFailedToOpenException(const char * e_what) {
+    std::stringstream ss;
+    ss << "Serial Port failed to open: " << e_what;
+    this->e_what_ = ss.str();
+}
+
+InvalidBytesizeException::InvalidBytesizeException(int bytesize) {
+    std::stringstream ss;
+    ss << "Invalid bytesize provided: " << bytesize;
+    this->e_what_ = ss.str();
+}
+
+InvalidParityException::InvalidParityException(int parity) {
+    std::stringstream ss;
+    ss << "Invalid parity provided: " << parity;
+    this->e_what_ = ss.str();
+}
+
+InvalidStopbitsException::InvalidStopbitsException(int stopbits) {
+    std::stringstream ss;
+    ss << "Invalid stopbits provided: " << stopbits;
+    this->e_what_ = ss.str();
+}
+
+InvalidFlowcontrolException::InvalidFlowcontrolException(int flowcontrol) {
+    std::stringstream ss;
+    ss << "Invalid flowcontrol provided: " << flowcontrol;
+    this->e_what_ = ss.str();
+}
@@ -0,0 +1,470 @@
+#include "serial/serial_selector.h"
+#include <algorithm>
+#include <stdexcept>
+
+#include <boost/system/system_error.hpp>
+
+#if defined(BOOST_WINDOWS) || defined(__CYGWIN__)
+# include <windows.h>
+#else
+# include <errno.h>
+# include <fcntl.h>
+# include <poll.h>
+# include <unistd.h>
+# if defined(__linux__)
+#  include <sys/epoll.h>
+#  include <sys/eventfd.h>
+# endif
+#endif
+
+using namespace serial;
+
+#if defined(BOOST_WINDOWS) || defined(__CYGWIN__)
+static void throw_last_error(const char* what) {
+    throw boost::system::system_error(
+        boost::system::error_code(::GetLastError(), boost::system::system_category()), what);
+}
+#else
+static void throw_last_error(const char* what) {
+    throw boost::system::system_error(
+        boost::system::error_code(errno, boost::system::system_category()), what);
+}
+#endif
+
+/** Selector Implementation Class **/
+
+// A registered port and the handle it was last seen with
+struct PortEntry {
+    Serial* serial;
+    bool open;
+    intptr_t handle;
+    unsigned long generation;
+    bool ready;
+#if defined(BOOST_WINDOWS) || defined(__CYGWIN__)
+    // The outstanding WaitCommEvent for EV_RXCHAR, if any
+    HANDLE event;
+    OVERLAPPED overlapped;
+    DWORD events;
+    bool pending;
+#elif defined(__linux__)
+    bool registered;
+#endif
+};
+
+class SerialSelector::SelectorImpl {
+public:
+    SelectorImpl();
+    ~SelectorImpl();
+    
+    void add(Serial& serial);
+    void remove(Serial& serial);
+    std::size_t size() const;
+    std::size_t select(std::vector<Serial*>& ready, long timeout);
+    void interrupt();
+private:
+    void update(PortEntry& entry);
+    void release(PortEntry& entry);
+    void mark_ready(PortEntry& entry, std::vector<Serial*>& ready);
+    std::size_t wait(std::vector<Serial*>& ready, long timeout);
+#if defined(BOOST_WINDOWS) || defined(__CYGWIN__)
+    void cancel_wait(PortEntry& entry);
+#endif
+    
+    std::vector<PortEntry*> entries;
+#if defined(BOOST_WINDOWS) || defined(__CYGWIN__)
+    HANDLE interrupt_event;
+    std::vector<HANDLE> wait_handles;
+    std::vector<PortEntry*> wait_entries;
+#elif defined(__linux__)
+    class EpollSet;
+    boost::shared_ptr<EpollSet> epoll_set;
+    int interrupt_fd;
+    std::vector<struct epoll_event> events;
+#else
+    int interrupt_pipe[2];
+    std::vector<struct pollfd> pollfds;
+    std::vector<PortEntry*> poll_entries;
+#endif
+};
+
+#if defined(__linux__) && !(defined(BOOST_WINDOWS) || defined(__CYGWIN__))
+// Shared with the registered ports, which take their descriptor out of the set before they
+// close or replace it. Closing a descriptor only leaves the set once no other descriptor,
+// e.g. one inherited by fork() or made by dup(), refers to the same device, and dup2() keeps
+// the number. A port may do this after the selector has gone, so the set owns the epoll fd.
+class SerialSelector::SelectorImpl::EpollSet : public Serial::HandleListener {
+public:
+    explicit EpollSet(int fd) : fd(fd) {}
+    virtual ~EpollSet() {
+        ::close(this->fd);
+    }
+    
+    virtual void closing(intptr_t handle) {
+        ::epoll_ctl(this->fd, EPOLL_CTL_DEL, int(handle), NULL);
+    }
+    
+    const int fd;
+};
+#endif
+
+SerialSelector::SelectorImpl::~SelectorImpl() {
+    // The ports may already be gone, only what the selector owns is cleaned up
+    for(std::size_t i = 0; i < this->entries.size(); ++i) {
+#if defined(BOOST_WINDOWS) || defined(__CYGWIN__)
+        this->cancel_wait(*this->entries[i]);
+        ::CloseHandle(this->entries[i]->event);
+#endif
+        delete this->entries[i];
+    }
+#if defined(BOOST_WINDOWS) || defined(__CYGWIN__)
+    ::CloseHandle(this->interrupt_event);
+#elif defined(__linux__)
+    ::close(this->interrupt_fd);
+#else
+    ::close(this->interrupt_pipe[0]);
+    ::close(this->interrupt_pipe[1]);
+#endif
+}
+
+void SerialSelector::SelectorImpl::add(Serial& serial) {
+    for(std::size_t i = 0; i < this->entries.size(); ++i) {
+        if(this->entries[i]->serial == &serial)
+            return;
+    }
+#if defined(BOOST_WINDOWS) || defined(__CYGWIN__)
+    if(this->entries.size() + 1 >= MAXIMUM_WAIT_OBJECTS)
+        throw std::length_error("SerialSelector: too many ports");
+#endif
+    
+    PortEntry* entry = new PortEntry();
+    entry->serial = &serial;
+    entry->open = false;
+    entry->handle = 0;
+    entry->generation = 0;
+    entry->ready = false;
+#if defined(BOOST_WINDOWS) || defined(__CYGWIN__)
+    entry->events = 0;
+    entry->pending = false;
+    entry->event = ::CreateEvent(NULL, TRUE, FALSE, NULL);
+    if(entry->event == NULL) {
+        delete entry;
+        throw_last_error("CreateEvent");
+    }
+#elif defined(__linux__)
+    entry->registered = false;
+    serial.addHandleListener(this->epoll_set);
+#endif
+    this->entries.push_back(entry);
+}
+
+void SerialSelector::SelectorImpl::remove(Serial& serial) {
+    for(std::size_t i = 0; i < this->entries.size(); ++i) {
+        if(this->entries[i]->serial == &serial) {
+            this->release(*this->entries[i]);
+#if defined(__linux__) && !(defined(BOOST_WINDOWS) || defined(__CYGWIN__))
+            serial.removeHandleListener(this->epoll_set.get());
+#endif
+            delete this->entries[i];
+            this->entries.erase(this->entries.begin() + i);
+            return;
+        }
+    }
+}
+
+std::size_t SerialSelector::SelectorImpl::size() const {
+    return this->entries.size();
+}
+
+void SerialSelector::SelectorImpl::mark_ready(PortEntry& entry, std::vector<Serial*>& ready) {
+    if(!entry.ready) {
+        entry.ready = true;
+        ready.push_back(entry.serial);
+    }
+}
+
+std::size_t SerialSelector::SelectorImpl::select(std::vector<Serial*>& ready, long timeout) {
+    ready.clear();
+    
+    // Data which is already buffered can be read without waiting on anything
+    for(std::size_t i = 0; i < this->entries.size(); ++i) {
+        PortEntry& entry = *this->entries[i];
+        entry.ready = false;
+        this->update(entry);
+        if(entry.open && entry.serial->getBufferedSize() > 0)
+            this->mark_ready(entry, ready);
+    }
+    
+    this->wait(ready, ready.empty() ? timeout : 0);
+    return ready.size();
+}
+
+#if defined(BOOST_WINDOWS) || defined(__CYGWIN__)
+
+SerialSelector::SelectorImpl::SelectorImpl() {
+    this->interrupt_event = ::CreateEvent(NULL, FALSE, FALSE, NULL);
+    if(this->interrupt_event == NULL)
+        throw_last_error("CreateEvent");
+}
+
+void SerialSelector::SelectorImpl::update(PortEntry& entry) {
+    intptr_t handle = 0;
+    unsigned long generation = 0;
+    bool open = entry.serial->getSelectHandle(handle, generation);
+    if(open == entry.open && handle == entry.handle && generation == entry.generation)
+        return;
+    // Closing the old handle aborted any wait on it
+    entry.pending = false;
+    entry.open = open;
+    entry.handle = handle;
+    entry.generation = generation;
+}
+
+void SerialSelector::SelectorImpl::cancel_wait(PortEntry& entry) {
+    // The OVERLAPPED must not be freed while the wait can still complete into it
+    if(entry.pending) {
+        HANDLE handle = reinterpret_cast<HANDLE>(entry.handle);
+        DWORD transferred = 0;
+        ::CancelIoEx(handle, &entry.overlapped);
+        ::GetOverlappedResult(handle, &entry.overlapped, &transferred, TRUE);
+        entry.pending = false;
+    }
+}
+
+void SerialSelector::SelectorImpl::release(PortEntry& entry) {
+    this->update(entry);
+    this->cancel_wait(entry);
+    ::CloseHandle(entry.event);
+}
+
+static bool has_input(HANDLE handle) {
+    COMSTAT status;
+    DWORD errors = 0;
+    if(!::ClearCommError(handle, &errors, &status))
+        return true; // Let the read report the error
+    return status.cbInQue > 0;
+}
+
+std::size_t SerialSelector::SelectorImpl::wait(std::vector<Serial*>& ready, long timeout) {
+    // Bytes which arrived before the wait was started do not signal EV_RXCHAR, so start it
+    // first and then check the input queue, only waiting when it is empty
+    this->wait_handles.assign(1, this->interrupt_event);
+    this->wait_entries.assign(1, (PortEntry*)NULL);
+    for(std::size_t i = 0; i < this->entries.size(); ++i) {
+        PortEntry& entry = *this->entries[i];
+        if(!entry.open)
+            continue;
+        HANDLE handle = reinterpret_cast<HANDLE>(entry.handle);
+        if(!entry.pending) {
+            if(!::SetCommMask(handle, EV_RXCHAR)) {
+                this->mark_ready(entry, ready); // Let the read report the error
+                continue;
+            }
+            // The low bit keeps the completion off the port's I/O completion port
+            ::ZeroMemory(&entry.overlapped, sizeof(entry.overlapped));
+            ::ResetEvent(entry.event);
+            entry.overlapped.hEvent = reinterpret_cast<HANDLE>(reinterpret_cast<DWORD_PTR>(entry.event) | 1);
+            if(::WaitCommEvent(handle, &entry.events, &entry.overlapped) ||
+               ::GetLastError() != ERROR_IO_PENDING) {
+                this->mark_ready(entry, ready);
+                continue;
+            }
+            entry.pending = true;
+        }
+        if(has_input(handle)) {
+            this->mark_ready(entry, ready);
+            continue;
+        }
+        this->wait_handles.push_back(entry.event);
+        this->wait_entries.push_back(&entry);
+    }
+    if(!ready.empty())
+        timeout = 0;
+    
+    DWORD result = ::WaitForMultipleObjects(DWORD(this->wait_handles.size()), &this->wait_handles[0],
+                                            FALSE, timeout < 0 ? INFINITE : DWORD(timeout));
+    if(result == WAIT_FAILED)
+        throw_last_error("WaitForMultipleObjects");
+    if(result == WAIT_TIMEOUT || result == WAIT_OBJECT_0)
+        return ready.size();
+    
+    // More than one wait may have completed, collect all of them
+    for(std::size_t i = 1; i < this->wait_entries.size(); ++i) {
+        PortEntry& entry = *this->wait_entries[i];
+        if(!HasOverlappedIoCompleted(&entry.overlapped))
+            continue;
+        entry.pending = false;
+        if(has_input(reinterpret_cast<HANDLE>(entry.handle)))
+            this->mark_ready(entry, ready);
+    }
+    return ready.size();
+}
+
+void SerialSelector::SelectorImpl::interrupt() {
+    ::SetEvent(this->interrupt_event);
+}
+
+#elif defined(__linux__)
+
+SerialSelector::SelectorImpl::SelectorImpl() {
+    int epoll_fd = ::epoll_create1(EPOLL_CLOEXEC);
+    if(epoll_fd < 0)
+        throw_last_error("epoll_create1");
+    this->epoll_set.reset(new EpollSet(epoll_fd));
+    this->interrupt_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if(this->interrupt_fd < 0)
+        throw_last_error("eventfd");
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.ptr = NULL;
+    if(::epoll_ctl(this->epoll_set->fd, EPOLL_CTL_ADD, this->interrupt_fd, &event) < 0) {
+        ::close(this->interrupt_fd);
+        throw_last_error("epoll_ctl");
+    }
+}
+
+void SerialSelector::SelectorImpl::update(PortEntry& entry) {
+    intptr_t handle = 0;
+    unsigned long generation = 0;
+    bool open = entry.serial->getSelectHandle(handle, generation);
+    if(open == entry.open && handle == entry.handle && generation == entry.generation)
+        return;
+    
+    // The port took the old descriptor out of the epoll set before closing or replacing it,
+    // and its number may belong to another registered port by now, so it is not touched
+    entry.registered = false;
+    entry.open = open;
+    entry.handle = handle;
+    entry.generation = generation;
+    if(!open)
+        return;
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.ptr = &entry;
+    if(::epoll_ctl(this->epoll_set->fd, EPOLL_CTL_ADD, int(handle), &event) < 0 &&
+       (errno != EEXIST || ::epoll_ctl(this->epoll_set->fd, EPOLL_CTL_MOD, int(handle), &event) < 0))
+        throw_last_error("epoll_ctl");
+    entry.registered = true;
+}
+
+void SerialSelector::SelectorImpl::release(PortEntry& entry) {
+    if(entry.registered && entry.serial->getSelectHandle(entry.handle, entry.generation))
+        ::epoll_ctl(this->epoll_set->fd, EPOLL_CTL_DEL, int(entry.handle), NULL);
+    entry.registered = false;
+}
+
+std::size_t SerialSelector::SelectorImpl::wait(std::vector<Serial*>& ready, long timeout) {
+    this->events.resize(this->entries.size() + 1);
+    int count = ::epoll_wait(this->epoll_set->fd, &this->events[0], int(this->events.size()),
+                             timeout < 0 ? -1 : int(timeout));
+    if(count < 0) {
+        if(errno == EINTR)
+            return ready.size();
+        throw_last_error("epoll_wait");
+    }
+    for(int i = 0; i < count; ++i) {
+        PortEntry* entry = static_cast<PortEntry*>(this->events[i].data.ptr);
+        if(entry != NULL) {
+            this->mark_ready(*entry, ready);
+        } else {
+            uint64_t value;
+            ssize_t result = ::read(this->interrupt_fd, &value, sizeof(value));
+            (void)result;
+        }
+    }
+    return ready.size();
+}
+
+void SerialSelector::SelectorImpl::interrupt() {
+    uint64_t value = 1;
+    ssize_t result = ::write(this->interrupt_fd, &value, sizeof(value));
+    (void)result;
+}
+
+#else
+
+SerialSelector::SelectorImpl::SelectorImpl() {
+    if(::pipe(this->interrupt_pipe) < 0)
+        throw_last_error("pipe");
+    for(int i = 0; i < 2; ++i) {
+        ::fcntl(this->interrupt_pipe[i], F_SETFL, ::fcntl(this->interrupt_pipe[i], F_GETFL) | O_NONBLOCK);
+        ::fcntl(this->interrupt_pipe[i], F_SETFD, FD_CLOEXEC);
+    }
+}
+
+void SerialSelector::SelectorImpl::update(PortEntry& entry) {
+    entry.open = entry.serial->getSelectHandle(entry.handle, entry.generation);
+}
+
+void SerialSelector::SelectorImpl::release(PortEntry& entry) {
+    (void)entry;
+}
+
+std::size_t SerialSelector::SelectorImpl::wait(std::vector<Serial*>& ready, long timeout) {
+    // kqueue does not report tty devices on every system (see BOOST_ASIO_DISABLE_KQUEUE),
+    // so the descriptors are polled
+    this->pollfds.resize(1);
+    this->pollfds[0].fd = this->interrupt_pipe[0];
+    this->pollfds[0].events = POLLIN;
+    this->poll_entries.assign(1, (PortEntry*)NULL);
+    for(std::size_t i = 0; i < this->entries.size(); ++i) {
+        if(!this->entries[i]->open)
+            continue;
+        struct pollfd pfd;
+        pfd.fd = int(this->entries[i]->handle);
+        pfd.events = POLLIN;
+        this->pollfds.push_back(pfd);
+        this->poll_entries.push_back(this->entries[i]);
+    }
+    for(std::size_t i = 0; i < this->pollfds.size(); ++i)
+        this->pollfds[i].revents = 0;
+    
+    int count = ::poll(&this->pollfds[0], nfds_t(this->pollfds.size()), timeout < 0 ? -1 : int(timeout));
+    if(count < 0) {
+        if(errno == EINTR)
+            return ready.size();
+        throw_last_error("poll");
+    }
+    if(this->pollfds[0].revents != 0) {
+        char buffer[64];
+        while(::read(this->interrupt_pipe[0], buffer, sizeof(buffer)) > 0) {}
+    }
+    for(std::size_t i = 1; i < this->pollfds.size(); ++i) {
+        if(this->pollfds[i].revents != 0)
+            this->mark_ready(*this->poll_entries[i], ready);
+    }
+    return ready.size();
+}
+
+void SerialSelector::SelectorImpl::interrupt() {
+    char byte = 0;
+    ssize_t result = ::write(this->interrupt_pipe[1], &byte, 1);
+    (void)result;
+}
+
+#endif
+
+/** Serial Selector Class **/
+
+SerialSelector::SerialSelector() : pimpl(new SelectorImpl()) {}
+
+SerialSelector::~SerialSelector() {}
+
+void SerialSelector::add(Serial& serial) {
+    this->pimpl->add(serial);
+}
+
+void SerialSelector::remove(Serial& serial) {
+    this->pimpl->remove(serial);
+}
+
+size_t SerialSelector::size() const {
+    return this->pimpl->size();
+}
+
+size_t SerialSelector::select(std::vector<Serial*>& ready, long timeout) {
+    return this->pimpl->select(ready, timeout);
+}
+
+void SerialSelector::interrupt() {
+    this->pimpl->interrupt();
+}
@@ -0,0 +1,145 @@
+#include "serial/serial.h"
+
+#include <algorithm>
+
+#include <boost/asio/buffer.hpp>
+
+#include "read_buffer.h"
+
+using namespace serial;
+
+std::string SerialStream::read(int size) {
+    std::string return_str;
+    this->read(return_str, std::size_t(std::max(size, 0)));
+    return return_str;
+}
+
+size_t SerialStream::read(uint8_t* buffer, size_t size) {
+    return this->read(reinterpret_cast<char*>(buffer), int(size));
+}
+
+size_t SerialStream::read(std::vector<uint8_t>& buffer, size_t size) {
+    buffer.resize(size);
+    if(size == 0)
+        return 0;
+    int bytes_read_ = this->read(reinterpret_cast<char*>(&buffer[0]), int(size));
+    buffer.resize(bytes_read_);
+    return bytes_read_;
+}
+
+size_t SerialStream::read(std::string& buffer, size_t size) {
+    buffer.resize(size);
+    if(size == 0)
+        return 0;
+    int bytes_read_ = this->read(&buffer[0], int(size));
+    buffer.resize(bytes_read_);
+    return bytes_read_;
+}
+
+size_t SerialStream::read(PooledBuffer& buffer, size_t size) {
+    PooledBuffer buffer_ = ReadBuffer::acquire(this->getBufferPool());
+    size = std::min(size, buffer_.capacity());
+    buffer_.resize(size > 0 ? std::size_t(this->read(buffer_.data(), int(size))) : 0);
+    buffer = buffer_;
+    return buffer.size();
+}
+
+std::string SerialStream::read_until(char delim, size_t size) {
+    return this->read_until(std::string(1, delim), size);
+}
+
+bool SerialStream::read_frame(std::string& frame) {
+    const char *frame_ = NULL;
+    std::size_t size = 0;
+    if(!this->read_frame(frame_, size))
+        return false;
+    frame.assign(frame_, size);
+    return true;
+}
+
+int SerialStream::write(const std::string& data) {
+    return this->write(data.data(), int(data.length()));
+}
+
+size_t SerialStream::write(const uint8_t* data, size_t length) {
+    return this->write(reinterpret_cast<const char*>(data), int(length));
+}
+
+size_t SerialStream::write(const std::vector<uint8_t>& data) {
+    if(data.empty())
+        return 0;
+    return this->write(&data[0], data.size());
+}
+
+bool SerialStream::transact(const std::string& request, std::string& response, const ResponseMatch& match) {
+    if(match.kind == ResponseMatch::FRAME)
+        this->write_frame(request.data(), request.size());
+    else
+        this->write(request.data(), int(request.size()));
+    return this->read_response(response, match);
+}
+
+size_t SerialStream::transact(const std::vector<std::string>& requests, std::vector<std::string>& responses,
+                              const ResponseMatch& match, size_t depth) {
+    responses.resize(requests.size());
+    
+    // Fill the pipeline with one write, then send a request for each response received
+    std::size_t sent = std::min(std::max(depth, std::size_t(1)), requests.size());
+    this->write_requests(requests, 0, sent, match);
+    std::size_t received = 0;
+    while(received < requests.size()) {
+        if(!this->read_response(responses[received], match))
+            break;
+        ++received;
+        if(sent < requests.size()) {
+            this->write_requests(requests, sent, sent + 1, match);
+            ++sent;
+        }
+    }
+    responses.resize(received);
+    return received;
+}
+
+void SerialStream::write_requests(const std::vector<std::string>& requests, size_t begin, size_t end,
+                                  const ResponseMatch& match) {
+    if(begin == end)
+        return;
+    if(match.kind == ResponseMatch::FRAME) {
+        for(std::size_t i = begin; i < end; ++i)
+            this->write_frame(requests[i].data(), requests[i].size());
+    } else if(end - begin == 1) {
+        this->write(requests[begin].data(), int(requests[begin].size()));
+    } else {
+        std::vector<boost::asio::const_buffer> buffers;
+        buffers.reserve(end - begin);
+        for(std::size_t i = begin; i < end; ++i)
+            buffers.push_back(boost::asio::buffer(requests[i]));
+        this->write(buffers);
+    }
+}
+
+bool SerialStream::read_response(std::string& response, const ResponseMatch& match) {
+    switch(match.kind) {
+        case ResponseMatch::LENGTH: {
+            response.resize(match.size);
+            int bytes_read_ = match.size > 0 ? this->read(&response[0], int(match.size)) : 0;
+            response.resize(bytes_read_);
+            return response.size() == match.size;
+        }
+        case ResponseMatch::DELIMITER:
+            response = this->read_until(match.delim, match.size);
+            return response.size() >= match.delim.size() &&
+                   response.compare(response.size() - match.delim.size(), match.delim.size(), match.delim) == 0;
+        case ResponseMatch::FRAME: {
+            const char *frame = NULL;
+            std::size_t size = 0;
+            if(!this->read_frame(frame, size)) {
+                response.clear();
+                return false;
+            }
+            response.assign(frame, size);
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,225 @@
+#include "win_serial_port.h"
+
+using namespace serial;
+
+static boost::system::error_code last_error() {
+    return boost::system::error_code(::GetLastError(), boost::system::system_category());
+}
+
+// Setting the low bit of the event keeps the completion off the I/O completion port
+static HANDLE private_event(HANDLE event) {
+    return reinterpret_cast<HANDLE>(reinterpret_cast<DWORD_PTR>(event) | 1);
+}
+
+WinSerialPort::WinSerialPort(const std::string& device)
+    : handle(INVALID_HANDLE_VALUE), read_event(NULL), write_event(NULL), wait_event(NULL) {
+    // Ports above COM9 can only be opened through the device namespace
+    std::string name = device;
+    if(name.compare(0, 4, "\\\\.\\") != 0)
+        name = "\\\\.\\" + name;
+    this->handle = ::CreateFileA(name.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL,
+                                 OPEN_EXISTING, FILE_FLAG_OVERLAPPED, NULL);
+    if(this->handle == INVALID_HANDLE_VALUE)
+        boost::asio::detail::throw_error(last_error(), "open");
+    
+    try {
+        this->read_event = ::CreateEvent(NULL, TRUE, FALSE, NULL);
+        this->write_event = ::CreateEvent(NULL, TRUE, FALSE, NULL);
+        this->wait_event = ::CreateEvent(NULL, TRUE, FALSE, NULL);
+        if(this->read_event == NULL || this->write_event == NULL || this->wait_event == NULL)
+            boost::asio::detail::throw_error(last_error(), "CreateEvent");
+        
+        // Binary mode with error aborts off, the same settings boost::asio::serial_port starts from
+        DCB storage;
+        this->get_state(storage);
+        storage.fBinary = TRUE;
+        storage.fDsrSensitivity = FALSE;
+        storage.fNull = FALSE;
+        storage.fAbortOnError = FALSE;
+        this->set_state(storage);
+        
+        // Return as soon as one byte arrives, how long to wait for it is decided by read(). These
+        // are shared with the asynchronous operations, so zero byte reads must not be possible.
+        COMMTIMEOUTS timeouts;
+        ::ZeroMemory(&timeouts, sizeof(timeouts));
+        timeouts.ReadIntervalTimeout = MAXDWORD;
+        timeouts.ReadTotalTimeoutMultiplier = MAXDWORD;
+        timeouts.ReadTotalTimeoutConstant = MAXDWORD - 1;
+        if(!::SetCommTimeouts(this->handle, &timeouts))
+            boost::asio::detail::throw_error(last_error(), "SetCommTimeouts");
+    } catch(...) {
+        this->close();
+        throw;
+    }
+}
+
+WinSerialPort::~WinSerialPort() {
+    this->close();
+}
+
+bool WinSerialPort::is_open() const {
+    return this->handle != INVALID_HANDLE_VALUE;
+}
+
+void WinSerialPort::close() {
+    // The stream owns a duplicate of the handle, closing it cancels its operations
+    this->stream.reset();
+    if(this->handle != INVALID_HANDLE_VALUE) {
+        ::CloseHandle(this->handle);
+        this->handle = INVALID_HANDLE_VALUE;
+    }
+    if(this->read_event != NULL) {
+        ::CloseHandle(this->read_event);
+        this->read_event = NULL;
+    }
+    if(this->write_event != NULL) {
+        ::CloseHandle(this->write_event);
+        this->write_event = NULL;
+    }
+    if(this->wait_event != NULL) {
+        ::CloseHandle(this->wait_event);
+        this->wait_event = NULL;
+    }
+}
+
+void WinSerialPort::cancel() {
+    if(this->stream)
+        this->stream->cancel();
+}
+
+WinSerialPort::native_handle_type WinSerialPort::native_handle() {
+    return this->handle;
+}
+
+void WinSerialPort::get_state(DCB& storage) {
+    ::ZeroMemory(&storage, sizeof(storage));
+    storage.DCBlength = sizeof(storage);
+    if(!::GetCommState(this->handle, &storage))
+        boost::asio::detail::throw_error(last_error(), "GetCommState");
+}
+
+void WinSerialPort::set_state(const DCB& storage) {
+    if(!::SetCommState(this->handle, const_cast<DCB*>(&storage)))
+        boost::asio::detail::throw_error(last_error(), "SetCommState");
+}
+
+std::size_t WinSerialPort::read(char* buffer, std::size_t size, DWORD timeout, boost::system::error_code& ec) {
+    ec = boost::system::error_code();
+    if(timeout == 0) {
+        // Asking the driver is cheaper than starting a read and canceling it
+        COMSTAT status;
+        DWORD errors = 0;
+        if(!::ClearCommError(this->handle, &errors, &status)) {
+            ec = last_error();
+            return 0;
+        }
+        if(status.cbInQue == 0)
+            return 0;
+        if(size > status.cbInQue)
+            size = status.cbInQue;
+    }
+    
+    OVERLAPPED overlapped;
+    ::ZeroMemory(&overlapped, sizeof(overlapped));
+    overlapped.hEvent = private_event(this->read_event);
+    ::ResetEvent(this->read_event);
+    
+    DWORD bytes_read = 0;
+    if(!::ReadFile(this->handle, buffer, DWORD(size), &bytes_read, &overlapped)) {
+        if(::GetLastError() != ERROR_IO_PENDING) {
+            ec = last_error();
+            return 0;
+        }
+        if(::WaitForSingleObject(this->read_event, timeout) == WAIT_TIMEOUT)
+            ::CancelIoEx(this->handle, &overlapped);
+        // A canceled read still reports the bytes it received
+        if(!::GetOverlappedResult(this->handle, &overlapped, &bytes_read, TRUE) &&
+           ::GetLastError() != ERROR_OPERATION_ABORTED)
+            ec = last_error();
+    }
+    return bytes_read;
+}
+
+bool WinSerialPort::wait_readable(DWORD timeout, boost::system::error_code& ec) {
+    ec = boost::system::error_code();
+    DWORD start = ::GetTickCount();
+    while(true) {
+        DWORD elapsed = ::GetTickCount() - start;
+        DWORD remaining = timeout == INFINITE ? INFINITE : (elapsed < timeout ? timeout - elapsed : 0);
+        
+        // Bytes which arrived before the wait was started do not signal EV_RXCHAR, so start it
+        // first and then check the input queue, only waiting when it is empty
+        if(!::SetCommMask(this->handle, EV_RXCHAR)) {
+            ec = last_error();
+            return false;
+        }
+        OVERLAPPED overlapped;
+        ::ZeroMemory(&overlapped, sizeof(overlapped));
+        overlapped.hEvent = private_event(this->wait_event);
+        ::ResetEvent(this->wait_event);
+        DWORD events = 0;
+        bool pending = false;
+        if(!::WaitCommEvent(this->handle, &events, &overlapped)) {
+            if(::GetLastError() != ERROR_IO_PENDING) {
+                ec = last_error();
+                return false;
+            }
+            pending = true;
+        }
+        
+        COMSTAT status;
+        DWORD errors = 0;
+        bool ready = false;
+        if(!::ClearCommError(this->handle, &errors, &status))
+            ec = last_error();
+        else
+            ready = status.cbInQue > 0;
+        if(pending) {
+            if(!ready && !ec && remaining > 0)
+                ::WaitForSingleObject(this->wait_event, remaining);
+            // The OVERLAPPED must not go out of scope while the wait can still complete into it
+            if(!HasOverlappedIoCompleted(&overlapped))
+                ::CancelIoEx(this->handle, &overlapped);
+            DWORD transferred = 0;
+            ::GetOverlappedResult(this->handle, &overlapped, &transferred, TRUE);
+        }
+        
+        // An event with no data left, or a wait ended by another change of the mask, checks
+        // the input queue again
+        if(ready || ec || remaining == 0)
+            return ready;
+    }
+}
+
+std::size_t WinSerialPort::write(const char* data, std::size_t size, boost::system::error_code& ec) {
+    ec = boost::system::error_code();
+    if(size == 0)
+        return 0;
+    OVERLAPPED overlapped;
+    ::ZeroMemory(&overlapped, sizeof(overlapped));
+    overlapped.hEvent = private_event(this->write_event);
+    ::ResetEvent(this->write_event);
+    
+    DWORD bytes_written = 0;
+    if(!::WriteFile(this->handle, data, DWORD(size), &bytes_written, &overlapped)) {
+        if(::GetLastError() != ERROR_IO_PENDING) {
+            ec = last_error();
+            return 0;
+        }
+        if(!::GetOverlappedResult(this->handle, &overlapped, &bytes_written, TRUE))
+            ec = last_error();
+    }
+    return bytes_written;
+}
+
+boost::asio::windows::stream_handle& WinSerialPort::async_stream(boost::asio::io_service& io_service) {
+    if(!this->stream) {
+        // Completion port association belongs to the file object, so the duplicate shares it
+        HANDLE duplicate = INVALID_HANDLE_VALUE;
+        HANDLE process = ::GetCurrentProcess();
+        if(!::DuplicateHandle(process, this->handle, process, &duplicate, 0, FALSE, DUPLICATE_SAME_ACCESS))
+            boost::asio::detail::throw_error(last_error(), "DuplicateHandle");
+        this->stream.reset(new boost::asio::windows::stream_handle(io_service, duplicate));
+    }
+    return *this->stream;
+}
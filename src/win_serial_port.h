@@ -0,0 +1,117 @@
+#ifndef SERIAL_WIN_SERIAL_PORT_H
+#define SERIAL_WIN_SERIAL_PORT_H
+
+#include <string>
+
+#include <boost/asio.hpp>
+#include <boost/asio/windows/stream_handle.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <windows.h>
+
+namespace serial {
+
+/** A Windows serial port which is read and written with overlapped I/O on its handle.
+* 
+* It provides the part of the boost::asio::serial_port interface used by Serial, so it can
+* stand in for it on Windows. Synchronous reads and writes wait on an event of their own,
+* which is marked so that they are never posted to the io_service's completion port, and
+* COMMTIMEOUTS make every read return as soon as any data is available instead of waiting
+* for the whole buffer. Asynchronous operations go through a stream_handle on a duplicate of
+* the handle, which boost::asio completes on its I/O completion port, so many ports can be
+* served by a few threads running one io_service.
+*/
+class WinSerialPort {
+public:
+    typedef HANDLE native_handle_type;
+    
+    /** Opens the device for overlapped I/O, e.g. "COM1" or "\\\\.\\COM10".
+    * 
+    * @throw boost::system::system_error
+    */
+    explicit WinSerialPort(const std::string& device);
+    
+    /** Destructor, closes the port. */
+    ~WinSerialPort();
+    
+    bool is_open() const;
+    
+    void close();
+    
+    /** Cancels outstanding asynchronous operations, if any were started. */
+    void cancel();
+    
+    native_handle_type native_handle();
+    
+    /** Applies one of the boost::asio::serial_port_base options with a single SetCommState().
+    * 
+    * @throw boost::system::system_error
+    */
+    template <typename SettableSerialPortOption>
+    void set_option(const SettableSerialPortOption& option) {
+        DCB storage;
+        boost::system::error_code ec;
+        this->get_state(storage);
+        option.store(storage, ec);
+        boost::asio::detail::throw_error(ec, "set_option");
+        this->set_state(storage);
+    }
+    
+    /** Reads up to size bytes, waiting at most timeout milliseconds (or INFINITE) for the
+    * first one. A read which times out is canceled and returns the bytes it received, with
+    * a timeout of zero only the bytes already buffered are read. */
+    std::size_t read(char* buffer, std::size_t size, DWORD timeout, boost::system::error_code& ec);
+    
+    /** Waits at most timeout milliseconds (or INFINITE) for data to arrive, without reading
+    * it, with an overlapped WaitCommEvent for EV_RXCHAR. This sets the port's event mask, so
+    * it ends a wait for modem line changes or by a SerialSelector, which must start again. */
+    bool wait_readable(DWORD timeout, boost::system::error_code& ec);
+    
+    /** Gets a stream_handle on the port for asynchronous operations, creating it on the
+    * given io_service the first time this is called. */
+    boost::asio::windows::stream_handle& async_stream(boost::asio::io_service& io_service);
+    
+    /** Writes the first non-empty buffer and waits for the write to complete.
+    * Used by boost::asio::write(). */
+    template <typename ConstBufferSequence>
+    std::size_t write_some(const ConstBufferSequence& buffers, boost::system::error_code& ec) {
+        boost::asio::const_buffer buffer = first_buffer(boost::asio::buffer_sequence_begin(buffers),
+                                                        boost::asio::buffer_sequence_end(buffers));
+        return this->write(static_cast<const char*>(buffer.data()), buffer.size(), ec);
+    }
+    
+    template <typename ConstBufferSequence>
+    std::size_t write_some(const ConstBufferSequence& buffers) {
+        boost::system::error_code ec;
+        std::size_t bytes_written = this->write_some(buffers, ec);
+        boost::asio::detail::throw_error(ec, "write_some");
+        return bytes_written;
+    }
+private:
+    WinSerialPort(const WinSerialPort&);
+    void operator=(const WinSerialPort&);
+    
+    template <typename Iterator>
+    static boost::asio::const_buffer first_buffer(Iterator begin, Iterator end) {
+        for(; begin != end; ++begin) {
+            boost::asio::const_buffer buffer(*begin);
+            if(buffer.size() > 0)
+                return buffer;
+        }
+        return boost::asio::const_buffer();
+    }
+    
+    void get_state(DCB& storage);
+    void set_state(const DCB& storage);
+    std::size_t write(const char* data, std::size_t size, boost::system::error_code& ec);
+    
+    HANDLE handle;
+    HANDLE read_event;
+    HANDLE write_event;
+    HANDLE wait_event;
+    boost::scoped_ptr<boost::asio::windows::stream_handle> stream;
+};
+
+} // namespace serial
+
+#endif
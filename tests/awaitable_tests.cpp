@@ -0,0 +1,214 @@
+/**
+ * Tests the coroutine interface of awaitable.h over a pseudo terminal pair, the Serial port
+ * opens the slave side and the tests drive the master side directly.
+ * 
+ * It is built as C++20 on its own, since the rest of the library and tests need not be.
+ */
+
+#define BOOST_TEST_MODULE serial_awaitable_tests
+#include <boost/test/included/unit_test.hpp>
+
+#include <algorithm>
+#include <string>
+
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+#if defined(__APPLE__)
+# include <util.h>
+#else
+# include <pty.h>
+#endif
+
+#include <boost/asio.hpp>
+#include <boost/thread.hpp>
+
+#include "serial/awaitable.h"
+#include "serial/serial.h"
+
+using namespace serial;
+
+// A coroutine which starts at once and cleans up after itself. Exceptions it does not catch
+// are thrown from whatever resumed it, which is the test or the io_service it runs.
+struct Task {
+    struct promise_type {
+        Task get_return_object() {
+            return Task();
+        }
+        
+        std::suspend_never initial_suspend() noexcept {
+            return std::suspend_never();
+        }
+        
+        std::suspend_never final_suspend() noexcept {
+            return std::suspend_never();
+        }
+        
+        void return_void() {}
+        
+        void unhandled_exception() {
+            throw;
+        }
+    };
+};
+
+struct PtyPort {
+    PtyPort() {
+        char name[256];
+        BOOST_REQUIRE(openpty(&this->master, &this->slave, name, NULL, NULL) == 0);
+        struct termios tio;
+        tcgetattr(this->master, &tio);
+        cfmakeraw(&tio);
+        tcsetattr(this->master, TCSANOW, &tio);
+        this->port.setPort(name);
+        this->port.setBaudrate(115200);
+        this->port.open();
+    }
+    
+    ~PtyPort() {
+        this->port.close();
+        ::close(this->master);
+        ::close(this->slave);
+    }
+    
+    void send(const std::string& data) {
+        BOOST_REQUIRE_EQUAL(::write(this->master, data.data(), data.size()), ssize_t(data.size()));
+    }
+    
+    std::string receive(std::size_t size) {
+        std::string data;
+        char buffer[256];
+        while(data.size() < size) {
+            ssize_t result = ::read(this->master, buffer, std::min(sizeof(buffer), size - data.size()));
+            if(result <= 0)
+                break;
+            data.append(buffer, std::size_t(result));
+        }
+        return data;
+    }
+    
+    // Runs handlers on the port's io_service until the coroutine is done, run() would not
+    // return since the port keeps its own io_service busy
+    void run(const bool& done) {
+        boost::asio::io_service& io_service = this->port.getIoService();
+        io_service.restart();
+        while(!done)
+            io_service.run_one();
+    }
+    
+    int master;
+    int slave;
+    Serial port;
+};
+
+static Task read_and_write(Serial& port, bool& done) {
+    char buffer[5];
+    BOOST_CHECK_EQUAL(co_await co_read(port, buffer, sizeof(buffer)), sizeof(buffer));
+    BOOST_CHECK_EQUAL(std::string(buffer, sizeof(buffer)), "hello");
+    BOOST_CHECK_EQUAL(co_await co_read_until(port, "\n"), " world\n");
+    BOOST_CHECK_EQUAL(co_await co_write(port, "ping\n", 5), 5u);
+    done = true;
+}
+
+static Task read_line(Serial& port, std::string& line, bool& done) {
+    line = co_await co_read_until(port, "\n");
+    done = true;
+}
+
+static Task transact(Serial& port, bool& done) {
+    BOOST_CHECK_EQUAL(co_await co_transact(port, "ping\n", ResponseMatch::delimiter("\n")), "pong\n");
+    BOOST_CHECK_EQUAL(co_await co_transact(port, "stat", ResponseMatch::length(8)), "12345678");
+    done = true;
+}
+
+static Task transact_frame(Serial& port, boost::system::error_code* ec, bool& done) {
+    if(ec != NULL)
+        co_await co_transact(port, "frame", ResponseMatch::frame(), *ec);
+    else
+        co_await co_transact(port, "frame", ResponseMatch::frame());
+    done = true;
+}
+
+static Task read_canceled(Serial& port, boost::system::error_code& ec, bool& done) {
+    char buffer[4];
+    co_await co_read(port, buffer, sizeof(buffer), ec);
+    done = true;
+}
+
+// Answers a line with "pong\n" and then 4 bytes with 8
+static void responder(PtyPort* pty) {
+    if(pty->receive(5) == "ping\n")
+        pty->send("pong\n");
+    if(pty->receive(4) == "stat")
+        pty->send("12345678");
+}
+
+BOOST_AUTO_TEST_SUITE(awaitable)
+
+BOOST_AUTO_TEST_CASE(read_write) {
+    PtyPort pty;
+    pty.send("hello world\n");
+    bool done = false;
+    read_and_write(pty.port, done);
+    BOOST_CHECK(!done); // Waiting for the io_service
+    pty.run(done);
+    BOOST_CHECK(done);
+    BOOST_CHECK_EQUAL(pty.receive(5), "ping\n");
+}
+
+BOOST_AUTO_TEST_CASE(complete_before_suspending) {
+    PtyPort pty;
+    pty.send("one\ntwo\n");
+    boost::this_thread::sleep(boost::posix_time::milliseconds(50));
+    
+    // The first read takes both lines from the port, so the second one is already buffered
+    // and resumes without the io_service being run
+    std::string line;
+    bool done = false;
+    read_line(pty.port, line, done);
+    pty.run(done);
+    BOOST_REQUIRE(done);
+    BOOST_CHECK_EQUAL(line, "one\n");
+    BOOST_CHECK_EQUAL(pty.port.available(), 4u);
+    
+    done = false;
+    read_line(pty.port, line, done);
+    BOOST_CHECK(done);
+    BOOST_CHECK_EQUAL(line, "two\n");
+    
+    // Frames can not be awaited, which fails before anything is started
+    boost::system::error_code ec;
+    done = false;
+    transact_frame(pty.port, &ec, done);
+    BOOST_CHECK(done);
+    BOOST_CHECK(ec == boost::asio::error::operation_not_supported);
+    done = false;
+    BOOST_CHECK_THROW(transact_frame(pty.port, NULL, done), boost::system::system_error);
+    BOOST_CHECK(!done);
+}
+
+BOOST_AUTO_TEST_CASE(transact_exchanges) {
+    PtyPort pty;
+    boost::thread thread(responder, &pty);
+    bool done = false;
+    transact(pty.port, done);
+    pty.run(done);
+    thread.join();
+    BOOST_CHECK(done);
+}
+
+BOOST_AUTO_TEST_CASE(cancel) {
+    PtyPort pty;
+    boost::system::error_code ec;
+    bool done = false;
+    read_canceled(pty.port, ec, done);
+    
+    // Cancel from the io_service, like any other use of the port while a read is outstanding
+    boost::asio::deadline_timer timer(pty.port.getIoService(), boost::posix_time::milliseconds(50));
+    timer.async_wait([&pty](const boost::system::error_code&) { pty.port.cancel(); });
+    pty.run(done);
+    BOOST_CHECK(done);
+    BOOST_CHECK(ec == boost::asio::error::operation_aborted);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
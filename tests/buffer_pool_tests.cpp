@@ -0,0 +1,99 @@
+/**
+ * Tests that a BufferPool hands out each buffer once, reports when it is exhausted, and gets
+ * its buffers back when the last handle to them is released.
+ */
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "serial/buffer_pool.h"
+
+using namespace serial;
+
+BOOST_AUTO_TEST_SUITE(buffer_pool)
+
+BOOST_AUTO_TEST_CASE(exhaustion_and_release) {
+    BufferPool pool(64, 3);
+    BOOST_CHECK_EQUAL(pool.getBufferSize(), 64u);
+    BOOST_CHECK_EQUAL(pool.getCount(), 3u);
+    BOOST_CHECK_EQUAL(pool.available(), 3u);
+    
+    std::vector<PooledBuffer> buffers;
+    for(int i = 0; i < 3; ++i) {
+        buffers.push_back(pool.acquire());
+        BOOST_REQUIRE(buffers.back().isValid());
+        BOOST_CHECK_EQUAL(buffers.back().size(), 0u);
+        BOOST_CHECK_EQUAL(buffers.back().capacity(), 64u);
+    }
+    BOOST_CHECK_EQUAL(pool.available(), 0u);
+    BOOST_CHECK(buffers[0].data() != buffers[1].data());
+    BOOST_CHECK(buffers[1].data() != buffers[2].data());
+    BOOST_CHECK(buffers[0].data() != buffers[2].data());
+    
+    PooledBuffer exhausted = pool.acquire();
+    BOOST_CHECK(!exhausted.isValid());
+    BOOST_CHECK(exhausted.data() == NULL);
+    BOOST_CHECK_EQUAL(exhausted.size(), 0u);
+    BOOST_CHECK_EQUAL(exhausted.capacity(), 0u);
+    
+    char *released = buffers[1].data();
+    buffers[1].release();
+    BOOST_CHECK(!buffers[1].isValid());
+    BOOST_CHECK_EQUAL(pool.available(), 1u);
+    
+    PooledBuffer again = pool.acquire();
+    BOOST_REQUIRE(again.isValid());
+    BOOST_CHECK(again.data() == released);
+    BOOST_CHECK_EQUAL(pool.available(), 0u);
+    
+    buffers.clear();
+    again.release();
+    BOOST_CHECK_EQUAL(pool.available(), 3u);
+}
+
+BOOST_AUTO_TEST_CASE(copies_share_the_buffer) {
+    BufferPool pool(16, 1);
+    PooledBuffer buffer = pool.acquire();
+    std::memcpy(buffer.data(), "frame", 5);
+    buffer.resize(5);
+    
+    PooledBuffer copy(buffer);
+    PooledBuffer assigned;
+    assigned = buffer;
+    BOOST_CHECK(copy.data() == buffer.data());
+    BOOST_CHECK(assigned.data() == buffer.data());
+    BOOST_CHECK_EQUAL(copy.size(), 5u);
+    
+    // The buffer only goes back once every handle is gone
+    buffer.release();
+    copy.release();
+    BOOST_CHECK_EQUAL(pool.available(), 0u);
+    BOOST_CHECK_EQUAL(std::string(assigned.data(), assigned.size()), "frame");
+    assigned = assigned; // Self assignment keeps the reference
+    BOOST_CHECK(assigned.isValid());
+    assigned.release();
+    BOOST_CHECK_EQUAL(pool.available(), 1u);
+    
+    // A buffer which comes back is empty again
+    PooledBuffer reused = pool.acquire();
+    BOOST_REQUIRE(reused.isValid());
+    BOOST_CHECK_EQUAL(reused.size(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(outlives_the_pool) {
+    PooledBuffer buffer;
+    {
+        BufferPool pool(8, 2);
+        buffer = pool.acquire();
+    }
+    BOOST_REQUIRE(buffer.isValid());
+    std::memcpy(buffer.data(), "12345678", 8);
+    buffer.resize(8);
+    BOOST_CHECK_EQUAL(buffer.size(), 8u);
+    buffer.release();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
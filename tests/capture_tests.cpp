@@ -0,0 +1,315 @@
+/**
+ * Tests that CaptureLog and CaptureReader round trip records, that a reader stops cleanly at
+ * the end of a file which was cut short or never closed, and that ReplaySerial replays a
+ * capture through reads, read_until and read_frame.
+ */
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "serial/capture.h"
+#include "serial/checksum.h"
+#include "serial/framer.h"
+#include "serial/replay_serial.h"
+
+using namespace serial;
+
+// A capture file in the working directory, removed again at the end of the test
+struct CaptureFile {
+    CaptureFile() {
+        static int files = 0;
+        std::ostringstream path;
+        path << "serial_tests_capture_" << files++ << ".bin";
+        this->path = path.str();
+    }
+    
+    ~CaptureFile() {
+        std::remove(this->path.c_str());
+    }
+    
+    std::string contents() const {
+        std::ifstream file(this->path.c_str(), std::ios::binary);
+        std::ostringstream contents;
+        contents << file.rdbuf();
+        return contents.str();
+    }
+    
+    void replace(const std::string& contents) const {
+        std::ofstream file(this->path.c_str(), std::ios::binary | std::ios::trunc);
+        file.write(contents.data(), std::streamsize(contents.size()));
+    }
+    
+    std::string path;
+};
+
+static bool next_record(CaptureReader& reader, capture_direction_t& direction, std::string& data) {
+    CaptureRecord record;
+    if(!reader.next(record))
+        return false;
+    direction = record.direction;
+    data.assign(record.data, record.size);
+    return true;
+}
+
+// Appends a frame with its checksum, encoded the way Serial::write_frame() sends it
+static void encode_frame(const Framer& framer, const Checksum& checksum, const std::string& payload,
+                         std::string& stream) {
+    std::vector<char> framed(payload.begin(), payload.end());
+    framed.resize(payload.size() + checksum.size());
+    checksum.compute(payload.data(), payload.size(), &framed[0] + payload.size());
+    std::vector<char> encoded;
+    framer.encode(&framed[0], framed.size(), encoded);
+    stream.append(encoded.begin(), encoded.end());
+}
+
+BOOST_AUTO_TEST_SUITE(capture)
+
+BOOST_AUTO_TEST_CASE(round_trip) {
+    CaptureFile file;
+    std::vector<std::string> records;
+    {
+        // Small enough that the file has to grow several times, including by more than double
+        CaptureLog log(file.path, 64);
+        for(std::size_t i = 1; i <= 60; ++i) {
+            records.push_back(std::string(i * 7, char('a' + i % 26)));
+            log.append(i % 3 == 0 ? CAPTURE_TX : CAPTURE_RX, uint64_t(1000 + i), records.back().data(),
+                       records.back().size());
+        }
+        records.push_back(std::string(5000, 'z'));
+        log.append(CAPTURE_RX, uint64_t(2000), records.back().data(), records.back().size());
+        log.append(CAPTURE_RX, uint64_t(2001), "", 0); // Empty records are skipped
+        BOOST_CHECK_GT(log.size(), 64u);
+        log.close();
+        BOOST_CHECK_EQUAL(file.contents().size(), log.size());
+        
+        // Appending after close() is ignored
+        log.append(CAPTURE_RX, "late", 4);
+    }
+    
+    CaptureReader reader(file.path);
+    for(int pass = 0; pass < 2; ++pass) {
+        CaptureRecord record;
+        for(std::size_t i = 0; i < records.size(); ++i) {
+            BOOST_REQUIRE(reader.next(record));
+            BOOST_CHECK_EQUAL(std::string(record.data, record.size), records[i]);
+            if(i < 60) {
+                BOOST_CHECK_EQUAL(record.timestamp, uint64_t(1000 + i + 1));
+                BOOST_CHECK_EQUAL(record.direction, (i + 1) % 3 == 0 ? CAPTURE_TX : CAPTURE_RX);
+            } else {
+                BOOST_CHECK_EQUAL(record.timestamp, uint64_t(2000));
+            }
+        }
+        BOOST_CHECK(!reader.next(record));
+        reader.rewind();
+    }
+}
+
+BOOST_AUTO_TEST_CASE(timestamps) {
+    CaptureFile file;
+    uint64_t before = CaptureLog::now();
+    {
+        CaptureLog log(file.path);
+        log.append(CAPTURE_RX, "now", 3);
+    }
+    uint64_t after = CaptureLog::now();
+    CaptureReader reader(file.path);
+    CaptureRecord record;
+    BOOST_REQUIRE(reader.next(record));
+    BOOST_CHECK(record.timestamp >= before && record.timestamp <= after);
+}
+
+BOOST_AUTO_TEST_CASE(unclosed_file) {
+    // While the log is open the file is mapped at its initial size, the rest is zeros
+    CaptureFile file;
+    CaptureLog log(file.path, 4096);
+    log.append(CAPTURE_RX, uint64_t(1), "first", 5);
+    log.append(CAPTURE_TX, uint64_t(2), "second", 6);
+    BOOST_REQUIRE_EQUAL(file.contents().size(), 4096u);
+    
+    CaptureReader reader(file.path);
+    capture_direction_t direction;
+    std::string data;
+    BOOST_REQUIRE(next_record(reader, direction, data));
+    BOOST_CHECK_EQUAL(data, "first");
+    BOOST_REQUIRE(next_record(reader, direction, data));
+    BOOST_CHECK_EQUAL(data, "second");
+    BOOST_CHECK_EQUAL(direction, CAPTURE_TX);
+    BOOST_CHECK(!next_record(reader, direction, data));
+}
+
+BOOST_AUTO_TEST_CASE(truncated_file) {
+    CaptureFile file;
+    {
+        CaptureLog log(file.path);
+        log.append(CAPTURE_RX, "complete", 8);
+        log.append(CAPTURE_RX, "cut off at the end", 18);
+    }
+    std::string contents = file.contents();
+    
+    // In the middle of the last record's data, then of its header
+    std::size_t cuts[] = { contents.size() - 10, contents.size() - 24 - 4 };
+    for(std::size_t c = 0; c < sizeof(cuts) / sizeof(cuts[0]); ++c) {
+        file.replace(contents.substr(0, cuts[c]));
+        CaptureReader reader(file.path);
+        capture_direction_t direction;
+        std::string data;
+        BOOST_REQUIRE(next_record(reader, direction, data));
+        BOOST_CHECK_EQUAL(data, "complete");
+        BOOST_CHECK(!next_record(reader, direction, data));
+    }
+    
+    // Followed by zeros, like a file which was mapped larger than its records
+    file.replace(contents + std::string(100, '\0'));
+    CaptureReader reader(file.path);
+    capture_direction_t direction;
+    std::string data;
+    BOOST_REQUIRE(next_record(reader, direction, data));
+    BOOST_REQUIRE(next_record(reader, direction, data));
+    BOOST_CHECK_EQUAL(data, "cut off at the end");
+    BOOST_CHECK(!next_record(reader, direction, data));
+}
+
+BOOST_AUTO_TEST_CASE(not_a_capture) {
+    CaptureFile file;
+    file.replace("abc");
+    BOOST_CHECK_THROW(CaptureReader reader(file.path), CaptureFormatException);
+    file.replace("definitely not a serial capture");
+    BOOST_CHECK_THROW(CaptureReader reader(file.path), CaptureFormatException);
+    BOOST_CHECK_THROW(ReplaySerial replay(file.path), CaptureFormatException);
+}
+
+BOOST_AUTO_TEST_CASE(replay_reads) {
+    CaptureFile file;
+    {
+        CaptureLog log(file.path);
+        log.append(CAPTURE_RX, uint64_t(10), "hello wor", 9);
+        log.append(CAPTURE_TX, uint64_t(11), "ignored", 7);
+        log.append(CAPTURE_RX, uint64_t(12), "ld\nsecond line\nthi", 18);
+        log.append(CAPTURE_RX, uint64_t(13), "rd;last", 7);
+    }
+    
+    ReplaySerial replay(file.path);
+    BOOST_CHECK(replay.isOpen());
+    BOOST_CHECK_EQUAL(replay.getTimestamp(), 0u);
+    BOOST_CHECK_EQUAL(replay.read(5), "hello");
+    BOOST_CHECK_EQUAL(replay.getTimestamp(), 10u);
+    BOOST_CHECK_EQUAL(replay.read_until("\n"), " world\n");
+    BOOST_CHECK_EQUAL(replay.getTimestamp(), 12u);
+    BOOST_CHECK_EQUAL(replay.read_until('\n'), "second line\n");
+    BOOST_CHECK_EQUAL(replay.read_until_any(";,"), "third;");
+    BOOST_CHECK(!replay.atEnd());
+    
+    // The end of the capture makes reads return short
+    BOOST_CHECK_EQUAL(replay.read(10), "last");
+    BOOST_CHECK(replay.atEnd());
+    BOOST_CHECK_EQUAL(replay.read(10), "");
+    BOOST_CHECK_EQUAL(replay.read_until("\n"), "");
+    
+    replay.rewind();
+    BOOST_CHECK(!replay.atEnd());
+    BOOST_CHECK_EQUAL(replay.read_until("line\n"), "hello world\nsecond line\n");
+    BOOST_CHECK_EQUAL(replay.available(), 3u);
+    
+    // Data read_until has already taken from the capture is still returned by read
+    BOOST_CHECK_EQUAL(replay.read(100), "third;last");
+    
+    replay.rewind();
+    BOOST_CHECK_EQUAL(replay.read_until("\n", 4), "hell");
+    
+    boost::shared_ptr<BufferPool> pool(new BufferPool(16, 2));
+    replay.setBufferPool(pool);
+    PooledBuffer line;
+    BOOST_CHECK_EQUAL(replay.read_until(line, "\n"), 8u);
+    BOOST_CHECK_EQUAL(std::string(line.data(), line.size()), "o world\n");
+    PooledBuffer chunk;
+    BOOST_CHECK_EQUAL(replay.read(chunk, 6), 6u);
+    BOOST_CHECK_EQUAL(std::string(chunk.data(), chunk.size()), "second");
+    BOOST_CHECK_THROW(replay.read(line, 1), BufferPoolExhaustedException);
+}
+
+BOOST_AUTO_TEST_CASE(replay_frames) {
+    CobsFramer framer;
+    Crc16Checksum checksum;
+    std::string stream;
+    encode_frame(framer, checksum, "one", stream);
+    std::size_t corrupt = stream.size() + 2;
+    encode_frame(framer, checksum, "bad", stream);
+    stream[corrupt] ^= 0x01;
+    encode_frame(framer, checksum, std::string("t\0o", 3), stream);
+    encode_frame(framer, checksum, "three", stream);
+    
+    // Split the frames over records at awkward places
+    CaptureFile file;
+    {
+        CaptureLog log(file.path);
+        std::size_t cuts[] = { 0, 1, 7, 8, 15, stream.size() };
+        for(std::size_t c = 0; c + 1 < sizeof(cuts) / sizeof(cuts[0]); ++c)
+            log.append(CAPTURE_RX, stream.data() + cuts[c], cuts[c + 1] - cuts[c]);
+    }
+    
+    ReplaySerial replay(file.path);
+    std::string frame;
+    BOOST_CHECK_THROW(replay.read_frame(frame), FramerNotSetException);
+    replay.setFramer(boost::shared_ptr<Framer>(new CobsFramer()));
+    replay.setChecksum(boost::shared_ptr<Checksum>(new Crc16Checksum()));
+    
+    BOOST_REQUIRE(replay.read_frame(frame));
+    BOOST_CHECK_EQUAL(frame, "one");
+    BOOST_REQUIRE(replay.read_frame(frame)); // The corrupt frame is skipped
+    BOOST_CHECK_EQUAL(frame, std::string("t\0o", 3));
+    
+    boost::shared_ptr<BufferPool> pool(new BufferPool(16, 1));
+    replay.setBufferPool(pool);
+    PooledBuffer pooled;
+    BOOST_REQUIRE(replay.read_frame(pooled));
+    BOOST_CHECK_EQUAL(std::string(pooled.data(), pooled.size()), "three");
+    BOOST_CHECK(!replay.read_frame(frame));
+    BOOST_CHECK(replay.atEnd());
+    
+    // Written frames are encoded, with their checksum, and discarded
+    std::string encoded;
+    encode_frame(framer, checksum, "one", encoded);
+    BOOST_CHECK_EQUAL(replay.write_frame("one", 3), encoded.size());
+}
+
+BOOST_AUTO_TEST_CASE(replay_follow_writes) {
+    CaptureFile file;
+    {
+        CaptureLog log(file.path);
+        log.append(CAPTURE_RX, "banner\n", 7);
+        log.append(CAPTURE_TX, "ping\n", 5);
+        log.append(CAPTURE_RX, "pong\n", 5);
+        log.append(CAPTURE_TX, "status\n", 7);
+        log.append(CAPTURE_RX, "ok\n", 3);
+    }
+    
+    ReplaySerial replay(file.path, true);
+    // Data received before the first write is not held back
+    BOOST_CHECK_EQUAL(replay.read_until("\n"), "banner\n");
+    BOOST_CHECK_EQUAL(replay.available(), 0u);
+    BOOST_CHECK_EQUAL(replay.read_until("\n"), "");
+    BOOST_CHECK(!replay.atEnd());
+    
+    BOOST_CHECK_EQUAL(replay.write("pi"), 2);
+    BOOST_CHECK_EQUAL(replay.read(5), "");
+    BOOST_CHECK_EQUAL(replay.write("ng\n"), 3);
+    BOOST_CHECK_EQUAL(replay.read_until("\n"), "pong\n");
+    
+    // transact() writes the request and reads the response
+    std::string response;
+    BOOST_CHECK(replay.transact("status\n", response, ResponseMatch::delimiter("\n")));
+    BOOST_CHECK_EQUAL(response, "ok\n");
+    BOOST_CHECK(replay.atEnd());
+    
+    // Without follow_writes the responses come straight away
+    ReplaySerial eager(file.path);
+    BOOST_CHECK_EQUAL(eager.read(100), "banner\npong\nok\n");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
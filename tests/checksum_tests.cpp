@@ -0,0 +1,140 @@
+/**
+ * Tests the checksums against their published check values and against bitwise reference
+ * implementations, across the lengths and alignments which select the hardware and table paths.
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "serial/checksum.h"
+
+using namespace serial;
+
+// The check value of every CRC catalogued by the CRC RevEng project is computed over these
+static const std::string check_input("123456789");
+
+// One bit at a time, the way the reflected CRC-32s are defined
+static uint32_t reference_crc32(uint32_t polynomial, uint32_t crc, const char* data, size_t length) {
+    crc = ~crc;
+    for(size_t i = 0; i < length; ++i) {
+        crc ^= static_cast<unsigned char>(data[i]);
+        for(int bit = 0; bit < 8; ++bit)
+            crc = (crc & 1) ? (crc >> 1) ^ polynomial : crc >> 1;
+    }
+    return ~crc;
+}
+
+static const uint32_t crc32_polynomial = 0xEDB88320;
+static const uint32_t crc32c_polynomial = 0x82F63B78;
+
+// Enough for the PCLMULQDQ path, which folds 64 bytes at a time, to run several times
+static std::vector<char> random_data(size_t size) {
+    std::srand(1);
+    std::vector<char> data(size);
+    for(size_t i = 0; i < size; ++i)
+        data[i] = char(std::rand() & 0xFF);
+    return data;
+}
+
+BOOST_AUTO_TEST_SUITE(checksum)
+
+BOOST_AUTO_TEST_CASE(check_values) {
+    BOOST_CHECK_EQUAL(Crc32Checksum::update(0, check_input.data(), check_input.size()), 0xCBF43926u);
+    BOOST_CHECK_EQUAL(Crc32cChecksum::update(0, check_input.data(), check_input.size()), 0xE3069283u);
+    BOOST_CHECK_EQUAL(Crc16Checksum().checksum(check_input.data(), check_input.size()), 0x29B1);
+    BOOST_CHECK_EQUAL(Crc16Checksum(0x8005, 0xFFFF, true, 0, true).checksum(check_input.data(), check_input.size()),
+                      0x4B37);
+    BOOST_CHECK_EQUAL(Crc16Checksum(0x1021, 0).checksum(check_input.data(), check_input.size()), 0x31C3);
+    BOOST_CHECK_EQUAL(XorChecksum().checksum(check_input.data(), check_input.size()), 0x31);
+}
+
+BOOST_AUTO_TEST_CASE(byte_order) {
+    char out[4];
+    Crc16Checksum ccitt;
+    BOOST_REQUIRE_EQUAL(ccitt.size(), 2u);
+    ccitt.compute(check_input.data(), check_input.size(), out);
+    BOOST_CHECK_EQUAL(std::string(out, 2), std::string("\x29\xB1", 2));
+    
+    Crc16Checksum modbus(0x8005, 0xFFFF, true, 0, true);
+    modbus.compute(check_input.data(), check_input.size(), out);
+    BOOST_CHECK_EQUAL(std::string(out, 2), std::string("\x37\x4B", 2));
+    
+    Crc32Checksum crc32;
+    BOOST_REQUIRE_EQUAL(crc32.size(), 4u);
+    crc32.compute(check_input.data(), check_input.size(), out);
+    BOOST_CHECK_EQUAL(std::string(out, 4), std::string("\x26\x39\xF4\xCB", 4));
+    
+    Crc32cChecksum crc32c;
+    crc32c.compute(check_input.data(), check_input.size(), out);
+    BOOST_CHECK_EQUAL(std::string(out, 4), std::string("\x83\x92\x06\xE3", 4));
+}
+
+BOOST_AUTO_TEST_CASE(verify) {
+    Crc32Checksum crc32;
+    std::string frame = check_input + std::string("\x26\x39\xF4\xCB", 4);
+    BOOST_CHECK(crc32.verify(frame.data(), frame.size()));
+    
+    frame[3] ^= 0x01;
+    BOOST_CHECK(!crc32.verify(frame.data(), frame.size()));
+    
+    // Too short to hold the checksum at all
+    BOOST_CHECK(!crc32.verify(frame.data(), 3));
+    
+    // Only the checksum, of no data
+    char empty[4];
+    crc32.compute(NULL, 0, empty);
+    BOOST_CHECK(crc32.verify(empty, 4));
+    
+    XorChecksum xor_checksum;
+    std::string sentence = check_input + char(0x31);
+    BOOST_CHECK(xor_checksum.verify(sentence.data(), sentence.size()));
+    BOOST_CHECK(!xor_checksum.verify(sentence.data(), sentence.size() - 1));
+}
+
+BOOST_AUTO_TEST_CASE(crc32_matches_reference) {
+    std::vector<char> data = random_data(512);
+    for(size_t offset = 0; offset < 16; ++offset) {
+        for(size_t length = 0; length <= 300; ++length) {
+            BOOST_CHECK_EQUAL(Crc32Checksum::update(0, &data[offset], length),
+                              reference_crc32(crc32_polynomial, 0, &data[offset], length));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(crc32c_matches_reference) {
+    std::vector<char> data = random_data(512);
+    for(size_t offset = 0; offset < 16; ++offset) {
+        for(size_t length = 0; length <= 300; ++length) {
+            BOOST_CHECK_EQUAL(Crc32cChecksum::update(0, &data[offset], length),
+                              reference_crc32(crc32c_polynomial, 0, &data[offset], length));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(update_in_chunks) {
+    // Chunks below 64 bytes always take the table path of CRC-32, so a mix of chunk sizes
+    // hands the CRC back and forth between the paths at every alignment
+    std::vector<char> data = random_data(4099);
+    uint32_t crc32 = Crc32Checksum::update(0, &data[0], data.size());
+    uint32_t crc32c = Crc32cChecksum::update(0, &data[0], data.size());
+    BOOST_REQUIRE_EQUAL(crc32, reference_crc32(crc32_polynomial, 0, &data[0], data.size()));
+    BOOST_REQUIRE_EQUAL(crc32c, reference_crc32(crc32c_polynomial, 0, &data[0], data.size()));
+    
+    static const size_t chunk_sizes[] = { 1, 3, 7, 15, 16, 17, 63, 64, 65, 127, 200, 1000 };
+    for(size_t c = 0; c < sizeof(chunk_sizes) / sizeof(chunk_sizes[0]); ++c) {
+        uint32_t chunked32 = 0, chunked32c = 0;
+        for(size_t i = 0; i < data.size(); i += chunk_sizes[c]) {
+            size_t length = std::min(chunk_sizes[c], data.size() - i);
+            chunked32 = Crc32Checksum::update(chunked32, &data[i], length);
+            chunked32c = Crc32cChecksum::update(chunked32c, &data[i], length);
+        }
+        BOOST_CHECK_EQUAL(chunked32, crc32);
+        BOOST_CHECK_EQUAL(chunked32c, crc32c);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,100 @@
+/**
+ * Tests the vectorized delimiter search against std::search and std::find_first_of, at every
+ * offset within a block and with matches straddling the 16 byte blocks.
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "delimiter_scan.h"
+
+using namespace serial;
+
+// Data over a small alphabet, so the delimiters and their prefixes occur often
+static std::vector<char> random_text(size_t size, const std::string& alphabet) {
+    std::srand(1);
+    std::vector<char> data(size);
+    for(size_t i = 0; i < size; ++i)
+        data[i] = alphabet[std::rand() % alphabet.size()];
+    return data;
+}
+
+BOOST_AUTO_TEST_SUITE(delimiter_scan)
+
+BOOST_AUTO_TEST_CASE(find_matches_search) {
+    std::vector<char> data = random_text(4096, std::string("ab\r\n\0\xFF", 6));
+    std::vector<std::string> delims;
+    delims.push_back("\n");
+    delims.push_back("\r\n");
+    delims.push_back("ab\r");
+    delims.push_back(std::string("\xFF\0\xFF", 3));
+    delims.push_back("\r\n\r\n");
+    delims.push_back("zz"); // Never found
+    
+    for(size_t d = 0; d < delims.size(); ++d) {
+        const std::string& delim = delims[d];
+        for(size_t offset = 0; offset < 16; ++offset) {
+            for(size_t size = 0; size <= 80; ++size) {
+                const char *begin = &data[offset], *end = begin + size;
+                size_t expected = std::search(begin, end, delim.begin(), delim.end()) - begin;
+                BOOST_CHECK_EQUAL(DelimiterScanner::find(begin, size, delim.data(), delim.size()), expected);
+            }
+            // Long enough to search many blocks, from a different start each time
+            size_t start = offset * 131, size = data.size() - start;
+            const char *begin = &data[start], *end = begin + size;
+            size_t expected = std::search(begin, end, delim.begin(), delim.end()) - begin;
+            BOOST_CHECK_EQUAL(DelimiterScanner::find(begin, size, delim.data(), delim.size()), expected);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(find_across_blocks) {
+    // A delimiter starting at every position around the end of the first blocks, in data
+    // which otherwise only holds its first and last bytes
+    std::string delim("\r-\n");
+    for(size_t position = 0; position < 40; ++position) {
+        std::string data(48, '\r');
+        for(size_t i = 1; i < data.size(); i += 2)
+            data[i] = '\n';
+        data.replace(position, delim.size(), delim);
+        size_t expected = std::search(data.begin(), data.end(), delim.begin(), delim.end()) - data.begin();
+        BOOST_CHECK_EQUAL(expected, position);
+        BOOST_CHECK_EQUAL(DelimiterScanner::find(data.data(), data.size(), delim.data(), delim.size()), expected);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(find_edge_cases) {
+    BOOST_CHECK_EQUAL(DelimiterScanner::find("abc", 3, "", 0), 0u);
+    BOOST_CHECK_EQUAL(DelimiterScanner::find("abc", 3, "abcd", 4), 3u);
+    BOOST_CHECK_EQUAL(DelimiterScanner::find("abc", 3, "abc", 3), 0u);
+    BOOST_CHECK_EQUAL(DelimiterScanner::find("", 0, "a", 1), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(find_any_matches_find_first_of) {
+    std::vector<char> data = random_text(4096, std::string("abcdefgh\r\n", 10));
+    std::vector<std::string> delims;
+    delims.push_back("");
+    delims.push_back("\n");
+    delims.push_back("\r\n");
+    delims.push_back("hgf");
+    delims.push_back("\r\n\t;,:!?"); // The most compared a block at a time
+    delims.push_back("\r\n\t;,:!?."); // One more than that, matched bytewise
+    delims.push_back("xyz"); // Never found
+    
+    for(size_t d = 0; d < delims.size(); ++d) {
+        const std::string& delim = delims[d];
+        for(size_t offset = 0; offset < 16; ++offset) {
+            for(size_t size = 0; size <= 80; ++size) {
+                const char *begin = &data[offset], *end = begin + size;
+                size_t expected = std::find_first_of(begin, end, delim.begin(), delim.end()) - begin;
+                BOOST_CHECK_EQUAL(DelimiterScanner::find_any(begin, size, delim.data(), delim.size()), expected);
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,247 @@
+/**
+ * Tests that each Framer decodes what it encodes however the stream is split into reads,
+ * and that malformed or oversized input is discarded without losing the frames after it.
+ */
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "serial/framer.h"
+
+using namespace serial;
+
+// Feeds stream to framer chunk bytes at a time, the way the read buffer does: the unread data
+// always starts at the same place until a frame has been consumed
+static std::vector<std::string> extract_all(Framer& framer, const std::string& stream, size_t chunk,
+                                            size_t& discarded_count) {
+    std::vector<char> buffer(stream.begin(), stream.end());
+    std::vector<std::string> frames;
+    discarded_count = 0;
+    framer.reset();
+    
+    size_t begin = 0, end = 0;
+    while(end < buffer.size()) {
+        end = std::min(end + chunk, buffer.size());
+        while(begin < end) {
+            const char *frame = NULL;
+            size_t frame_size = 0;
+            bool discarded = false;
+            size_t consumed = framer.extract(&buffer[begin], end - begin, frame, frame_size, discarded);
+            if(consumed == 0)
+                break;
+            BOOST_REQUIRE_LE(consumed, end - begin);
+            if(frame != NULL) {
+                BOOST_REQUIRE(frame >= &buffer[begin] && frame + frame_size <= &buffer[begin] + consumed);
+                frames.push_back(std::string(frame, frame_size));
+            }
+            if(discarded) {
+                BOOST_CHECK(frame == NULL);
+                ++discarded_count;
+            }
+            begin += consumed;
+        }
+    }
+    return frames;
+}
+
+static std::string encode_all(const Framer& framer, const std::vector<std::string>& payloads) {
+    std::vector<char> encoded;
+    for(size_t i = 0; i < payloads.size(); ++i)
+        framer.encode(payloads[i].data(), payloads[i].size(), encoded);
+    return std::string(encoded.begin(), encoded.end());
+}
+
+// Checks that payloads survive encoding and extracting whole, and one or a few bytes at a time
+static void check_round_trip(Framer& framer, const std::vector<std::string>& payloads) {
+    std::string stream = encode_all(framer, payloads);
+    static const size_t chunks[] = { 1, 2, 7, 64 };
+    for(size_t c = 0; c < sizeof(chunks) / sizeof(chunks[0]) + 1; ++c) {
+        size_t chunk = c < sizeof(chunks) / sizeof(chunks[0]) ? chunks[c] : stream.size();
+        size_t discarded = 0;
+        std::vector<std::string> frames = extract_all(framer, stream, chunk, discarded);
+        BOOST_CHECK_EQUAL(discarded, 0u);
+        BOOST_REQUIRE_EQUAL(frames.size(), payloads.size());
+        for(size_t i = 0; i < payloads.size(); ++i)
+            BOOST_CHECK(frames[i] == payloads[i]);
+    }
+}
+
+// Binary payloads with the bytes SLIP and COBS have to escape, and runs around COBS block sizes
+static std::vector<std::string> binary_payloads() {
+    std::vector<std::string> payloads;
+    payloads.push_back("a");
+    payloads.push_back(std::string("\0", 1));
+    payloads.push_back(std::string("\0\0\0", 3));
+    payloads.push_back(std::string("\xC0\xDB\xDC\xDD\xC0", 5));
+    payloads.push_back(std::string("x\0y\xC0z\xDB", 6));
+    payloads.push_back(std::string(253, 'b'));
+    payloads.push_back(std::string(254, 'c'));
+    payloads.push_back(std::string(255, 'd'));
+    payloads.push_back(std::string(254, 'e') + std::string("\0", 1));
+    payloads.push_back(std::string(600, 'f'));
+    std::string all_bytes;
+    for(int i = 0; i < 256; ++i)
+        all_bytes += char(i);
+    payloads.push_back(all_bytes + all_bytes);
+    return payloads;
+}
+
+BOOST_AUTO_TEST_SUITE(framer)
+
+BOOST_AUTO_TEST_CASE(delimiter_round_trip) {
+    std::vector<std::string> payloads;
+    payloads.push_back("$GPGGA,123519,4807.038,N");
+    payloads.push_back("");
+    payloads.push_back("\r");
+    payloads.push_back("a\nb");
+    payloads.push_back(std::string(300, 'x'));
+    DelimiterFramer framer("\r\n");
+    check_round_trip(framer, payloads);
+    
+    DelimiterFramer single("\n");
+    payloads[3] = "a\rb";
+    check_round_trip(single, payloads);
+}
+
+BOOST_AUTO_TEST_CASE(delimiter_overflow) {
+    DelimiterFramer framer("\n", 8);
+    size_t discarded = 0;
+    std::vector<std::string> frames = extract_all(framer, std::string(20, 'x') + "\nok\n", 20, discarded);
+    BOOST_CHECK_EQUAL(discarded, 1u);
+    BOOST_REQUIRE_EQUAL(frames.size(), 2u);
+    BOOST_CHECK_EQUAL(frames[0], ""); // The rest of the line which was too long
+    BOOST_CHECK_EQUAL(frames[1], "ok");
+}
+
+BOOST_AUTO_TEST_CASE(length_prefix_round_trip) {
+    std::vector<std::string> payloads = binary_payloads();
+    payloads.push_back("");
+    LengthPrefixFramer two;
+    check_round_trip(two, payloads);
+    LengthPrefixFramer four_little(4, false);
+    check_round_trip(four_little, payloads);
+    
+    payloads.clear();
+    payloads.push_back("");
+    payloads.push_back(std::string(255, 'a'));
+    LengthPrefixFramer one(1);
+    check_round_trip(one, payloads);
+}
+
+BOOST_AUTO_TEST_CASE(length_prefix_encoding) {
+    std::vector<char> encoded;
+    LengthPrefixFramer(2, true).encode("abc", 3, encoded);
+    BOOST_CHECK_EQUAL(std::string(encoded.begin(), encoded.end()), std::string("\0\3abc", 5));
+    
+    encoded.clear();
+    LengthPrefixFramer(2, false).encode("abc", 3, encoded);
+    BOOST_CHECK_EQUAL(std::string(encoded.begin(), encoded.end()), std::string("\3\0abc", 5));
+    
+    std::string too_large(256, 'a');
+    BOOST_CHECK_THROW(LengthPrefixFramer(1).encode(too_large.data(), too_large.size(), encoded),
+                      FrameTooLargeException);
+}
+
+BOOST_AUTO_TEST_CASE(length_prefix_corrupt_length) {
+    LengthPrefixFramer framer(2, true, 16);
+    size_t discarded = 0;
+    std::vector<std::string> frames = extract_all(framer, std::string("\xFF\xFF", 2) + "abcdef", 8, discarded);
+    BOOST_CHECK_EQUAL(discarded, 1u);
+    BOOST_CHECK(frames.empty());
+    
+    // A length which fits is waited for, not discarded
+    frames = extract_all(framer, std::string("\0\x10", 2) + "abc", 5, discarded);
+    BOOST_CHECK_EQUAL(discarded, 0u);
+    BOOST_CHECK(frames.empty());
+}
+
+BOOST_AUTO_TEST_CASE(slip_round_trip) {
+    // SLIP cannot send an empty frame, it is indistinguishable from back to back END bytes
+    SlipFramer framer;
+    check_round_trip(framer, binary_payloads());
+}
+
+BOOST_AUTO_TEST_CASE(slip_encoding) {
+    std::vector<char> encoded;
+    SlipFramer().encode("\xC0\xDB", 2, encoded);
+    BOOST_CHECK_EQUAL(std::string(encoded.begin(), encoded.end()), std::string("\xC0\xDB\xDC\xDB\xDD\xC0", 6));
+}
+
+BOOST_AUTO_TEST_CASE(slip_malformed) {
+    SlipFramer framer;
+    size_t discarded = 0;
+    
+    // An escape followed by a byte which is not ESC_END or ESC_ESC, then an escape cut off by END
+    std::string stream = std::string("\xC0" "ab\xDB" "x\xC0", 6) + std::string("\xC0" "cd\xDB\xC0", 5) +
+                         std::string("\xC0ok\xC0", 4);
+    std::vector<std::string> frames = extract_all(framer, stream, 1, discarded);
+    BOOST_CHECK_EQUAL(discarded, 2u);
+    BOOST_REQUIRE_EQUAL(frames.size(), 1u);
+    BOOST_CHECK_EQUAL(frames[0], "ok");
+}
+
+BOOST_AUTO_TEST_CASE(slip_overflow) {
+    SlipFramer framer(8);
+    size_t discarded = 0;
+    std::vector<std::string> frames = extract_all(framer, std::string(20, 'x') + "\xC0ok\xC0", 20, discarded);
+    BOOST_CHECK_EQUAL(discarded, 1u);
+    BOOST_REQUIRE_EQUAL(frames.size(), 1u);
+    BOOST_CHECK_EQUAL(frames[0], "ok");
+}
+
+BOOST_AUTO_TEST_CASE(cobs_round_trip) {
+    std::vector<std::string> payloads = binary_payloads();
+    payloads.push_back("");
+    CobsFramer framer;
+    check_round_trip(framer, payloads);
+}
+
+BOOST_AUTO_TEST_CASE(cobs_encoding) {
+    // The examples of the COBS paper and the Wikipedia article
+    std::vector<char> encoded;
+    CobsFramer framer;
+    framer.encode("\0", 1, encoded);
+    BOOST_CHECK_EQUAL(std::string(encoded.begin(), encoded.end()), std::string("\1\1\0", 3));
+    
+    encoded.clear();
+    framer.encode("\x11\x22\0\x33", 4, encoded);
+    BOOST_CHECK_EQUAL(std::string(encoded.begin(), encoded.end()), std::string("\3\x11\x22\2\x33\0", 6));
+    
+    encoded.clear();
+    std::string block(254, 'a');
+    framer.encode(block.data(), block.size(), encoded);
+    BOOST_CHECK_EQUAL(std::string(encoded.begin(), encoded.end()), std::string("\xFF", 1) + block + std::string("\0", 1));
+}
+
+BOOST_AUTO_TEST_CASE(cobs_malformed) {
+    CobsFramer framer;
+    size_t discarded = 0;
+    
+    // A code which runs past the zero ending the frame
+    std::string stream = std::string("\5ab\0", 4) + std::string("\3ok\0", 4);
+    std::vector<std::string> frames = extract_all(framer, stream, 1, discarded);
+    BOOST_CHECK_EQUAL(discarded, 1u);
+    BOOST_REQUIRE_EQUAL(frames.size(), 1u);
+    BOOST_CHECK_EQUAL(frames[0], "ok");
+    
+    // Back to back zero bytes are idle, not errors
+    frames = extract_all(framer, std::string("\0\0\3ok\0", 6), 6, discarded);
+    BOOST_CHECK_EQUAL(discarded, 0u);
+    BOOST_REQUIRE_EQUAL(frames.size(), 1u);
+    BOOST_CHECK_EQUAL(frames[0], "ok");
+}
+
+BOOST_AUTO_TEST_CASE(cobs_overflow) {
+    CobsFramer framer(8);
+    size_t discarded = 0;
+    std::vector<std::string> frames = extract_all(framer, std::string(20, 'x') + std::string("\0\3ok\0", 5), 20,
+                                                  discarded);
+    BOOST_CHECK_EQUAL(discarded, 1u);
+    BOOST_REQUIRE_EQUAL(frames.size(), 1u);
+    BOOST_CHECK_EQUAL(frames[0], "ok");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,9 @@
+/**
+ * Unit tests of the parts of Serial which do not need a serial port.
+ * 
+ * They use the header only variant of Boost.Test, so nothing beyond Boost and the Serial
+ * library is needed to build them. Run bin/serial_tests, or ctest from the build directory.
+ */
+
+#define BOOST_TEST_MODULE serial_tests
+#include <boost/test/included/unit_test.hpp>